@@ -3,10 +3,12 @@
  * ComputeMatrices.h
  *
  * DESCRIPTION: Implementation of the algorithms for the problems:
- *              0-zeros:   trimZeroOne                    (line 43)
- *              z-zeros:   trimZeroOneZerosAllowed        (line 117)
- *              p-percent: trimZeroOnePercentZerosAllowed (line 269)
- *              m-mean:    trimIntegerMean                (line 402)
+ *              0-zeros:   trimZeroOne
+ *              z-zeros:   trimZeroOneZerosAllowed
+ *              p-percent: trimZeroOnePercentZerosAllowed
+ *              m-mean:    trimIntegerMean
+ *              0-zeros, p-percent and m-mean are trimOneBlocks with the
+ *              criterion policy of the problem (see Criteria.h).
  *
  * RUNTIMES: If the input has r reads of length l:
  *           0-zeros:   worst-case: O( r * l )     expected: O( r * l )
@@ -24,148 +26,151 @@
  * Version 1.1: (25 Jul 2014) Speed-Up for p-percent and m-mean: If we have a
  *              nice instance, the runtime is O( r * l )
  *
+ * The reading loop is forEachQualityLine, the per read algorithm of the 1-block
+ * problems is addCriterionRow (Criteria.h), shared with the parallel engines.
+ * The per read kernels are instantiated for the common read lengths (see
+ * withFixedLength in Criteria.h).
+ *
  */
 
+#ifndef _ComputeMatrices_h
+#define _ComputeMatrices_h
+
 #include <fstream>
 #include <string>
 #include <vector>
 #include <utility>
+#include <limits>
+
+#include "QualityInput.h"
+#include "ComputeMatricesBitmap.h" // addTriangleCounts, addColumnCounts
+#include "Criteria.h"
+#include "Stats.h"
 
 using namespace std;
 
 namespace ComputeMatrices {
     
-    // 0-zeros
-    // =======
-    // readFASTQ => each time skip 3 lines
-    // (thresholdGoodValues >= 0) => lines of the grid are not '0' and '1' so use a threshold:
-    //                               (quality < threshold)? '0' : '1'
-    vector<vector<int> > trimZeroOne(
-                                     const string& inputfile,
-                                     const int& numberOfSequences,
-                                     const int& lengthOfSequence,
-                                     const int& thresholdGoodValues,
-                                     const int& shiftToConvertChars)
+    // reads the first numberOfSequences quality lines of inputfile and calls
+    // kernel(zeile) for each (parse and kernel are timed per read)
+    template <typename Kernel>
+    void forEachQualityLine(const string& inputfile,
+                            const int& numberOfSequences,
+                            Kernel kernel)
     {
-        
-        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
-        
-        // alloc and init c and cT
-        // cT = counter of triangles
-        // c(i,j)=m means, there are m lines where a 1-block starts at i & ends at j
-        vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        vector<vector<int> > cT (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        
         // read the file row by row
         string zeile;
         
         // open file
-        ifstream in(inputfile, ios::in);
+        QualityLineReader in(inputfile);
         
-        bool stillInOneBlock = false;
-        int startOfOneBlock;
         for (int z = 0; z < numberOfSequences; z++) {
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            getline(in,zeile);
-            startOfOneBlock = 0;
-            zeile.append("!"); // dummy 0 at the end
-            // ASSERT: ASCII("!")=33 and this is the smallest possible char in a quality score string
-            // we need a dummy "bad" quality score at the end for our algorithm
-            for (int i = 0; i <= lengthOfSequence; i++) {
-                if (zeile[i] < thresholdPlusShift) {
-                    if (stillInOneBlock) {
-                        stillInOneBlock = false;
-                        cT[startOfOneBlock][i-1]++;
-                    }
-                } else {
-                    if (!stillInOneBlock) {
-                        stillInOneBlock = true;
-                        startOfOneBlock = i;
-                    }
-                }
+            {
+                Stats::Stage parse(Stats::Parse, Stats::wallOnly);
+                in.nextQualityLine(zeile);
             }
+            Stats::Stage timedKernel(Stats::Kernel, Stats::wallOnly);
+            kernel(zeile);
         }
+        Stats::addReads(numberOfSequences);
+    }
+    
+    // 0-zeros, p-percent and m-mean: the 1-blocks of each read are counted as
+    // triangles in cT, the other windows in c (see Criteria.h)
+    template <typename Criterion, typename Counter = int>
+    vector<vector<Counter> > trimOneBlocks(const string& inputfile,
+                                           const int& numberOfSequences,
+                                           const int& lengthOfSequence,
+                                           Criterion criterion)
+    {
+        vector<vector<Counter> > c (lengthOfSequence, vector<Counter>(lengthOfSequence,0));
+        vector<vector<Counter> > cT (lengthOfSequence, vector<Counter>(lengthOfSequence,0));
         
-        // compute c from cT
-        vector<int> columnSumAbove (lengthOfSequence,0);
-        // first fill the last column of c
-        c[0][lengthOfSequence-1] = cT[0][lengthOfSequence-1];
-        for (int i=1; i < lengthOfSequence; i++){
-            c[i][lengthOfSequence-1] = cT[i][lengthOfSequence-1] + c[i-1][lengthOfSequence-1];
-        }
-        // next fill the first row of c
-        for (int j=lengthOfSequence-2; j>= 0; j--){
-            c[0][j] = cT[0][j] + c[0][j+1];
-            columnSumAbove[j] = cT[0][j];
-        }
-        // now fill the rest
-        for (int i=1; i < lengthOfSequence; i++){
-            for (int j=lengthOfSequence-2; j>= i; j--){
-                c[i][j] = cT[i][j] + c[i][j+1] + columnSumAbove[j];
-                columnSumAbove[j] += cT[i][j];
-            }
-        }
+        forEachQualityLine(inputfile, numberOfSequences, [&](const string& zeile) {
+            addCriterionRow(zeile, criterion, c, cT);
+        });
+        
+        // compute c_aux from cT and add it to c
+        Stats::Stage prefix(Stats::Prefix);
+        addTriangleCounts(cT, c, lengthOfSequence);
         
         return c;
     }
     
-    ////////////////////////////////////////////////////////////////////////////////
+    // calls trimOneBlocks with the criterion chosen by withFixedLength
+    struct TrimOneBlocks {
+        const string& inputfile;
+        const int&    numberOfSequences;
+        
+        template <typename Criterion>
+        vector<vector<int> > operator()(Criterion criterion) const {
+            return trimOneBlocks(inputfile, numberOfSequences, criterion.length(), criterion);
+        }
+    };
     
-    // z-zeros
-    vector<vector<int> > trimZeroOneZerosAllowed(
-                                                 const string& inputfile,
-                                                 const int& numberOfSequences,
-                                                 const int& lengthOfSequence,
-                                                 const int& numberOfAllowedZerosPerSequence,
-                                                 const int& thresholdGoodValues,
-                                                 const int& shiftToConvertChars)
+    // 0-zeros
+    // =======
+    // readFASTQ => each time skip 3 lines
+    // (thresholdGoodValues >= 0) => lines of the grid are not '0' and '1' so use a threshold:
+    //                               (quality < threshold)? '0' : '1'
+    vector<vector<int> > trimZeroOne(
+                                     const string& inputfile,
+                                     const int& numberOfSequences,
+                                     const int& lengthOfSequence,
+                                     const int& thresholdGoodValues,
+                                     const int& shiftToConvertChars)
     {
         int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
-        
-        // alloc and init c and cC
-        // cC = counter of columns
-        // c(i,j)=m means, there are m lines where a block of "only ones and at most
-        //          k zeros" starts at i and ends at j
-        vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        vector<vector<int> > cC (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        
-        // read the file row by row
-        string zeile;
+        TrimOneBlocks trim = {inputfile, numberOfSequences};
+        return withFixedLength<ZeroOneCriterion>(trim, lengthOfSequence, thresholdPlusShift);
+    }
+    
+    ////////////////////////////////////////////////////////////////////////////////
+    
+    // z-zeros: the per read kernel adds the blocks of "only ones and at most
+    // k zeros" to the column counters cC (same interface as the criteria of
+    // Criteria.h for withFixedLength)
+    template <int FixedLength = 0>
+    struct ZerosAllowedScan {
+        int lengthOfSequence;
+        int numberOfAllowedZeros;
+        int thresholdPlusShift;
         
         // store the positions of the left ends of each 1-block
-        vector<int> leftOne(lengthOfSequence,0);
+        ScratchBuffer<int, FixedLength> leftOne;
         
         // store the positions of the right ends of each 1-block
-        vector<int> rightOne(lengthOfSequence,0);
+        ScratchBuffer<int, FixedLength> rightOne;
         
         // store the positions of all zeros in the current column
-        vector<int> positionsOfZeros(lengthOfSequence,0);
-        
-        // if some zeros are allowed, there is a leftmost and a rightmost zero in
-        // each identified block that consists of "only ones and at most k zeros"
-        int leftBorderZero, rightBorderZero;
-        // each block of such a type has a left and a right border
-        int leftBorderOneBlock, rightBorderOneBlock;
+        ScratchBuffer<int, FixedLength> positionsOfZeros;
         
-        // open file
-        ifstream in(inputfile, ios::in);
+        ZerosAllowedScan(const int& lengthOfSequence,
+                         const int& numberOfAllowedZeros,
+                         const int& thresholdPlusShift)
+        : lengthOfSequence(lengthOfSequence), numberOfAllowedZeros(numberOfAllowedZeros),
+          thresholdPlusShift(thresholdPlusShift), leftOne(lengthOfSequence),
+          rightOne(lengthOfSequence), positionsOfZeros(lengthOfSequence) {}
         
-        bool stillInOneBlock;
-        int startOfOneBlock;
-        int numberOfZerosInCurrentRow;
+        int length() const { return readLength<FixedLength>(lengthOfSequence); }
         
-        // loop over all lines of the file
-        for (int z = 0; z < numberOfSequences; z++) {
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            getline(in,zeile);
+        void addRow(const string& zeile, vector<vector<int> >& cC) {
+            const int L = length();
+            
+            // if some zeros are allowed, there is a leftmost and a rightmost zero in
+            // each identified block that consists of "only ones and at most k zeros"
+            int leftBorderZero, rightBorderZero;
+            // each block of such a type has a left and a right border
+            int leftBorderOneBlock, rightBorderOneBlock;
+            
+            bool stillInOneBlock;
+            int startOfOneBlock;
+            int numberOfZerosInCurrentRow;
+            
             startOfOneBlock = 0;
             numberOfZerosInCurrentRow = 0;
             stillInOneBlock = (zeile[0]>=thresholdPlusShift);
-            for (int i = 0; i < lengthOfSequence; i++) {
+            for (int i = 0; i < L; i++) {
                 // initialize leftOne and rightOne
                 leftOne[i] = 0;
                 rightOne[i] = 0;
@@ -188,11 +193,11 @@ namespace ComputeMatrices {
                 }
             }
             // fill rightOne
-            stillInOneBlock = (zeile[lengthOfSequence-1]>=thresholdPlusShift);
+            stillInOneBlock = (zeile[L-1]>=thresholdPlusShift);
             if (stillInOneBlock) {
-                startOfOneBlock = lengthOfSequence-1;
+                startOfOneBlock = L-1;
             }
-            for (int i = lengthOfSequence-1; i >=0; i--) {
+            for (int i = L-1; i >=0; i--) {
                 if (zeile[i]<thresholdPlusShift) {
                     if (stillInOneBlock) {
                         stillInOneBlock = false;
@@ -206,14 +211,23 @@ namespace ComputeMatrices {
                 }
             }
             
-            if (numberOfZerosInCurrentRow <= numberOfAllowedZerosPerSequence) {
-                for (int j=0; j < lengthOfSequence; j++)
+            if (numberOfZerosInCurrentRow <= numberOfAllowedZeros) {
+                for (int j=0; j < L; j++)
                     cC[0][j]++;
+            } else if (numberOfAllowedZeros == 0) {
+                // no zeros allowed: the blocks are the 1-blocks between the zeros
+                for (int i = 0; i <= numberOfZerosInCurrentRow; i++) {
+                    leftBorderOneBlock  = (i == 0) ? 0 : positionsOfZeros[i-1] + 1;
+                    rightBorderOneBlock = (i < numberOfZerosInCurrentRow) ? positionsOfZeros[i] - 1 : L-1;
+                    for (int j = leftBorderOneBlock; j <= rightBorderOneBlock; j++) {
+                        cC[leftBorderOneBlock][j]++;
+                    }
+                }
             } else {
                 int previousBlock = -1;
-                for (int i = 0; i <= numberOfZerosInCurrentRow-numberOfAllowedZerosPerSequence; i++) {
+                for (int i = 0; i <= numberOfZerosInCurrentRow-numberOfAllowedZeros; i++) {
                     leftBorderZero = positionsOfZeros[i];
-                    rightBorderZero = positionsOfZeros[i+numberOfAllowedZerosPerSequence-1];
+                    rightBorderZero = positionsOfZeros[i+numberOfAllowedZeros-1];
                     // leftBorderOneBlock is either
                     // 1) = 0, if leftBorderZero == 0
                     // 2) = leftBorderZero, if leftBorderZero-1 is *not* part of a
@@ -230,8 +244,8 @@ namespace ComputeMatrices {
                         }
                     }
                     // same for rightBorderOneBlock
-                    if (rightBorderZero == lengthOfSequence-1) {
-                        rightBorderOneBlock = lengthOfSequence-1;
+                    if (rightBorderZero == L-1) {
+                        rightBorderOneBlock = L-1;
                     } else {
                         if (zeile[rightBorderZero+1]>=thresholdPlusShift) { // 1-block right of 0
                             rightBorderOneBlock = rightOne[rightBorderZero+1];
@@ -247,20 +261,50 @@ namespace ComputeMatrices {
                 }
             }
         }
-        
-        // compute c from cC
-        // first fill the first row of c
-        for (int j=0; j< lengthOfSequence; j++){
-            c[0][j] = cC[0][j];
-        }
-        // now fill the rest
-        for (int i=1; i < lengthOfSequence; i++){
-            for (int j=i; j<lengthOfSequence; j++){
-                c[i][j] = cC[i][j] + c[i-1][j];
-            }
+    };
+    
+    // reads the quality lines with scan.addRow and computes c from cC
+    struct TrimColumns {
+        const string& inputfile;
+        const int&    numberOfSequences;
+        
+        template <typename Scan>
+        vector<vector<int> > operator()(Scan scan) const {
+            const int lengthOfSequence = scan.length();
+            
+            // alloc and init c and cC
+            // cC = counter of columns
+            // c(i,j)=m means, there are m lines where a block of "only ones and at most
+            //          k zeros" starts at i and ends at j
+            vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
+            vector<vector<int> > cC (lengthOfSequence, vector<int>(lengthOfSequence,0));
+            
+            // loop over all lines of the file
+            forEachQualityLine(inputfile, numberOfSequences, [&](const string& zeile) {
+                scan.addRow(zeile, cC);
+            });
+            
+            // compute c from cC
+            Stats::Stage prefix(Stats::Prefix);
+            addColumnCounts(cC, c, lengthOfSequence);
+            
+            return c;
         }
-        
-        return c;
+    };
+    
+    // z-zeros
+    vector<vector<int> > trimZeroOneZerosAllowed(
+                                                 const string& inputfile,
+                                                 const int& numberOfSequences,
+                                                 const int& lengthOfSequence,
+                                                 const int& numberOfAllowedZerosPerSequence,
+                                                 const int& thresholdGoodValues,
+                                                 const int& shiftToConvertChars)
+    {
+        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
+        TrimColumns trim = {inputfile, numberOfSequences};
+        return withFixedLength<ZerosAllowedScan>(trim, lengthOfSequence,
+                                                 numberOfAllowedZerosPerSequence, thresholdPlusShift);
     }
     
     ////////////////////////////////////////////////////////////////////////////////
@@ -274,126 +318,9 @@ namespace ComputeMatrices {
                                                         const int& shiftToConvertChars)
     {
         int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
-        
-        // c(i,j)=m means, there are m lines where a block of "only ones and at most
-        //        p percent zeros" starts at i and ends at j
-        vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        vector<vector<int>> cT (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        
-        // read the file row by row
-        string zeile;
-        
-        // pre compute allowed zeros per width for given percent
-        vector<int> preCompAllowedZeros (lengthOfSequence+1);
-        for (int i = 0; i <= lengthOfSequence; i++) {
-            preCompAllowedZeros[i] = (int) (percentOfAllowedZerosPerSequence * i);
-        }
-        
-        // open file
-        ifstream in(inputfile, ios::in);
-        
-        for (int z = 0; z < numberOfSequences; z++) {
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            getline(in,zeile);
-            // pre processing to access the #zeros in O(1)
-            // #zeros in g[L..R] equals partialSums[R+1] - partialSums[L]
-            vector<int> partialSums(lengthOfSequence+1, 0);
-            partialSums[0] = 0;
-            for (int i = 0; i < lengthOfSequence; i++) {
-                partialSums[i+1] = (zeile[i] < thresholdPlusShift) + partialSums[i];
-            }
-            
-            // find block with values >= thresholdPlusShift), because all
-            // subblocks fulfill the p-percent condition
-            vector<pair<int,int>> oneBlocks;
-            int startOfOneBlock = 0;
-            bool stillInOneBlock = false;
-            zeile.append("!"); // dummy 0 at the end
-            // ASSERT: ASCII("!")=33 and this is the smallest possible char in a quality score string
-            // we need a dummy "bad" quality score at the end for our algorithm
-            for (int i = 0; i <= lengthOfSequence; i++) {
-                if (zeile[i] < thresholdPlusShift) {
-                    if (stillInOneBlock) {
-                        stillInOneBlock = false;
-                        oneBlocks.push_back( make_pair(startOfOneBlock,i-1) );
-                        cT[startOfOneBlock][i-1]++;
-                    }
-                } else {
-                    if (!stillInOneBlock) {
-                        stillInOneBlock = true;
-                        startOfOneBlock = i;
-                    }
-                }
-            }
-            
-            // remember that we added "!" to zeile, but we will not read it later,
-            // so there is no need to delete it
-            
-            // compute c(l,r) for all (l,r) not in the triangles of oneBlocks
-            // HORIZONTAL
-            int startrow = 0;
-            for (auto p: oneBlocks) {
-                for (int row = startrow; row < p.first; row++) {
-                    for (int col = row+1; col < lengthOfSequence; col++) {
-                        if ( (partialSums[col+1] - partialSums[row]) <= preCompAllowedZeros[col+1-row]) {
-                            c[row][col]++;
-                        }
-                    }
-                }
-                startrow = p.second + 1;
-                // VERTICAL: everything right of the triangle induced by p
-                for (int row = p.first; row <= p.second; row++) {
-                    for (int col = p.second+1; col < lengthOfSequence; col++) {
-                        if ( (partialSums[col+1] - partialSums[row]) <= preCompAllowedZeros[col+1-row]) {
-                            c[row][col]++;
-                        }
-                    }
-                }
-            }
-            // everything after last triangle of 1s
-            for (int row = startrow; row < lengthOfSequence; row++) {
-                for (int col = row+1; col < lengthOfSequence; col++) {
-                    if ( (partialSums[col+1] - partialSums[row]) <= preCompAllowedZeros[col+1-row]) {
-                        c[row][col]++;
-                    }
-                }
-            }
-            
-            
-        }
-        
-        // compute c_aux from cT like in 0-zeros:
-        vector<vector<int>> c_aux (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        vector<int> columnSumAbove (lengthOfSequence,0);
-        // first fill the last column of c_aux
-        c_aux[0][lengthOfSequence-1] = cT[0][lengthOfSequence-1];
-        for (int i=1; i < lengthOfSequence; i++){
-            c_aux[i][lengthOfSequence-1] = cT[i][lengthOfSequence-1] + c_aux[i-1][lengthOfSequence-1];
-        }
-        // next fill the first row of c_aux
-        for (int j=lengthOfSequence-2; j>= 0; j--){
-            c_aux[0][j] = cT[0][j] + c_aux[0][j+1];
-            columnSumAbove[j] = cT[0][j];
-        }
-        // now fill the rest
-        for (int i=1; i < lengthOfSequence; i++){
-            for (int j=lengthOfSequence-2; j>= i; j--){
-                c_aux[i][j] = cT[i][j] + c_aux[i][j+1] + columnSumAbove[j];
-                columnSumAbove[j] += cT[i][j];
-            }
-        }
-        
-        // add c and c_aux
-        
-        for (int i = 0; i < lengthOfSequence; i++) {
-            for (int j = i; j < lengthOfSequence; j++) {
-                c[i][j] += c_aux[i][j];
-            }
-        }
-        
-        return c;
+        TrimOneBlocks trim = {inputfile, numberOfSequences};
+        return withFixedLength<PercentCriterion>(trim, lengthOfSequence,
+                                                 percentOfAllowedZerosPerSequence, thresholdPlusShift);
     }
     
     ////////////////////////////////////////////////////////////////////////////////
@@ -405,121 +332,11 @@ namespace ComputeMatrices {
                                         const double& givenMean,
                                         const int&    shiftToConvertChars)
     {
-        // c(i,j)=x means, there are x lines where a block of starting at index i
-        // and ending at index j with mean value at least "givenMean"
-        vector<vector<int>> c (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        vector<vector<int>> cT (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        
         double shiftedMean = shiftToConvertChars + givenMean;
-        
-        // read the file row by row
-        string zeile;
-        // open file
-        ifstream in(inputfile, ios::in);
-        
-        for (int z = 0; z < numberOfSequences; z++) {
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            getline(in,zeile);
-            
-            // pre processing to access the mean in O(1)
-            vector<int> partialSums(lengthOfSequence+1, 0);
-            partialSums[0] = 0;
-            for (int i = 0; i < lengthOfSequence; i++) {
-                partialSums[i+1] = (zeile[i] - shiftedMean) + partialSums[i];
-            }
-            
-            // find block with values >= mean, because all subblocks fulfill the
-            // m-mean condition
-            vector<pair<int,int>> oneBlocks;
-            int startOfOneBlock = 0;
-            bool stillInOneBlock = false;
-            zeile.append("!"); // dummy 0 at the end
-            // ASSERT: ASCII("!")=33 and this is the smallest possible char in a quality score string
-            // we need a dummy "bad" quality score at the end for our algorithm
-            for (int i = 0; i <= lengthOfSequence; i++) {
-                if (zeile[i] < shiftedMean) {
-                    if (stillInOneBlock) {
-                        stillInOneBlock = false;
-                        oneBlocks.push_back( make_pair(startOfOneBlock,i-1) );
-                        cT[startOfOneBlock][i-1]++;
-                    }
-                } else {
-                    if (!stillInOneBlock) {
-                        stillInOneBlock = true;
-                        startOfOneBlock = i;
-                    }
-                }
-            }
-            
-            // remember that we added "!" to zeile, but we will not read it later,
-            // so there is no need to delete it
-            
-            // compute c(l,r) for all (l,r) not in the triangles of oneBlocks
-            // HORIZONTAL
-            int startrow = 0;
-            for (auto p: oneBlocks) {
-                for (int row = startrow; row < p.first; row++) {
-                    for (int col = row+1; col < lengthOfSequence; col++) {
-                        if ( (partialSums[col+1] - partialSums[row]) >= 0) {
-                            c[row][col]++;
-                        }
-                    }
-                }
-                startrow = p.second + 1;
-                // VERTICAL: everything right of the triangle induced by p
-                for (int row = p.first; row <= p.second; row++) {
-                    for (int col = p.second+1; col < lengthOfSequence; col++) {
-                        if ( (partialSums[col+1] - partialSums[row]) >= 0) {
-                            c[row][col]++;
-                        }
-                    }
-                }
-            }
-            // everything after last triangle of 1s
-            for (int row = startrow; row < lengthOfSequence; row++) {
-                for (int col = row+1; col < lengthOfSequence; col++) {
-                    if ( (partialSums[col+1] - partialSums[row]) >= 0) {
-                        c[row][col]++;
-                    }
-                }
-            }
-            
-        }
-        
-        // compute c_aux from cT like in 0-zeros:
-        vector<vector<int>> c_aux (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        vector<int> columnSumAbove (lengthOfSequence,0);
-        // first fill the last column of c_aux
-        c_aux[0][lengthOfSequence-1] = cT[0][lengthOfSequence-1];
-        for (int i=1; i < lengthOfSequence; i++){
-            c_aux[i][lengthOfSequence-1] = cT[i][lengthOfSequence-1] + c_aux[i-1][lengthOfSequence-1];
-        }
-        // next fill the first row of c_aux
-        for (int j=lengthOfSequence-2; j>= 0; j--){
-            c_aux[0][j] = cT[0][j] + c_aux[0][j+1];
-            columnSumAbove[j] = cT[0][j];
-        }
-        // now fill the rest
-        for (int i=1; i < lengthOfSequence; i++){
-            for (int j=lengthOfSequence-2; j>= i; j--){
-                c_aux[i][j] = cT[i][j] + c_aux[i][j+1] + columnSumAbove[j];
-                columnSumAbove[j] += cT[i][j];
-            }
-        }
-        
-        // add c and c_aux
-        
-        for (int i = 0; i < lengthOfSequence; i++) {
-            for (int j = i; j < lengthOfSequence; j++) {
-                c[i][j] += c_aux[i][j];
-            }
-        }
-        
-        
-        return c;
+        TrimOneBlocks trim = {inputfile, numberOfSequences};
+        return withFixedLength<MeanCriterion>(trim, lengthOfSequence, shiftedMean);
     }
     
 }
 
+#endif
@@ -0,0 +1,215 @@
+/*******************************************************************************
+ *
+ * ComputeMatricesBatch.h
+ *
+ * DESCRIPTION: Batch mode: many input files are processed by one reading
+ *              thread and one pool of num_threads worker threads that stay
+ *              alive for all files.
+ *              readBatchList: reads the list of input files, one line
+ *                             "<input file> <number of reads>" per file
+ *              trimBatch:     computes the matrix c of a Problem (see
+ *                             Problems.h) for each input file
+ *
+ *              The reading thread tags each batch of quality lines with the
+ *              index of its file and continues with the next file as soon as
+ *              the current one is parsed, so the workers never wait between
+ *              two files. Additionally the kernel is asked to read ahead the
+ *              next file while the current one is parsed. Each worker adds
+ *              its reads to thread local counters. When it takes a batch of
+ *              a new file, the counters of the previous file are added to the
+ *              counters of that file, so only num_threads + (number of files)
+ *              counters are allocated.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ComputeMatricesBatch_h
+#define _ComputeMatricesBatch_h
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <assert.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "ConcurrentQueue.h"
+#include "QualityInput.h"
+#include "Problems.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    struct BatchFile {
+        string inputfile;
+        int    numberOfSequences;
+    };
+
+    // quality lines of consecutive reads of one input file
+    struct FileBatch {
+        int            fileIndex;
+        vector<string> lines;
+    };
+
+    // number of reads per batch in the queue
+    const int fileBatchSize = 256;
+
+    vector<BatchFile> readBatchList(const string& listfile) {
+        ifstream in(listfile, ios::in);
+        if (!in) {
+            throw runtime_error("cannot open " + listfile);
+        }
+        vector<BatchFile> files;
+        string line;
+        while (getline(in, line)) {
+            stringstream fields(line);
+            BatchFile f;
+            if (!(fields >> f.inputfile)) {
+                continue; // empty line
+            }
+            if (!(fields >> f.numberOfSequences)) {
+                throw runtime_error("missing number of reads for " + f.inputfile + " in " + listfile);
+            }
+            files.push_back(f);
+        }
+        return files;
+    }
+
+    // ask the kernel to read the file into the page cache in the background
+    void prefetchFile(const string& inputfile) {
+#ifdef POSIX_FADV_WILLNEED
+        int fd = open(inputfile.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+            close(fd);
+        }
+#endif
+    }
+
+    void readBatchFiles(const vector<BatchFile>& files,
+                        ConcurrentQueue<FileBatch*>& q,
+                        atomic<bool>& ready){
+
+        Stats::ThreadScope statsThread("reader");
+        for (size_t f = 0; f < files.size(); f++) {
+            if (f+1 < files.size()) {
+                prefetchFile(files[f+1].inputfile);
+            }
+            QualityLineReader in(files[f].inputfile);
+            for (int z = 0; z < files[f].numberOfSequences; z += fileBatchSize) {
+                FileBatch* batch = new FileBatch;
+                batch->fileIndex = f;
+                batch->lines.resize(min(fileBatchSize, files[f].numberOfSequences - z));
+                {
+                    Stats::Stage parse(Stats::Parse);
+                    for (auto& zeile: batch->lines) {
+                        in.nextQualityLine(zeile);
+                    }
+                }
+
+                // same limit of buffered reads as in readFromFASTQFile
+                while (q.size() >= 10000 / fileBatchSize){
+                    Stats::Stage wait(Stats::QueueWait);
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                q.push(batch);
+                Stats::queueDepth(q.size() * fileBatchSize);
+            }
+        }
+        // parsing of all input files is completed
+        ready = true;
+
+    }
+
+    // returns the matrix c of problem for each file of files
+    vector<vector<vector<int> > > trimBatch(const vector<BatchFile>& files,
+                                            const Problem& problem,
+                                            const int& num_threads)
+    {
+        const int lengthOfSequence = problem.lengthOfSequence;
+        for (const auto& f: files) {
+            QualityInput::checkQualityStore(f.inputfile, f.numberOfSequences, lengthOfSequence);
+        }
+
+        // counters per file, filled by the workers when they leave a file
+        vector<unique_ptr<RowCounters> > fileCounters(files.size());
+        vector<unique_ptr<mutex> > fileMutex(files.size());
+        for (size_t f = 0; f < files.size(); f++) {
+            fileCounters[f].reset(new RowCounters(lengthOfSequence));
+            fileMutex[f].reset(new mutex);
+        }
+
+        ConcurrentQueue<FileBatch*> q;
+        atomic<bool> ready(false);
+
+        std::thread readerThread(std::bind(&readBatchFiles, std::cref(files), std::ref(q), std::ref(ready)));
+
+        vector<thread> threads(num_threads);
+        for (int th = 0; th < num_threads; th++){
+            threads[th] = thread([&]() {
+                Stats::ThreadScope statsThread("worker");
+                Kernel kernel = problem.makeKernel();
+                RowCounters counters(lengthOfSequence);
+                int currentFile = -1;
+                auto flush = [&]() {
+                    if (currentFile >= 0) {
+                        Stats::Stage reduction(Stats::Reduction);
+                        lock_guard<mutex> lock(*fileMutex[currentFile]);
+                        fileCounters[currentFile]->add(counters);
+                        counters.clear();
+                    }
+                };
+                while (!ready || !q.empty()){
+                    FileBatch* batch = nullptr;
+                    if (!q.tryPop(batch)){
+                        Stats::Stage wait(Stats::QueueWait);
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        continue;
+                    }
+                    assert (batch != nullptr);
+                    if (batch->fileIndex != currentFile) {
+                        flush();
+                        currentFile = batch->fileIndex;
+                    }
+                    {
+                        Stats::Stage kernelStage(Stats::Kernel);
+                        for (const auto& zeile: batch->lines) {
+                            kernel(zeile, counters);
+                        }
+                        Stats::addReads(batch->lines.size());
+                    }
+                    delete batch;
+                }
+                flush();
+            });
+        }
+
+        // wait for all threads
+        readerThread.join();
+        std::for_each(threads.begin(), threads.end(),
+                      std::mem_fn(&std::thread::join));
+
+        vector<vector<vector<int> > > cs;
+        Stats::Stage prefix(Stats::Prefix);
+        for (size_t f = 0; f < files.size(); f++) {
+            cs.push_back(problem.finalize(*fileCounters[f]));
+            fileCounters[f].reset();
+        }
+        return cs;
+    }
+
+}
+
+#endif
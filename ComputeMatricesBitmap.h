@@ -0,0 +1,284 @@
+/*******************************************************************************
+ *
+ * ComputeMatricesBitmap.h
+ *
+ * DESCRIPTION: Implementation of the algorithms for the problems:
+ *              0-zeros:   trimZeroOneBitmap
+ *              z-zeros:   trimZeroOneZerosAllowedBitmap
+ *              p-percent: trimZeroOnePercentZerosAllowedBitmap
+ *              on reads that are packed into 0/1 bitmaps (see ZeroOneBitmap.h).
+ *              The input is a memory-mapped bitmap, so the reads can be split
+ *              into num_threads contiguous ranges without a reading thread.
+ *              Each range accumulates its own counters (cT, cC or c), the
+ *              counters are added and converted into c only once at the end.
+ *
+ * RUNTIMES: If the input has r reads of length l:
+ *           0-zeros:   worst-case: O( r * l/64 + l^2 )
+ *           z-zeros:   worst-case: O( r * l + l^2 )
+ *           p-percent: worst-case: O( r * l^2 )   expected: O( r * l )
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ComputeMatricesBitmap_h
+#define _ComputeMatricesBitmap_h
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+
+#include "ZeroOneBitmap.h"
+#include "Criteria.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    // c += matrix induced by the triangle counters cT:
+    // cT(i,j)=m means, there are m lines where a 1-block starts at i & ends at j
+    template <typename Counter>
+    void addTriangleCounts(const vector<vector<Counter> >& cT,
+                           vector<vector<Counter> >& c,
+                           const int& lengthOfSequence)
+    {
+        vector<vector<Counter> > c_aux (lengthOfSequence, vector<Counter>(lengthOfSequence,0));
+        vector<Counter> columnSumAbove (lengthOfSequence,0);
+        // first fill the last column of c_aux
+        c_aux[0][lengthOfSequence-1] = cT[0][lengthOfSequence-1];
+        for (int i=1; i < lengthOfSequence; i++){
+            c_aux[i][lengthOfSequence-1] = cT[i][lengthOfSequence-1] + c_aux[i-1][lengthOfSequence-1];
+        }
+        // next fill the first row of c_aux
+        for (int j=lengthOfSequence-2; j>= 0; j--){
+            c_aux[0][j] = cT[0][j] + c_aux[0][j+1];
+            columnSumAbove[j] = cT[0][j];
+        }
+        // now fill the rest
+        for (int i=1; i < lengthOfSequence; i++){
+            for (int j=lengthOfSequence-2; j>= i; j--){
+                c_aux[i][j] = cT[i][j] + c_aux[i][j+1] + columnSumAbove[j];
+                columnSumAbove[j] += cT[i][j];
+            }
+        }
+        // add c and c_aux
+        for (int i = 0; i < lengthOfSequence; i++) {
+            for (int j = i; j < lengthOfSequence; j++) {
+                c[i][j] += c_aux[i][j];
+            }
+        }
+    }
+
+    // c += matrix induced by the column counters cC:
+    // c(i,j) = cC(0,j) + ... + cC(i,j)
+    template <typename Counter>
+    void addColumnCounts(const vector<vector<Counter> >& cC,
+                         vector<vector<Counter> >& c,
+                         const int& lengthOfSequence)
+    {
+        for (int j = 0; j < lengthOfSequence; j++) {
+            Counter columnSum = 0;
+            for (int i = 0; i <= j; i++) {
+                columnSum += cC[i][j];
+                c[i][j] += columnSum;
+            }
+        }
+    }
+
+    // a += b for the upper triangles of two (l x l) matrices
+    template <typename Counter>
+    void addMatrix(vector<vector<Counter> >& a,
+                   const vector<vector<Counter> >& b,
+                   const int& lengthOfSequence)
+    {
+        for (int i = 0; i < lengthOfSequence; i++) {
+            for (int j = i; j < lengthOfSequence; j++) {
+                a[i][j] += b[i][j];
+            }
+        }
+    }
+
+    // calls processRange(first, last, th) for num_threads contiguous ranges of
+    // the reads 0..numberOfSequences-1 in parallel (th = index of the range).
+    // num_threads == 0 means: one range in the calling thread.
+    void forEachReadRange(const int& numberOfSequences,
+                          const int& num_threads,
+                          function<void(int,int,int)> processRange)
+    {
+        // the range of reads is processed by one kernel call
+        auto timedRange = [&](int first, int last, int th) {
+            Stats::Stage kernel(Stats::Kernel);
+            processRange(first, last, th);
+            Stats::addReads(last - first);
+        };
+        if (num_threads == 0) {
+            timedRange(0, numberOfSequences, 0);
+            return;
+        }
+        vector<thread> threads(num_threads);
+        for (int th = 0; th < num_threads; th++) {
+            int first = (int) (((long long) numberOfSequences * th) / num_threads);
+            int last  = (int) (((long long) numberOfSequences * (th+1)) / num_threads);
+            threads[th] = thread([=, &timedRange]() {
+                Stats::ThreadScope statsThread("worker");
+                timedRange(first, last, th);
+            });
+        }
+        for (auto& t: threads) {
+            t.join();
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    // per read kernels on packed reads
+
+    // z-zeros: for the i-th window of k consecutive zeros, the block of "only
+    // ones and at most k zeros" reaches from the zero before the window to the
+    // zero after the window (exclusive)
+    inline void addZerosAllowedRowBits(const uint64_t* g,
+                                       const int& lengthOfSequence,
+                                       const int& numberOfAllowedZerosPerSequence,
+                                       vector<vector<int> >& cC,
+                                       vector<int>& positionsOfZeros)
+    {
+        int numberOfZerosInCurrentRow = 0;
+        for (int i = ZeroOneBitmap::nextZero(g, lengthOfSequence, 0); i < lengthOfSequence;
+             i = ZeroOneBitmap::nextZero(g, lengthOfSequence, i+1)) {
+            positionsOfZeros[numberOfZerosInCurrentRow++] = i;
+        }
+
+        if (numberOfZerosInCurrentRow <= numberOfAllowedZerosPerSequence) {
+            for (int j=0; j < lengthOfSequence; j++)
+                cC[0][j]++;
+            return;
+        }
+        int previousBlock = -1;
+        for (int i = 0; i <= numberOfZerosInCurrentRow-numberOfAllowedZerosPerSequence; i++) {
+            int leftBorderOneBlock  = (i == 0) ? 0 : positionsOfZeros[i-1] + 1;
+            if (leftBorderOneBlock == lengthOfSequence) {
+                break; // k == 0 and a zero at the end of the read: no block after it
+            }
+            int rightBorderOneBlock = (i + numberOfAllowedZerosPerSequence < numberOfZerosInCurrentRow)
+                                    ? positionsOfZeros[i+numberOfAllowedZerosPerSequence] - 1
+                                    : lengthOfSequence - 1;
+            for (int j= previousBlock+1; j <=rightBorderOneBlock; j++) {
+                cC[leftBorderOneBlock][j]++;
+            }
+            previousBlock = rightBorderOneBlock;
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+
+    // 0-zeros
+    vector<vector<int> > trimZeroOneBitmap(const ZeroOneBitmap::Reader& bitmap,
+                                           const int& numberOfSequences,
+                                           const int& lengthOfSequence,
+                                           const int& num_threads)
+    {
+        int ranges = max(1, num_threads);
+        vector<vector<vector<int> > > cT (ranges, vector<vector<int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+
+        forEachReadRange(numberOfSequences, num_threads, [&](int first, int last, int th) {
+            for (int z = first; z < last; z++) {
+                addZeroOneRowBits(bitmap.read(z), lengthOfSequence, cT[th]);
+            }
+        });
+
+        {
+            Stats::Stage reduction(Stats::Reduction);
+            for (int th = 1; th < ranges; th++) {
+                addMatrix(cT[0], cT[th], lengthOfSequence);
+            }
+        }
+        vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
+        Stats::Stage prefix(Stats::Prefix);
+        addTriangleCounts(cT[0], c, lengthOfSequence);
+        return c;
+    }
+
+    // z-zeros
+    vector<vector<int> > trimZeroOneZerosAllowedBitmap(const ZeroOneBitmap::Reader& bitmap,
+                                                       const int& numberOfSequences,
+                                                       const int& lengthOfSequence,
+                                                       const int& numberOfAllowedZerosPerSequence,
+                                                       const int& num_threads)
+    {
+        int ranges = max(1, num_threads);
+        vector<vector<vector<int> > > cC (ranges, vector<vector<int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+
+        forEachReadRange(numberOfSequences, num_threads, [&](int first, int last, int th) {
+            vector<int> positionsOfZeros(lengthOfSequence,0);
+            for (int z = first; z < last; z++) {
+                addZerosAllowedRowBits(bitmap.read(z), lengthOfSequence,
+                                       numberOfAllowedZerosPerSequence, cC[th], positionsOfZeros);
+            }
+        });
+
+        {
+            Stats::Stage reduction(Stats::Reduction);
+            for (int th = 1; th < ranges; th++) {
+                for (int i = 0; i < lengthOfSequence; i++) {
+                    for (int j = 0; j < lengthOfSequence; j++) {
+                        cC[0][i][j] += cC[th][i][j];
+                    }
+                }
+            }
+        }
+        vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
+        Stats::Stage prefix(Stats::Prefix);
+        addColumnCounts(cC[0], c, lengthOfSequence);
+        return c;
+    }
+
+    // 1-block problems on the cached reads with criterion (chosen by
+    // withFixedLength)
+    struct TrimCriterionBitmap {
+        const ZeroOneBitmap::Reader& bitmap;
+        const int&                   numberOfSequences;
+        const int&                   num_threads;
+
+        template <typename Criterion>
+        vector<vector<int> > operator()(const Criterion& criterion) const {
+            const int lengthOfSequence = criterion.length();
+            int ranges = max(1, num_threads);
+            vector<vector<vector<int> > > c (ranges, vector<vector<int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+            vector<vector<vector<int> > > cT (ranges, vector<vector<int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+
+            forEachReadRange(numberOfSequences, num_threads, [&](int first, int last, int th) {
+                Criterion ownCriterion = criterion;
+                for (int z = first; z < last; z++) {
+                    addCriterionRowBits(bitmap.read(z), ownCriterion, c[th], cT[th]);
+                }
+            });
+
+            {
+                Stats::Stage reduction(Stats::Reduction);
+                for (int th = 1; th < ranges; th++) {
+                    addMatrix(c[0], c[th], lengthOfSequence);
+                    addMatrix(cT[0], cT[th], lengthOfSequence);
+                }
+            }
+            Stats::Stage prefix(Stats::Prefix);
+            addTriangleCounts(cT[0], c[0], lengthOfSequence);
+            return c[0];
+        }
+    };
+
+    // p-percent
+    vector<vector<int> > trimZeroOnePercentZerosAllowedBitmap(const ZeroOneBitmap::Reader& bitmap,
+                                                              const int& numberOfSequences,
+                                                              const int& lengthOfSequence,
+                                                              const double& percentOfAllowedZerosPerSequence,
+                                                              const int& num_threads)
+    {
+        // the 0/1 bitmap has the threshold already applied
+        TrimCriterionBitmap trim = {bitmap, numberOfSequences, num_threads};
+        return withFixedLength<PercentCriterion>(trim, lengthOfSequence, percentOfAllowedZerosPerSequence, 0);
+    }
+
+}
+
+#endif
@@ -0,0 +1,468 @@
+/*******************************************************************************
+ *
+ * ComputeMatricesGroups.h
+ *
+ * DESCRIPTION: Group-by mode: separate matrices c for groups of reads (e.g.
+ *              per tile of the flowcell or per sample barcode) in the same
+ *              pass over the FASTQ file, without splitting the file first.
+ *              groupFields: parses the --groupby text, e.g. "tile" or
+ *                           "lane,index"
+ *              groupKey:    the group of a read from its Illumina header
+ *                  CASAVA 1.8:  @<instrument>:<run>:<flowcell>:<lane>:<tile>:<x>:<y> <read>:<filtered>:<control>:<index>
+ *                  older:       @<instrument>:<lane>:<tile>:<x>:<y>#<index>/<read>
+ *                  flowcell, lane, index: the field of the header
+ *                  tile: "<lane>:<tile>" (the numbers of the tiles repeat in
+ *                        each lane)
+ *                  several fields are joined by ':', a missing field is
+ *                  "unknown"
+ *              trimGroups:  the matrix c of each problem (see Problems.h) for
+ *                           each group, sorted by the group key
+ *              splitGroupResults: the matrices of one problem for the output
+ *                           num_threads == 0: sequential
+ *                           num_threads >  0: one reading thread (it extracts
+ *                           the group keys) and num_threads workers
+ *
+ *              The workers add the reads to counters of their own, the
+ *              reads of a batch are added group by group. A worker keeps the
+ *              counters of up to maxOpenGroups groups, so interleaved groups
+ *              (e.g. the barcodes of a multiplexed lane) do not cost anything
+ *              per change of the group. The counters of the least recently
+ *              used group (and at the end all of them) are added to the sums
+ *              of the group, the counters of a new group are moved there. The
+ *              matrices c are computed once per group from the sums (like the
+ *              files of the batch mode). A group needs 2 l^2 ints per problem
+ *              (about 80 KB for l = 101), so thousands of tiles fit into
+ *              memory.
+ *
+ * RUNTIMES: as the kernels, plus O( l^2 ) per group and worker
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ComputeMatricesGroups_h
+#define _ComputeMatricesGroups_h
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <assert.h>
+
+#include "ConcurrentQueue.h"
+#include "QualityInput.h"
+#include "ComputeMatricesBatch.h" // fileBatchSize
+#include "Problems.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    const vector<string> groupFieldNames = {"flowcell", "lane", "tile", "index"};
+
+    // groups whose counters a thread keeps at the same time (2 l^2 ints per
+    // group and problem)
+    const size_t maxOpenGroups = 128;
+
+    enum GroupField { Flowcell, Lane, Tile, Index };
+
+    // "tile" or "lane,index" -> fields
+    vector<GroupField> groupFields(const string& text) {
+        vector<GroupField> fields;
+        stringstream names(text);
+        string name;
+        while (getline(names, name, ',')) {
+            auto it = find(groupFieldNames.begin(), groupFieldNames.end(), name);
+            if (it == groupFieldNames.end()) {
+                throw runtime_error("unknown field \"" + name + "\" for the group-by mode");
+            }
+            fields.push_back((GroupField) (it - groupFieldNames.begin()));
+        }
+        if (fields.empty()) {
+            throw runtime_error("no field for the group-by mode");
+        }
+        return fields;
+    }
+
+    // splits text[begin,end) at sep
+    inline vector<string> splitHeader(const string& text, size_t begin, size_t end, const char& sep) {
+        vector<string> parts;
+        while (begin <= end) {
+            size_t next = text.find(sep, begin);
+            if (next == string::npos || next > end) next = end;
+            parts.push_back(text.substr(begin, next - begin));
+            begin = next + 1;
+        }
+        return parts;
+    }
+
+    string groupKey(const string& header, const vector<GroupField>& fields) {
+        size_t start = (!header.empty() && header[0] == '@') ? 1 : 0;
+        size_t space = header.find_first_of(" \t", start);
+        size_t end   = (space == string::npos) ? header.size() : space;
+        vector<string> name = splitHeader(header, start, end, ':');
+        string flowcell, lane, tile, index;
+        if (name.size() >= 7) {// CASAVA 1.8
+            flowcell = name[2];
+            lane     = name[3];
+            tile     = name[4];
+            if (space != string::npos) {
+                vector<string> comment = splitHeader(header, space + 1, header.size(), ':');
+                if (comment.size() >= 4) index = comment[3];
+            }
+        } else if (name.size() == 5) {// older Illumina headers
+            lane = name[1];
+            tile = name[2];
+            size_t hash = name[4].find('#');
+            if (hash != string::npos) {
+                index = name[4].substr(hash + 1, name[4].find('/', hash) - hash - 1);
+            }
+        }
+        string key;
+        for (size_t f = 0; f < fields.size(); f++) {
+            string value;
+            switch (fields[f]) {
+                case Flowcell: value = flowcell; break;
+                case Lane:     value = lane;     break;
+                case Tile:     value = (lane == "" || tile == "") ? "" : lane + ":" + tile; break;
+                case Index:    value = index;    break;
+            }
+            if (f > 0) key += ':';
+            key += (value == "") ? "unknown" : value;
+        }
+        return key;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+
+    struct GroupResult {
+        string                        key;
+        int                           reads;
+        vector<vector<vector<int> > > cs; // matrix c of each problem
+    };
+
+    // group keys and quality lines of consecutive reads
+    struct GroupBatch {
+        vector<string> keys;
+        vector<string> lines;
+    };
+
+    // sums of the counters of all groups
+    class GroupSums {
+    public:
+        GroupSums(const vector<Problem>& problems) : problems_(problems) {}
+
+        // adds the counters (one per problem) of reads reads of group key,
+        // the counters of a new group are moved into the sums
+        void add(const string& key, const int& reads, vector<RowCounters>& counters) {
+            Group* g;
+            {
+                lock_guard<mutex> lock(m_);
+                unique_ptr<Group>& entry = groups_[key];
+                if (!entry) {
+                    entry.reset(new Group);
+                    entry->reads    = reads;
+                    entry->counters = std::move(counters);
+                    return;
+                }
+                g = entry.get();
+            }
+            lock_guard<mutex> lock(g->m);
+            g->reads += reads;
+            for (size_t k = 0; k < problems_.size(); k++) {
+                g->counters[k].add(counters[k]);
+            }
+        }
+
+        // full matrices, sorted by key
+        vector<GroupResult> results() const {
+            vector<GroupResult> results;
+            for (const auto& entry: groups_) {
+                results.push_back(result(entry.first, *entry.second));
+            }
+            return results;
+        }
+
+        // reads of group key that were added so far
+        int reads(const string& key) {
+            lock_guard<mutex> lock(m_);
+            auto it = groups_.find(key);
+            if (it == groups_.end()) return 0;
+            lock_guard<mutex> groupLock(it->second->m);
+            return it->second->reads;
+        }
+
+        // full matrices of group key, removes the group
+        GroupResult take(const string& key) {
+            unique_ptr<Group> g;
+            {
+                lock_guard<mutex> lock(m_);
+                auto it = groups_.find(key);
+                if (it != groups_.end()) {
+                    g = std::move(it->second);
+                    groups_.erase(it);
+                }
+            }
+            if (!g) {
+                g.reset(new Group);
+                g->reads = 0;
+                for (const auto& p: problems_) {
+                    g->counters.push_back(RowCounters(p.lengthOfSequence));
+                }
+            }
+            return result(key, *g);
+        }
+
+    private:
+        struct Group {
+            mutex               m;
+            int                 reads;
+            vector<RowCounters> counters; // per problem
+        };
+
+        // the counters are finalized once per group
+        GroupResult result(const string& key, const Group& g) const {
+            GroupResult r;
+            r.key   = key;
+            r.reads = g.reads;
+            for (size_t k = 0; k < problems_.size(); k++) {
+                r.cs.push_back(problems_[k].finalize(g.counters[k]));
+            }
+            return r;
+        }
+
+        const vector<Problem>&          problems_;
+        map<string, unique_ptr<Group> > groups_;
+        mutex                           m_;
+    };
+
+    // counters of one thread for the groups it works on. The counters of a
+    // group stay with the thread until more than maxOpenGroups groups are
+    // open (then the least recently used group is added to the sums) or
+    // flush is called.
+    struct GroupCounters {
+        struct OpenGroup {
+            int                 reads;
+            long long           lastUsed;
+            vector<RowCounters> counters; // per problem
+        };
+
+        const vector<Problem>&   problems;
+        const size_t             maxOpenGroups;
+        vector<Kernel>           kernels;
+        map<string, OpenGroup>   open;
+        long long                batches;
+
+        GroupCounters(const vector<Problem>& problems, const size_t& maxOpenGroups)
+        : problems(problems), maxOpenGroups(maxOpenGroups), batches(0) {
+            for (const auto& p: problems) {
+                kernels.push_back(p.makeKernel());
+            }
+        }
+
+        void flush(GroupSums& sums) {
+            if (open.empty()) return;
+            Stats::Stage reduction(Stats::Reduction);
+            for (auto& entry: open) {
+                sums.add(entry.first, entry.second.reads, entry.second.counters);
+            }
+            open.clear();
+        }
+
+        // counters of group key, opened on demand
+        OpenGroup& group(const string& key, GroupSums& sums) {
+            auto it = open.find(key);
+            if (it != open.end()) {
+                return it->second;
+            }
+            if (open.size() >= maxOpenGroups) {
+                Stats::Stage reduction(Stats::Reduction);
+                auto lru = open.begin();
+                for (auto o = open.begin(); o != open.end(); ++o) {
+                    if (o->second.lastUsed < lru->second.lastUsed) lru = o;
+                }
+                sums.add(lru->first, lru->second.reads, lru->second.counters);
+                open.erase(lru);
+            }
+            OpenGroup& g = open[key];
+            g.reads = 0;
+            for (const auto& p: problems) {
+                g.counters.push_back(RowCounters(p.lengthOfSequence));
+            }
+            return g;
+        }
+
+        // adds the reads of the batch group by group
+        void addBatch(const GroupBatch& batch, GroupSums& sums) {
+            batches++;
+            vector<pair<string, vector<int> > > buckets;
+            map<string, size_t> bucketOf;
+            size_t b = 0;
+            for (size_t z = 0; z < batch.keys.size(); z++) {
+                if (z == 0 || batch.keys[z] != batch.keys[z-1]) {// runs of reads of the same group
+                    auto it = bucketOf.find(batch.keys[z]);
+                    if (it == bucketOf.end()) {
+                        it = bucketOf.insert(make_pair(batch.keys[z], buckets.size())).first;
+                        buckets.push_back(make_pair(batch.keys[z], vector<int>()));
+                    }
+                    b = it->second;
+                }
+                buckets[b].second.push_back(z);
+            }
+            for (const auto& bucket: buckets) {
+                OpenGroup& g = group(bucket.first, sums);
+                g.lastUsed = batches;
+                Stats::Stage kernel(Stats::Kernel);
+                for (const int& z: bucket.second) {
+                    for (size_t k = 0; k < kernels.size(); k++) {
+                        kernels[k](batch.lines[z], g.counters[k]);
+                    }
+                }
+                g.reads += bucket.second.size();
+            }
+            Stats::addReads(batch.keys.size());
+        }
+    };
+
+    // reads the next batch of numberOfSequences reads (at most fileBatchSize)
+    void readGroupBatch(QualityLineReader& in,
+                        const vector<GroupField>& fields,
+                        const int& numberOfSequences,
+                        GroupBatch& batch,
+                        string& header)
+    {
+        Stats::Stage parse(Stats::Parse);
+        batch.keys.resize(numberOfSequences);
+        batch.lines.resize(numberOfSequences);
+        for (int z = 0; z < numberOfSequences; z++) {
+            in.nextRecord(header, batch.lines[z]);
+            batch.keys[z] = groupKey(header, fields);
+        }
+    }
+
+    void readGroupBatches(const string& inputfile,
+                          const int& numberOfSequences,
+                          const vector<GroupField>& fields,
+                          ConcurrentQueue<GroupBatch*>& q,
+                          atomic<bool>& ready){
+
+        Stats::ThreadScope statsThread("reader");
+        QualityLineReader in(inputfile);
+        string header;
+        for (int z = 0; z < numberOfSequences; z += fileBatchSize) {
+            GroupBatch* batch = new GroupBatch;
+            readGroupBatch(in, fields, min(fileBatchSize, numberOfSequences - z), *batch, header);
+
+            // same limit of buffered reads as in readFromFASTQFile
+            while (q.size() >= 10000 / fileBatchSize){
+                Stats::Stage wait(Stats::QueueWait);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            q.push(batch);
+            Stats::queueDepth(q.size() * fileBatchSize);
+        }
+        // parsing of the file is completed
+        ready = true;
+
+    }
+
+    // worker thread: adds the batches of q to sums. With flushWhileIdle the
+    // counters are also added to the sums while q is empty, so the sums of a
+    // group are complete as soon as all of its reads are processed.
+    void addGroupBatches(ConcurrentQueue<GroupBatch*>& q,
+                         const atomic<bool>& ready,
+                         const vector<Problem>& problems,
+                         GroupSums& sums,
+                         const size_t& maxOpenGroups,
+                         const bool& flushWhileIdle)
+    {
+        Stats::ThreadScope statsThread("worker");
+        GroupCounters own(problems, maxOpenGroups);
+        while (!ready || !q.empty()){
+            GroupBatch* batch = nullptr;
+            if (!q.tryPop(batch)){
+                if (flushWhileIdle) {
+                    own.flush(sums);
+                }
+                Stats::Stage wait(Stats::QueueWait);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            assert (batch != nullptr);
+            own.addBatch(*batch, sums);
+            delete batch;
+        }
+        own.flush(sums);
+    }
+
+    // returns the matrix c of each problem for each group of reads
+    vector<GroupResult> trimGroups(const string& inputfile,
+                                   const int& numberOfSequences,
+                                   const vector<Problem>& problems,
+                                   const vector<GroupField>& fields,
+                                   const int& num_threads)
+    {
+        if (QualityStore::isQualityStore(inputfile)) {
+            throw runtime_error("a quality store has no header lines, the group-by mode needs the FASTQ file");
+        }
+        GroupSums sums(problems);
+
+        if (num_threads == 0) {// sequential mode
+            GroupCounters own(problems, maxOpenGroups);
+            QualityLineReader in(inputfile);
+            GroupBatch batch;
+            string header;
+            for (int z = 0; z < numberOfSequences; z += fileBatchSize) {
+                readGroupBatch(in, fields, min(fileBatchSize, numberOfSequences - z), batch, header);
+                own.addBatch(batch, sums);
+            }
+            own.flush(sums);
+        } else {// parallel mode
+            ConcurrentQueue<GroupBatch*> q;
+            atomic<bool> ready(false);
+
+            std::thread readerThread(std::bind(&readGroupBatches, std::cref(inputfile), numberOfSequences,
+                                               std::cref(fields), std::ref(q), std::ref(ready)));
+
+            vector<thread> threads(num_threads);
+            for (int th = 0; th < num_threads; th++){
+                threads[th] = thread(std::bind(&addGroupBatches, std::ref(q), std::ref(ready),
+                                               std::cref(problems), std::ref(sums), maxOpenGroups, false));
+            }
+
+            // wait for all threads
+            readerThread.join();
+            std::for_each(threads.begin(), threads.end(),
+                          std::mem_fn(&std::thread::join));
+        }
+
+        Stats::Stage prefix(Stats::Prefix);
+        return sums.results();
+    }
+
+    // keys, reads and the matrices of problem k of groups (for
+    // printGroupResults of Results.h)
+    void splitGroupResults(const vector<GroupResult>& groups,
+                           const size_t& k,
+                           vector<string>& keys,
+                           vector<int>& rows,
+                           vector<vector<vector<int> > >& cs)
+    {
+        for (const auto& g: groups) {
+            keys.push_back(g.key);
+            rows.push_back(g.reads);
+            cs.push_back(g.cs[k]);
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*******************************************************************************
+ *
+ * ComputeMatricesMemory.h
+ *
+ * DESCRIPTION: A problem (see Problems.h) on reads that are held in memory as
+ *              a quality store (see QualityStore::InMemory), e.g. by
+ *              trimServer, which answers many queries on the same lane.
+ *              trimInMemory: the matrix c of the problem, the reads are split
+ *                            into num_threads ranges of consecutive reads,
+ *                            each thread decodes its reads and adds them to
+ *                            counters of its own
+ *
+ * RUNTIMES: as the kernel of the problem, divided by num_threads, plus
+ *           O( num_threads * l^2 ) to add the counters
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ComputeMatricesMemory_h
+#define _ComputeMatricesMemory_h
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <algorithm>
+
+#include "QualityStore.h"
+#include "Problems.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    vector<vector<int> > trimInMemory(const QualityStore::InMemory& reads,
+                                      const Problem& problem,
+                                      const int& num_threads)
+    {
+        const uint64_t n = reads.header().numberOfReads;
+        const int threads = max(1, num_threads);
+        vector<unique_ptr<RowCounters> > counters;
+        for (int th = 0; th < threads; th++) {
+            counters.emplace_back(new RowCounters(problem.lengthOfSequence));
+        }
+
+        vector<thread> workers(threads);
+        for (int th = 0; th < threads; th++) {
+            workers[th] = thread([&, th]() {
+                Kernel kernel = problem.makeKernel();
+                string zeile;
+                for (uint64_t z = n * th / threads; z < n * (th + 1) / threads; z++) {
+                    reads.decodeRead(z, zeile);
+                    kernel(zeile, *counters[th]);
+                }
+            });
+        }
+        std::for_each(workers.begin(), workers.end(),
+                      std::mem_fn(&std::thread::join));
+
+        for (int th = 1; th < threads; th++) {
+            counters[0]->add(*counters[th]);
+        }
+        return problem.finalize(*counters[0]);
+    }
+
+}
+
+#endif
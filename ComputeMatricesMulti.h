@@ -0,0 +1,216 @@
+/*******************************************************************************
+ *
+ * ComputeMatricesMulti.h
+ *
+ * DESCRIPTION: Several problems (see Problems.h) on one input file in a single
+ *              pass: every quality line is parsed once and added by the kernels
+ *              of all problems, one after the other while the line is in the
+ *              cache. Used by trimAllCriteria for QC reports that need 0-zeros,
+ *              z-zeros, p-percent and m-mean (with any parameters) of one lane.
+ *              parseCriterion: a problem given as text, e.g. "m-mean:m=25"
+ *              trimProblems:   the matrix c of each problem
+ *                              num_threads == 0: sequential
+ *                              num_threads >  0: one reading thread (as in the
+ *                              batch mode) and num_threads workers with
+ *                              counters of their own for each problem
+ *
+ * RUNTIMES: the sum of the runtimes of the kernels, the input is read once
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ComputeMatricesMulti_h
+#define _ComputeMatricesMulti_h
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cmath>
+#include <assert.h>
+
+#include "ConcurrentQueue.h"
+#include "ComputeMatrices.h"      // forEachQualityLine
+#include "ComputeMatricesBatch.h" // readBatchFiles
+#include "Problems.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    // names and parameters of the problems for parseCriterion
+    const vector<string> criteria = {"0-zeros:t=<threshold>",
+                                     "z-zeros:z=<zeros>,t=<threshold>",
+                                     "p-percent:p=<percent>,t=<threshold>",
+                                     "m-mean:m=<mean>"};
+
+    // "<problem>:<name>=<value>,..." -> Problem, all parameters of the problem
+    // are required, t and z are integers (z <= lengthOfSequence)
+    Problem parseCriterion(const string& text,
+                           const int& lengthOfSequence,
+                           const int& shiftToConvertChars)
+    {
+        size_t colon = text.find(':');
+        string name = text.substr(0, colon);
+        map<string, double> values;
+        if (colon != string::npos) {
+            stringstream fields(text.substr(colon + 1));
+            string field;
+            while (getline(fields, field, ',')) {
+                size_t eq = field.find('=');
+                double value;
+                stringstream number(eq == string::npos ? "" : field.substr(eq + 1));
+                if (!(number >> value) || !number.eof()) {
+                    throw runtime_error("invalid parameter \"" + field + "\" in \"" + text + "\"");
+                }
+                values[field.substr(0, eq)] = value;
+            }
+        }
+        auto needs = [&](const vector<string>& parameters) {
+            for (const auto& p: parameters) {
+                if (values.count(p) == 0) {
+                    throw runtime_error("missing parameter " + p + " in \"" + text + "\"");
+                }
+            }
+            if (values.size() != parameters.size()) {
+                throw runtime_error("unknown parameter in \"" + text + "\"");
+            }
+        };
+        // an integer parameter in [min,max]
+        auto integer = [&](const string& p, const int& min, const int& max) {
+            const double value = values[p];
+            if (!(value >= min && value <= max) || value != floor(value)) {
+                throw runtime_error(p + " must be an integer in [" + to_string(min) + ","
+                                    + to_string(max) + "] in \"" + text + "\"");
+            }
+            return (int) value;
+        };
+        if (name == "0-zeros") {
+            needs({"t"});
+            return zeroOneProblem(lengthOfSequence, integer("t", 0, 255), shiftToConvertChars);
+        }
+        if (name == "z-zeros") {
+            needs({"z", "t"});
+            return zerosAllowedProblem(lengthOfSequence, integer("z", 0, lengthOfSequence),
+                                       integer("t", 0, 255), shiftToConvertChars);
+        }
+        if (name == "p-percent") {
+            needs({"p", "t"});
+            if (!(values["p"] >= 0 && values["p"] <= 1)) {
+                throw runtime_error("p must be in [0,1] in \"" + text + "\"");
+            }
+            return percentZerosAllowedProblem(lengthOfSequence, values["p"], integer("t", 0, 255),
+                                              shiftToConvertChars);
+        }
+        if (name == "m-mean") {
+            needs({"m"});
+            if (!std::isfinite(values["m"])) {
+                throw runtime_error("m must be a number in \"" + text + "\"");
+            }
+            return meanProblem(lengthOfSequence, values["m"], shiftToConvertChars);
+        }
+        throw runtime_error("unknown problem \"" + name + "\" in \"" + text + "\"");
+    }
+
+    // kernels and counters of all problems for one thread
+    struct MultiCounters {
+        vector<Kernel>      kernels;
+        vector<RowCounters> counters;
+
+        MultiCounters(const vector<Problem>& problems) {
+            for (const auto& p: problems) {
+                kernels.push_back(p.makeKernel());
+                counters.push_back(RowCounters(p.lengthOfSequence));
+            }
+        }
+
+        void addRow(const string& zeile) {
+            for (size_t k = 0; k < kernels.size(); k++) {
+                kernels[k](zeile, counters[k]);
+            }
+        }
+    };
+
+    // returns the matrix c of each problem of problems
+    vector<vector<vector<int> > > trimProblems(const string& inputfile,
+                                               const int& numberOfSequences,
+                                               const vector<Problem>& problems,
+                                               const int& num_threads)
+    {
+        vector<unique_ptr<MultiCounters> > threadCounters;
+
+        if (num_threads == 0) {// sequential mode
+            threadCounters.emplace_back(new MultiCounters(problems));
+            MultiCounters& own = *threadCounters[0];
+            forEachQualityLine(inputfile, numberOfSequences, [&](const string& zeile) {
+                own.addRow(zeile);
+            });
+        } else {// parallel mode
+            for (int th = 0; th < num_threads; th++) {
+                threadCounters.emplace_back(new MultiCounters(problems));
+            }
+            vector<BatchFile> files = {{inputfile, numberOfSequences}};
+            ConcurrentQueue<FileBatch*> q;
+            atomic<bool> ready(false);
+
+            std::thread readerThread(std::bind(&readBatchFiles, std::cref(files), std::ref(q), std::ref(ready)));
+
+            vector<thread> threads(num_threads);
+            for (int th = 0; th < num_threads; th++){
+                threads[th] = thread([&, th]() {
+                    Stats::ThreadScope statsThread("worker");
+                    MultiCounters& own = *threadCounters[th];
+                    while (!ready || !q.empty()){
+                        FileBatch* batch = nullptr;
+                        if (!q.tryPop(batch)){
+                            Stats::Stage wait(Stats::QueueWait);
+                            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                            continue;
+                        }
+                        assert (batch != nullptr);
+                        {
+                            Stats::Stage kernelStage(Stats::Kernel);
+                            for (const auto& zeile: batch->lines) {
+                                own.addRow(zeile);
+                            }
+                            Stats::addReads(batch->lines.size());
+                        }
+                        delete batch;
+                    }
+                });
+            }
+
+            // wait for all threads
+            readerThread.join();
+            std::for_each(threads.begin(), threads.end(),
+                          std::mem_fn(&std::thread::join));
+
+            // collect the results
+            Stats::Stage reduction(Stats::Reduction);
+            for (int th = 1; th < num_threads; th++) {
+                for (size_t k = 0; k < problems.size(); k++) {
+                    threadCounters[0]->counters[k].add(threadCounters[th]->counters[k]);
+                }
+                threadCounters[th].reset();
+            }
+        }
+
+        vector<vector<vector<int> > > cs;
+        Stats::Stage prefix(Stats::Prefix);
+        for (size_t k = 0; k < problems.size(); k++) {
+            cs.push_back(problems[k].finalize(threadCounters[0]->counters[k]));
+        }
+        return cs;
+    }
+
+}
+
+#endif
@@ -0,0 +1,344 @@
+/*******************************************************************************
+ *
+ * ComputeMatricesPaired.h
+ *
+ * DESCRIPTION: Implementation of the algorithms for paired-end reads:
+ *              0-zeros:   trimZeroOnePaired
+ *              z-zeros:   trimZeroOneZerosAllowedPaired
+ *              p-percent: trimZeroOnePercentZerosAllowedPaired
+ *              m-mean:    trimIntegerMeanPaired
+ *              A pair is selected for the window [l,r] only if both mates
+ *              fulfill the row constraint of the problem in [l,r]. The mates
+ *              are read in lockstep from two FASTQ files (R1 and R2) or one
+ *              after the other from one interleaved file, and the pairs are
+ *              processed by num_threads worker threads.
+ *
+ *              0-zeros, p-percent, m-mean: trimCriterionPaired with the
+ *                         criterion policies of Criteria.h, one per mate.
+ *                         The 1-blocks of the AND of both mates are counted
+ *                         as triangles, all other (l,r) are checked for both
+ *                         mates ([l,r] has only ones in both mates iff it has
+ *                         only ones in the AND, so 0-zeros checks nothing
+ *                         else).
+ *              z-zeros:   for each left border l both mates have a largest
+ *                         right border with at most k zeros, the pair is
+ *                         selected up to the minimum of both.
+ *
+ * RUNTIMES: If the input has r pairs of length l:
+ *           0-zeros:   worst-case: O( r * l )
+ *           z-zeros:   worst-case: O( r * l )
+ *           p-percent: worst-case: O( r * l^2 )
+ *           m-mean:    worst-case: O( r * l^2 )
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ComputeMatricesPaired_h
+#define _ComputeMatricesPaired_h
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <assert.h>
+
+#include "ConcurrentQueue.h"
+#include "QualityInput.h"
+#include "Criteria.h"
+#include "ComputeMatricesBitmap.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    // number of pairs per batch in the queue
+    const int pairBatchSize = 256;
+
+    // reads numberOfPairs pairs of quality lines. If inputfile2 is empty,
+    // inputfile1 is interleaved (mate 1, mate 2, mate 1, ...). The pairs are
+    // pushed in batches: entries 2b and 2b+1 of a batch are the mates of pair b.
+    void readPairsFromFASTQFiles(const string& inputfile1,
+                                 const string& inputfile2,
+                                 const int& numberOfPairs,
+                                 ConcurrentQueue<vector<string>*>& q,
+                                 atomic<bool>& ready){
+
+        Stats::ThreadScope statsThread("reader");
+        QualityLineReader in1(inputfile1);
+        unique_ptr<QualityLineReader> in2;
+        if (inputfile2 != "") {
+            in2.reset(new QualityLineReader(inputfile2));
+        }
+        QualityLineReader& mate2 = in2 ? *in2 : in1;
+
+        for (int z = 0; z < numberOfPairs; z += pairBatchSize) {
+            int pairsInBatch = min(pairBatchSize, numberOfPairs - z);
+            vector<string>* batch = new vector<string>(2 * pairsInBatch);
+            {
+                Stats::Stage parse(Stats::Parse);
+                for (int b = 0; b < pairsInBatch; b++) {
+                    in1.nextQualityLine((*batch)[2*b]);
+                    mate2.nextQualityLine((*batch)[2*b+1]);
+                }
+            }
+
+            // same limit of buffered reads as in readFromFASTQFile
+            while (q.size() >= 10000 / pairBatchSize){
+                Stats::Stage wait(Stats::QueueWait);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            q.push(batch);
+            Stats::queueDepth(q.size() * pairBatchSize);
+        }
+        // parsing of the input files is completed
+        ready = true;
+
+    }
+
+    // runs the reading thread and num_threads workers, worker th calls
+    // processPair(th, mate1, mate2) for each pair it takes from the queue
+    void runPairedPipeline(const string& inputfile1,
+                           const string& inputfile2,
+                           const int& numberOfPairs,
+                           const int& num_threads,
+                           function<void(int,const string&,const string&)> processPair)
+    {
+        ConcurrentQueue<vector<string>*> q;
+        atomic<bool> ready(false);
+
+        std::thread readerThread(std::bind(&readPairsFromFASTQFiles, inputfile1, inputfile2, numberOfPairs, std::ref(q), std::ref(ready)));
+
+        vector<thread> threads(num_threads);
+        for (int th = 0; th < num_threads; th++){
+            threads[th] = thread([&, th]() {
+                Stats::ThreadScope statsThread("worker");
+                while (!ready || !q.empty()){
+                    vector<string>* batch = nullptr;
+                    if (!q.tryPop(batch)){
+                        Stats::Stage wait(Stats::QueueWait);
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        continue;
+                    }
+                    assert (batch != nullptr);
+                    {
+                        Stats::Stage kernel(Stats::Kernel);
+                        for (size_t b = 0; b < batch->size(); b += 2) {
+                            processPair(th, (*batch)[b], (*batch)[b+1]);
+                        }
+                        Stats::addReads(batch->size());
+                    }
+                    delete batch;
+                }
+            });
+        }
+
+        // wait for all threads
+        readerThread.join();
+        std::for_each(threads.begin(), threads.end(),
+                      std::mem_fn(&std::thread::join));
+    }
+
+    // c += matrix induced by the row counters cR:
+    // c(i,j) = cR(i,j) + ... + cR(i,l-1)
+    void addRowCounts(const vector<vector<int> >& cR,
+                      vector<vector<int> >& c,
+                      const int& lengthOfSequence)
+    {
+        for (int i = 0; i < lengthOfSequence; i++) {
+            int rowSum = 0;
+            for (int j = lengthOfSequence-1; j >= i; j--) {
+                rowSum += cR[i][j];
+                c[i][j] += rowSum;
+            }
+        }
+    }
+
+    // reach[l] = largest r such that g[l..r] has at most k zeros (l-1 if
+    // there is none)
+    inline void computeReachZerosAllowed(const uint64_t* g,
+                                         const int& lengthOfSequence,
+                                         const int& numberOfAllowedZerosPerSequence,
+                                         vector<int>& positionsOfZeros,
+                                         vector<int>& reach)
+    {
+        int numberOfZeros = 0;
+        for (int i = ZeroOneBitmap::nextZero(g, lengthOfSequence, 0); i < lengthOfSequence;
+             i = ZeroOneBitmap::nextZero(g, lengthOfSequence, i+1)) {
+            positionsOfZeros[numberOfZeros++] = i;
+        }
+        int firstZero = 0; // index of the first zero >= l
+        for (int l = 0; l < lengthOfSequence; l++) {
+            while (firstZero < numberOfZeros && positionsOfZeros[firstZero] < l) {
+                firstZero++;
+            }
+            reach[l] = (firstZero + numberOfAllowedZerosPerSequence < numberOfZeros)
+                     ? positionsOfZeros[firstZero + numberOfAllowedZerosPerSequence] - 1
+                     : lengthOfSequence - 1;
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+
+    // 0-zeros, p-percent, m-mean: c of the pairs for a criterion of Criteria.h
+    template <typename Criterion>
+    vector<vector<int> > trimCriterionPaired(const string& inputfile1,
+                                             const string& inputfile2,
+                                             const int& numberOfPairs,
+                                             const Criterion& criterion,
+                                             const int& num_threads)
+    {
+        const int lengthOfSequence = criterion.length();
+        const int words = ZeroOneBitmap::wordsPerRead(lengthOfSequence);
+
+        // each thread needs its own copy of the criterion for each mate
+        vector<Criterion> mate1th (num_threads, criterion);
+        vector<Criterion> mate2th (num_threads, criterion);
+        vector<vector<vector<int> > > cth (num_threads, vector<vector<int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+        vector<vector<vector<int> > > cTth (num_threads, vector<vector<int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+        vector<vector<uint64_t> > gth (num_threads, vector<uint64_t>(words));
+
+        runPairedPipeline(inputfile1, inputfile2, numberOfPairs, num_threads,
+                          [&](int th, const string& zeile1, const string& zeile2) {
+            Criterion& mate1 = mate1th[th];
+            Criterion& mate2 = mate2th[th];
+            const uint64_t* g1 = mate1.oneBlocks(zeile1);
+            const uint64_t* g2 = mate2.oneBlocks(zeile2);
+            uint64_t* g = gth[th].data();
+            for (int w = 0; w < words; w++) {
+                g[w] = g1[w] & g2[w];
+            }
+            if (!Criterion::checksOutsideBlocks) {
+                addZeroOneRowBits(g, lengthOfSequence, cTth[th]);
+                return;
+            }
+            addRowOutsideOneBlocks(g, lengthOfSequence, cth[th], cTth[th], [&](const int& row, const int& col) {
+                return mate1.valid(row, col) && mate2.valid(row, col);
+            });
+        });
+
+        {
+            Stats::Stage reduction(Stats::Reduction);
+            for (int th = 1; th < num_threads; th++) {
+                addMatrix(cth[0], cth[th], lengthOfSequence);
+                addMatrix(cTth[0], cTth[th], lengthOfSequence);
+            }
+        }
+        Stats::Stage prefix(Stats::Prefix);
+        addTriangleCounts(cTth[0], cth[0], lengthOfSequence);
+        return cth[0];
+    }
+
+    // calls trimCriterionPaired with the criterion chosen by withFixedLength
+    struct TrimCriterionPaired {
+        const string& inputfile1;
+        const string& inputfile2;
+        const int&    numberOfPairs;
+        const int&    num_threads;
+
+        template <typename Criterion>
+        vector<vector<int> > operator()(Criterion criterion) const {
+            return trimCriterionPaired(inputfile1, inputfile2, numberOfPairs, criterion, num_threads);
+        }
+    };
+
+    // 0-zeros
+    vector<vector<int> > trimZeroOnePaired(const string& inputfile1,
+                                           const string& inputfile2,
+                                           const int& numberOfPairs,
+                                           const int& lengthOfSequence,
+                                           const int& thresholdGoodValues,
+                                           const int& shiftToConvertChars,
+                                           const int& num_threads)
+    {
+        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
+        TrimCriterionPaired trim = {inputfile1, inputfile2, numberOfPairs, num_threads};
+        return withFixedLength<ZeroOneCriterion>(trim, lengthOfSequence, thresholdPlusShift);
+    }
+
+    // z-zeros
+    vector<vector<int> > trimZeroOneZerosAllowedPaired(const string& inputfile1,
+                                                       const string& inputfile2,
+                                                       const int& numberOfPairs,
+                                                       const int& lengthOfSequence,
+                                                       const int& numberOfAllowedZerosPerSequence,
+                                                       const int& thresholdGoodValues,
+                                                       const int& shiftToConvertChars,
+                                                       const int& num_threads)
+    {
+        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
+        const int words = ZeroOneBitmap::wordsPerRead(lengthOfSequence);
+
+        // cR = counter of rows: cR(l,r)=m means, there are m pairs where r is
+        //      the largest right border of a selected window starting at l
+        vector<vector<vector<int> > > cRth (num_threads, vector<vector<int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+        vector<vector<uint64_t> > gth (num_threads, vector<uint64_t>(words));
+        vector<vector<int> > positionsOfZerosth (num_threads, vector<int>(lengthOfSequence));
+        vector<vector<int> > reach1th (num_threads, vector<int>(lengthOfSequence));
+        vector<vector<int> > reach2th (num_threads, vector<int>(lengthOfSequence));
+
+        runPairedPipeline(inputfile1, inputfile2, numberOfPairs, num_threads,
+                          [&](int th, const string& zeile1, const string& zeile2) {
+            uint64_t* g = gth[th].data();
+            ZeroOneBitmap::packRead(zeile1, lengthOfSequence, thresholdPlusShift, g);
+            computeReachZerosAllowed(g, lengthOfSequence, numberOfAllowedZerosPerSequence,
+                                     positionsOfZerosth[th], reach1th[th]);
+            ZeroOneBitmap::packRead(zeile2, lengthOfSequence, thresholdPlusShift, g);
+            computeReachZerosAllowed(g, lengthOfSequence, numberOfAllowedZerosPerSequence,
+                                     positionsOfZerosth[th], reach2th[th]);
+            for (int l = 0; l < lengthOfSequence; l++) {
+                int r = min(reach1th[th][l], reach2th[th][l]);
+                if (r >= l) {
+                    cRth[th][l][r]++;
+                }
+            }
+        });
+
+        {
+            Stats::Stage reduction(Stats::Reduction);
+            for (int th = 1; th < num_threads; th++) {
+                addMatrix(cRth[0], cRth[th], lengthOfSequence);
+            }
+        }
+        vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
+        Stats::Stage prefix(Stats::Prefix);
+        addRowCounts(cRth[0], c, lengthOfSequence);
+        return c;
+    }
+
+    // p-percent
+    vector<vector<int> > trimZeroOnePercentZerosAllowedPaired(const string& inputfile1,
+                                                              const string& inputfile2,
+                                                              const int& numberOfPairs,
+                                                              const int& lengthOfSequence,
+                                                              const double& percentOfAllowedZerosPerSequence,
+                                                              const int& thresholdGoodValues,
+                                                              const int& shiftToConvertChars,
+                                                              const int& num_threads)
+    {
+        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
+        TrimCriterionPaired trim = {inputfile1, inputfile2, numberOfPairs, num_threads};
+        return withFixedLength<PercentCriterion>(trim, lengthOfSequence,
+                                                 percentOfAllowedZerosPerSequence, thresholdPlusShift);
+    }
+
+    // m-mean
+    vector<vector<int> > trimIntegerMeanPaired(const string& inputfile1,
+                                               const string& inputfile2,
+                                               const int& numberOfPairs,
+                                               const int& lengthOfSequence,
+                                               const double& givenMean,
+                                               const int& shiftToConvertChars,
+                                               const int& num_threads)
+    {
+        double shiftedMean = shiftToConvertChars + givenMean;
+        TrimCriterionPaired trim = {inputfile1, inputfile2, numberOfPairs, num_threads};
+        return withFixedLength<MeanCriterion>(trim, lengthOfSequence, shiftedMean);
+    }
+
+}
+
+#endif
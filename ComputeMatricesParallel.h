@@ -22,16 +22,27 @@
  *
  * Version 1.1: (29 Jul 2014) Parallel version
  *
+ * z-zeros and p-percent: the reading thread packs each read into a 0/1 bitmap,
+ * the workers run on the packed reads (see ComputeMatricesBitmap.h)
+ *
  */
 
 #include <fstream>
 #include <string>
 #include <vector>
 #include <utility>
+#include <limits>
 #include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
 #include <assert.h>
 
 #include "ConcurrentQueue.h"
+#include "QualityInput.h"
+#include "ComputeMatricesBitmap.h"
+#include "Problems.h"
+#include "Stats.h"
 
 using namespace std;
 
@@ -40,29 +51,31 @@ namespace ComputeMatrices {
     void readFromFASTQFile(const string& inputfile,
                            const int& numberOfSequences,
                            ConcurrentQueue<string*>& q,
-                           bool& ready){
+                           atomic<bool>& ready){
         
         // this method reads a FASTQ-file line by line.
         // Every forth line (containing the quality information about a read)
         // is inserted into a thread-safe queue.
-        // When parsing is completed, the booloean variable ready is set to true.
+        // When parsing is completed, the atomic boolean variable ready is set to true.
         
         // To keep extra space limited, the queue is limited to 1000 lines.
         // When the queue becomes full, the reading thread waits 2 miliseconds
         
         
+        Stats::ThreadScope statsThread("reader");
+
         // read the file row by row
         string zeile;
         bool success = false;
         
         // open file
-        ifstream in(inputfile.c_str(), ios::in);
+        QualityLineReader in(inputfile);
         
         for (int z = 0; z < numberOfSequences; z++) {
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
-            getline(in,zeile);
+            {
+                Stats::Stage parse(Stats::Parse, Stats::wallOnly);
+                in.nextQualityLine(zeile);
+            }
             
             string* str = new string(zeile);
             
@@ -71,10 +84,12 @@ namespace ComputeMatrices {
             while (!success){
                 if (q.size() < 10000){
                     q.push(str);
+                    Stats::queueDepth(q.size());
                     success = true;
                 }
                 else {
                     //std::cout << "Queue is full\n";
+                    Stats::Stage wait(Stats::QueueWait);
                     std::this_thread::sleep_for(std::chrono::milliseconds(1));
                 }
             }
@@ -84,164 +99,97 @@ namespace ComputeMatrices {
         
     }
 
-    /////////////////////////////////////////////////////////////////////////////
-    // z-zeros
-    
-    void computeZeroOneZerosAllowedMatrix (ConcurrentQueue<string*>& q ,
-                                                  vector<vector<int> >& c,
-                                                  const int& lengthOfSequence,
-                                                  const int& numberOfAllowedZerosPerSequence,
-                                                  const int& thresholdPlusShift,
-                                                  bool& ready)
-    {
+    // reads with the same role as readFromFASTQFile, but for the 0/1 problems:
+    // every quality line is packed into a 0/1 bitmap for thresholdPlusShift
+    // (see ZeroOneBitmap.h), so the workers never touch the chars again. To
+    // keep the locking overhead of the queue low, the packed reads are pushed
+    // in batches of packedBatchSize reads (wordsPerRead words per read).
+    const int packedBatchSize = 256;
 
-        // cC = counter of columns
-        vector<vector<int> > cC (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        
-        // store the positions of the left ends of each 1-block
-        vector<int> leftOne(lengthOfSequence,0);
-        
-        // store the positions of the right ends of each 1-block
-        vector<int> rightOne(lengthOfSequence,0);
-        
-        // store the positions of all zeros in the current column
-        vector<int> positionsOfZeros(lengthOfSequence,0);
-        
-        // if some zeros are allowed, there is a leftmost and a rightmost zero in
-        // each identified block that consists of "only ones and at most k zeros"
-        int leftBorderZero, rightBorderZero;
-        // each block of such a type has a left and a right border
-        int leftBorderOneBlock, rightBorderOneBlock;
-      
-        bool stillInOneBlock;
-        int startOfOneBlock;
-        int numberOfZerosInCurrentRow;
-        
+    void readPackedFromFASTQFile(const string& inputfile,
+                                 const int& numberOfSequences,
+                                 const int& lengthOfSequence,
+                                 const int& thresholdPlusShift,
+                                 ConcurrentQueue<vector<uint64_t>*>& q,
+                                 atomic<bool>& ready){
+
+        Stats::ThreadScope statsThread("reader");
+        QualityLineReader in(inputfile);
+        string zeile;
+        const int words = ZeroOneBitmap::wordsPerRead(lengthOfSequence);
+
+        for (int z = 0; z < numberOfSequences; z += packedBatchSize) {
+            int readsInBatch = min(packedBatchSize, numberOfSequences - z);
+            vector<uint64_t>* batch = new vector<uint64_t>(readsInBatch * words);
+            {
+                Stats::Stage parse(Stats::Parse);
+                for (int b = 0; b < readsInBatch; b++) {
+                    in.nextQualityLine(zeile);
+                    ZeroOneBitmap::packRead(zeile, lengthOfSequence, thresholdPlusShift, batch->data() + b * words);
+                }
+            }
+
+            // same limit of buffered reads as in readFromFASTQFile
+            while (q.size() >= 10000 / packedBatchSize){
+                Stats::Stage wait(Stats::QueueWait);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            q.push(batch);
+            Stats::queueDepth(q.size() * packedBatchSize);
+        }
+        // parsing of the input file is completed
+        ready = true;
+
+    }
+
+    // takes batches of packed reads from the queue until the reader is ready
+    // and the queue is empty, and calls processRead for each packed read
+    void processPackedBatches(ConcurrentQueue<vector<uint64_t>*>& q,
+                              const int& lengthOfSequence,
+                              atomic<bool>& ready,
+                              function<void(const uint64_t*)> processRead)
+    {
+        const int words = ZeroOneBitmap::wordsPerRead(lengthOfSequence);
         while (!ready || !q.empty()){
-            if (q.empty()){
+            vector<uint64_t>* batch = nullptr;
+            if (!q.tryPop(batch)){
+                Stats::Stage wait(Stats::QueueWait);
                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                //std::cout << "not ready, but queue is empty\n";
+                continue;
             }
-            else {
-                //if (!q.empty()){
-                string* zeile = nullptr;
-                
-                if (!q.tryPop(zeile)){
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                    continue;
-                }
-                
-                
-                assert (zeile!= nullptr);
-                
-                //std::cout << "verarbeite zeile\n";
-                
-                startOfOneBlock = 0;
-                numberOfZerosInCurrentRow = 0;
-                stillInOneBlock = ((*zeile)[0]>=thresholdPlusShift);
-                for (int i = 0; i < lengthOfSequence; i++) {
-                    // initialize leftOne and rightOne
-                    leftOne[i] = 0;
-                    rightOne[i] = 0;
-                    // store positions of Ones
-                    if ((*zeile)[i]<thresholdPlusShift) {
-                        positionsOfZeros[numberOfZerosInCurrentRow]=i;
-                        numberOfZerosInCurrentRow++;
-                    }
-                    // fill leftOne
-                    if ((*zeile)[i]<thresholdPlusShift) {
-                        if (stillInOneBlock) {
-                            stillInOneBlock = false;
-                        }
-                    } else {
-                        if (!stillInOneBlock) {
-                            stillInOneBlock = true;
-                            startOfOneBlock = i;
-                        }
-                        leftOne[i]=startOfOneBlock;
-                    }
-                }
-                // fill rightOne
-                stillInOneBlock = ((*zeile)[lengthOfSequence-1]>=thresholdPlusShift);
-                if (stillInOneBlock) {
-                    startOfOneBlock = lengthOfSequence-1;
-                }
-                for (int i = lengthOfSequence-1; i >=0; i--) {
-                    if ((*zeile)[i]<thresholdPlusShift) {
-                        if (stillInOneBlock) {
-                            stillInOneBlock = false;
-                        }
-                    } else {
-                        if (!stillInOneBlock) {
-                            stillInOneBlock = true;
-                            startOfOneBlock = i;
-                        }
-                        rightOne[i]=startOfOneBlock;
-                    }
-                }
-                
-                if (numberOfZerosInCurrentRow <= numberOfAllowedZerosPerSequence) {
-                    for (int j=0; j < lengthOfSequence; j++)
-                        cC[0][j]++;
-                } else {
-                    int previousBlock = -1;
-                    for (int i = 0; i <= numberOfZerosInCurrentRow-numberOfAllowedZerosPerSequence; i++) {
-                        leftBorderZero = positionsOfZeros[i];
-                        rightBorderZero = positionsOfZeros[i+numberOfAllowedZerosPerSequence-1];
-                        // leftBorderOneBlock is either
-                        // 1) = 0, if leftBorderZero == 0
-                        // 2) = leftBorderZero, if leftBorderZero-1 is *not* part of a
-                        //                      1-block in zeile
-                        // 3) = leftOne[leftBorderZero-1], if leftBorderZero-1 is part
-                        //                                 of a 1-block in zeile
-                        if ( leftBorderZero == 0 ) {
-                            leftBorderOneBlock = 0;
-                        } else { // leftBorderZero > 0
-                            if ((*zeile)[leftBorderZero-1]>=thresholdPlusShift) { // 1-block left of 0
-                                leftBorderOneBlock = leftOne[leftBorderZero-1];
-                            } else { // no 1-block
-                                leftBorderOneBlock = leftBorderZero;
-                            }
-                        }
-                        // same for rightBorderOneBlock
-                        if (rightBorderZero == lengthOfSequence-1) {
-                            rightBorderOneBlock = lengthOfSequence-1;
-                        } else {
-                            if ((*zeile)[rightBorderZero+1]>=thresholdPlusShift) { // 1-block right of 0
-                                rightBorderOneBlock = rightOne[rightBorderZero+1];
-                            } else { // no 1-block
-                                rightBorderOneBlock = rightBorderZero;
-                            }
-                        }
-                        // add to cC
-                        for (int j= previousBlock+1; j <=rightBorderOneBlock; j++) {
-                            cC[leftBorderOneBlock][j]++;
-                        }
-                        previousBlock = rightBorderOneBlock;
-                    }
+            assert (batch != nullptr);
+            {
+                Stats::Stage kernel(Stats::Kernel);
+                for (size_t b = 0; b < batch->size(); b += words) {
+                    processRead(batch->data() + b);
                 }
-                
-                delete zeile;
-                
-            }
-            
-        }
-        
-        // compute c from cC
-        // first fill the first row of c
-        for (int j=0; j< lengthOfSequence; j++){
-            c[0][j] = cC[0][j];
-        }
-        // now fill the rest
-        for (int i=1; i < lengthOfSequence; i++){
-            for (int j=i; j<lengthOfSequence; j++){
-                c[i][j] = cC[i][j] + c[i-1][j];
+                Stats::addReads(batch->size() / words);
             }
+            delete batch;
         }
-        
     }
-    
-    
+
+    /////////////////////////////////////////////////////////////////////////////
+    // z-zeros
+
+    void computeZeroOneZerosAllowedMatrix (ConcurrentQueue<vector<uint64_t>*>& q ,
+                                           vector<vector<int> >& cC,
+                                           const int& lengthOfSequence,
+                                           const int& numberOfAllowedZerosPerSequence,
+                                           atomic<bool>& ready)
+    {
+        Stats::ThreadScope statsThread("worker");
+
+        // store the positions of all zeros in the current read
+        vector<int> positionsOfZeros(lengthOfSequence,0);
+
+        processPackedBatches(q, lengthOfSequence, ready, [&](const uint64_t* g) {
+            addZerosAllowedRowBits(g, lengthOfSequence, numberOfAllowedZerosPerSequence,
+                                   cC, positionsOfZeros);
+        });
+    }
+
+
     vector<vector<int> > trimZeroOneZerosAllowedPar(const string& inputfile,
                                                     const int& numberOfSequences,
                                                     const int& lengthOfSequence,
@@ -251,188 +199,122 @@ namespace ComputeMatrices {
                                                     const int& num_threads)
     {
         int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
-        
-        // alloc and init c and cC
-        // cC = counter of columns
+
         // c(i,j)=m means, there are m lines where a block of "only ones and at most
         //          k zeros" starts at i and ends at j
         vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
- 
-        vector<vector <vector<int> > > cth (num_threads, vector< vector <int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
-        
-        
-        ConcurrentQueue<string*> q;
-        bool ready = false;
-        
-        
+
+        // cC = counter of columns, one per thread
+        vector<vector <vector<int> > > cCth (num_threads, vector< vector <int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+
+
+        ConcurrentQueue<vector<uint64_t>*> q;
+        atomic<bool> ready(false);
+
+
         vector<thread> threads(num_threads);
-        
-        
-        std::thread readerThread(std::bind(&readFromFASTQFile, inputfile, numberOfSequences, std::ref(q), std::ref(ready)));
-        
+
+
+        std::thread readerThread(std::bind(&readPackedFromFASTQFile, inputfile, numberOfSequences, lengthOfSequence, thresholdPlusShift, std::ref(q), std::ref(ready)));
+
         for (int i=0; i < num_threads; i++){
-            threads[i] = thread(std::bind(&computeZeroOneZerosAllowedMatrix, std::ref(q), std::ref(cth[i]),lengthOfSequence,numberOfAllowedZerosPerSequence, thresholdPlusShift, std::ref(ready)));
+            threads[i] = thread(std::bind(&computeZeroOneZerosAllowedMatrix, std::ref(q), std::ref(cCth[i]),lengthOfSequence,numberOfAllowedZerosPerSequence, std::ref(ready)));
         }
-        
+
         // wait for all threads
         readerThread.join();
         std::for_each(threads.begin(), threads.end(),
                       std::mem_fn(&std::thread::join));
-        
-        // collect the results
-        for (int th=0; th < num_threads; th++){
-            for (int i = 0; i < lengthOfSequence; i++){
-                for (int j=i; j <  lengthOfSequence; j++)
-                    c[i][j] += cth[th][i][j];
+
+        // collect the results: the column counters are added first, so c is
+        // computed from cC only once
+        {
+            Stats::Stage reduction(Stats::Reduction);
+            for (int th=1; th < num_threads; th++){
+                for (int i = 0; i < lengthOfSequence; i++){
+                    for (int j=0; j <  lengthOfSequence; j++)
+                        cCth[0][i][j] += cCth[th][i][j];
+                }
             }
         }
-        
+        Stats::Stage prefix(Stats::Prefix);
+        addColumnCounts(cCth[0], c, lengthOfSequence);
+
         return c;
-    
+
     }
-    
+
     /////////////////////////////////////////////////////////////////////////////
 
     //p-percent
-    
-    void computeZeroOnePercentZerosAllowedMatrix (ConcurrentQueue<string*>& q ,
-                                                  vector<vector<int> >& c,
-                                                  const int& lengthOfSequence,
-                                                  const double& percentOfAllowedZerosPerSequence,
-                                                  const int& thresholdPlusShift,
-                                                  bool& ready)
+
+    // 1-block problems on packed reads (p-percent): each thread adds its reads
+    // to its own c and cT, criterion is copied (scratch buffers)
+    template <typename Criterion>
+    void computePackedCriterionMatrix (ConcurrentQueue<vector<uint64_t>*>& q ,
+                                       vector<vector<int> >& c,
+                                       vector<vector<int> >& cT,
+                                       Criterion criterion,
+                                       atomic<bool>& ready)
     {
- 
-        vector<vector<int>> cT (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        
-        // pre compute allowed zeros per width for given percent
-        vector<int> preCompAllowedZeros (lengthOfSequence+1);
-        for (int i = 0; i <= lengthOfSequence; i++) {
-            preCompAllowedZeros[i] = (int) (percentOfAllowedZerosPerSequence * i);
-        }
-        
-        while (!ready || !q.empty()){
-            if (q.empty()){
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                //std::cout << "not ready, but queue is empty\n";
-            }
-            else {
-                //if (!q.empty()){
-                string* zeile = nullptr;
-                
-                if (!q.tryPop(zeile)){
-                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                    continue;
-                }
-                
-                
-                assert (zeile!= nullptr);
-                
-                //std::cout << "verarbeite zeile\n";
- 
-                // pre processing to access the #zeros in O(1)
-                // #zeros in g[L..R] equals partialSums[R+1] - partialSums[L]
-                vector<int> partialSums(lengthOfSequence+1, 0);
-                partialSums[0] = 0;
-                for (int i = 0; i < lengthOfSequence; i++) {
-                    partialSums[i+1] = ((*zeile)[i] < thresholdPlusShift) + partialSums[i];
-                }
-                
-                // find block with values >= thresholdPlusShift), because all
-                // subblocks fulfill the p-percent condition
-                vector<pair<int,int>> oneBlocks;
-                int startOfOneBlock = 0;
-                bool stillInOneBlock = false;
-                zeile->append("!"); // dummy 0 at the end
-                // ASSERT: ASCII("!")=33 and this is the smallest possible char in a quality score string
-                // we need a dummy "bad" quality score at the end for our algorithm
-                for (int i = 0; i <= lengthOfSequence; i++) {
-                    if ((*zeile)[i] < thresholdPlusShift) {
-                        if (stillInOneBlock) {
-                            stillInOneBlock = false;
-                            oneBlocks.push_back( make_pair(startOfOneBlock,i-1) );
-                            cT[startOfOneBlock][i-1]++;
-                        }
-                    } else {
-                        if (!stillInOneBlock) {
-                            stillInOneBlock = true;
-                            startOfOneBlock = i;
-                        }
-                    }
-                }
-                
-                // remember that we added "!" to zeile, but we will not read it later,
-                // so there is no need to delete it
-                
-                // compute c(l,r) for all (l,r) not in the triangles of oneBlocks
-                // HORIZONTAL
-                int startrow = 0;
-                for (auto p: oneBlocks) {
-                    for (int row = startrow; row < p.first; row++) {
-                        for (int col = row+1; col < lengthOfSequence; col++) {
-                            if ( (partialSums[col+1] - partialSums[row]) <= preCompAllowedZeros[col+1-row]) {
-                                c[row][col]++;
-                            }
-                        }
-                    }
-                    startrow = p.second + 1;
-                    // VERTICAL: everything right of the triangle induced by p
-                    for (int row = p.first; row <= p.second; row++) {
-                        for (int col = p.second+1; col < lengthOfSequence; col++) {
-                            if ( (partialSums[col+1] - partialSums[row]) <= preCompAllowedZeros[col+1-row]) {
-                                c[row][col]++;
-                            }
-                        }
-                    }
-                }
-                // everything after last triangle of 1s
-                for (int row = startrow; row < lengthOfSequence; row++) {
-                    for (int col = row+1; col < lengthOfSequence; col++) {
-                        if ( (partialSums[col+1] - partialSums[row]) <= preCompAllowedZeros[col+1-row]) {
-                            c[row][col]++;
-                        }
-                    }
-                }
+        Stats::ThreadScope statsThread("worker");
 
-                delete zeile;
+        processPackedBatches(q, criterion.length(), ready, [&](const uint64_t* g) {
+            addCriterionRowBits(g, criterion, c, cT);
+        });
+    }
 
+    // reader thread packs the reads, the workers run criterion (chosen by
+    // withFixedLength) on them
+    struct TrimPackedCriterionPar {
+        const string& inputfile;
+        const int&    numberOfSequences;
+        const int&    thresholdPlusShift;
+        const int&    num_threads;
+
+        template <typename Criterion>
+        vector<vector<int> > operator()(Criterion criterion) const {
+            const int lengthOfSequence = criterion.length();
+
+            // c(i,j)=m means, there are m lines where a block of "only ones and at most
+            //        p percent zeros" starts at i and ends at j
+            vector<vector <vector<int> > > cth (num_threads, vector< vector <int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+            vector<vector <vector<int> > > cTth (num_threads, vector< vector <int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+
+
+            ConcurrentQueue<vector<uint64_t>*> q;
+            atomic<bool> ready(false);
+
+
+            vector<thread> threads(num_threads);
+
+
+            std::thread readerThread(std::bind(&readPackedFromFASTQFile, inputfile, numberOfSequences, lengthOfSequence, thresholdPlusShift, std::ref(q), std::ref(ready)));
+
+            for (int i=0; i < num_threads; i++){
+                threads[i] = thread(std::bind(&computePackedCriterionMatrix<Criterion>, std::ref(q), std::ref(cth[i]), std::ref(cTth[i]), criterion, std::ref(ready)));
             }
-        } // end while
- 
-        
-        // compute c_aux from cT like in 0-zeros:
-        vector<vector<int>> c_aux (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        vector<int> columnSumAbove (lengthOfSequence,0);
-        // first fill the last column of c_aux
-        c_aux[0][lengthOfSequence-1] = cT[0][lengthOfSequence-1];
-        for (int i=1; i < lengthOfSequence; i++){
-            c_aux[i][lengthOfSequence-1] = cT[i][lengthOfSequence-1] + c_aux[i-1][lengthOfSequence-1];
-        }
-        // next fill the first row of c_aux
-        for (int j=lengthOfSequence-2; j>= 0; j--){
-            c_aux[0][j] = cT[0][j] + c_aux[0][j+1];
-            columnSumAbove[j] = cT[0][j];
-        }
-        // now fill the rest
-        for (int i=1; i < lengthOfSequence; i++){
-            for (int j=lengthOfSequence-2; j>= i; j--){
-                c_aux[i][j] = cT[i][j] + c_aux[i][j+1] + columnSumAbove[j];
-                columnSumAbove[j] += cT[i][j];
-            }
-        }
-        
-        // add c and c_aux
-        
-        for (int i = 0; i < lengthOfSequence; i++) {
-            for (int j = i; j < lengthOfSequence; j++) {
-                c[i][j] += c_aux[i][j];
+
+            // wait for all threads
+            readerThread.join();
+            std::for_each(threads.begin(), threads.end(),
+                          std::mem_fn(&std::thread::join));
+
+            // collect the results: c_aux is computed from the sum of all cT
+            {
+                Stats::Stage reduction(Stats::Reduction);
+                for (int th=1; th < num_threads; th++){
+                    addMatrix(cth[0], cth[th], lengthOfSequence);
+                    addMatrix(cTth[0], cTth[th], lengthOfSequence);
+                }
             }
+            Stats::Stage prefix(Stats::Prefix);
+            addTriangleCounts(cTth[0], cth[0], lengthOfSequence);
+
+            return cth[0];
         }
+    };
 
-        
-    }
-        
-    
     vector<vector<int> > trimZeroOnePercentZerosAllowedPar(const string& inputfile,
                                                            const int& numberOfSequences,
                                                            const int& lengthOfSequence,
@@ -441,183 +323,103 @@ namespace ComputeMatrices {
                                                            const int& shiftToConvertChars,
                                                            const int num_threads )
     {
-   
+
         int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
-        
-        
-        // c(i,j)=m means, there are m lines where a block of "only ones and at most
-        //        p percent zeros" starts at i and ends at j
-        vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        
-        vector<vector <vector<int> > > cth (num_threads, vector< vector <int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
-        
-        
-        ConcurrentQueue<string*> q;
-        bool ready = false;
-        
-        
-        vector<thread> threads(num_threads);
-        
-        
-        std::thread readerThread(std::bind(&readFromFASTQFile, inputfile, numberOfSequences, std::ref(q), std::ref(ready)));
-        
-        for (int i=0; i < num_threads; i++){
-            threads[i] = thread(std::bind(&computeZeroOnePercentZerosAllowedMatrix, std::ref(q), std::ref(cth[i]),lengthOfSequence,percentOfAllowedZerosPerSequence, thresholdPlusShift, std::ref(ready)));
-        }
-        
-        // wait for all threads
-        readerThread.join();
-        std::for_each(threads.begin(), threads.end(),
-                      std::mem_fn(&std::thread::join));
-        
-        // collect the results
-        for (int th=0; th < num_threads; th++){
-            for (int i = 0; i < lengthOfSequence; i++){
-                for (int j=i; j <  lengthOfSequence; j++)
-                    c[i][j] += cth[th][i][j];
-            }
-        }
-        
-        return c;
 
-        
+        // the threshold is already applied by the reader thread
+        TrimPackedCriterionPar trim = {inputfile, numberOfSequences, thresholdPlusShift, num_threads};
+        return withFixedLength<PercentCriterion>(trim, lengthOfSequence, percentOfAllowedZerosPerSequence, 0);
     }
-    
+
     /////////////////////////////////////////////////////////////////////////////
     
-    void computeMeanMatrix (ConcurrentQueue<string*>& q ,
-                            vector<vector<int> >& c,
-                            const int& lengthOfSequence,
-                            const double& givenMean,
-                            const int& shiftToConvertChars,
-                            bool& ready){
+    // 1-block problems on quality lines (m-mean): each thread adds its reads
+    // to its own c and cT, criterion is copied (scratch buffers)
+    template <typename Criterion>
+    void computeCriterionMatrix (ConcurrentQueue<string*>& q ,
+                                 vector<vector<int> >& c,
+                                 vector<vector<int> >& cT,
+                                 Criterion criterion,
+                                 atomic<bool>& ready){
         
-        int currentSum;
-        double shiftedMean = shiftToConvertChars + givenMean;
-        double currentCumulatedMean;
-   
-        vector<vector<int>> cT (lengthOfSequence, vector<int>(lengthOfSequence,0));
+        Stats::ThreadScope statsThread("worker");
         
         // stop only if parsing is completed (ready == true) and
         // the queue has become empty (= every read has been processed)
         
         while (!ready || !q.empty()){
             if (q.empty()){
+                Stats::Stage wait(Stats::QueueWait);
                 std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                //std::cout << "not ready, but queue is empty\n";
             }
             else {
-            //if (!q.empty()){
                 string* zeile = nullptr;
                 
                 if (!q.tryPop(zeile)){
+                    Stats::Stage wait(Stats::QueueWait);
                     std::this_thread::sleep_for(std::chrono::milliseconds(1));
                     continue;
                 }
                 
-                
                 assert (zeile!= nullptr);
-
-                //std::cout << "verarbeite zeile\n";
-                
-                // pre processing to access the mean in O(1)
-                vector<int> partialSums(lengthOfSequence+1, 0);
-                partialSums[0] = 0;
-                for (int i = 0; i < lengthOfSequence; i++) {
-                    partialSums[i+1] = ((*zeile)[i] - shiftedMean) + partialSums[i];
-                }
                 
-                // find block with values >= mean, because all subblocks fulfill the
-                // m-mean condition
-                vector<pair<int,int>> oneBlocks;
-                int startOfOneBlock = 0;
-                bool stillInOneBlock = false;
-                zeile->append("!"); // dummy 0 at the end
-                // ASSERT: ASCII("!")=33 and this is the smallest possible char in a quality score string
-                // we need a dummy "bad" quality score at the end for our algorithm
-                for (int i = 0; i <= lengthOfSequence; i++) {
-                    if ((*zeile)[i] < shiftedMean) {
-                        if (stillInOneBlock) {
-                            stillInOneBlock = false;
-                            oneBlocks.push_back( make_pair(startOfOneBlock,i-1) );
-                            cT[startOfOneBlock][i-1]++;
-                        }
-                    } else {
-                        if (!stillInOneBlock) {
-                            stillInOneBlock = true;
-                            startOfOneBlock = i;
-                        }
-                    }
-                }
-                
-                // remember that we added "!" to zeile, but we will not read it later,
-                // so there is no need to delete it
-                
-                // compute c(l,r) for all (l,r) not in the triangles of oneBlocks
-                // HORIZONTAL
-                int startrow = 0;
-                for (auto p: oneBlocks) {
-                    for (int row = startrow; row < p.first; row++) {
-                        for (int col = row+1; col < lengthOfSequence; col++) {
-                            if ( (partialSums[col+1] - partialSums[row]) >= 0) {
-                                c[row][col]++;
-                            }
-                        }
-                    }
-                    startrow = p.second + 1;
-                    // VERTICAL: everything right of the triangle induced by p
-                    for (int row = p.first; row <= p.second; row++) {
-                        for (int col = p.second+1; col < lengthOfSequence; col++) {
-                            if ( (partialSums[col+1] - partialSums[row]) >= 0) {
-                                c[row][col]++;
-                            }
-                        }
-                    }
-                }
-                // everything after last triangle of 1s
-                for (int row = startrow; row < lengthOfSequence; row++) {
-                    for (int col = row+1; col < lengthOfSequence; col++) {
-                        if ( (partialSums[col+1] - partialSums[row]) >= 0) {
-                            c[row][col]++;
-                        }
-                    }
+                {
+                    Stats::Stage kernel(Stats::Kernel, Stats::wallOnly);
+                    addCriterionRow(*zeile, criterion, c, cT);
+                    Stats::addReads(1);
                 }
                 
                 delete zeile;
             }
         }
-        
-        // compute c_aux from cT like in 0-zeros:
-        vector<vector<int>> c_aux (lengthOfSequence, vector<int>(lengthOfSequence,0));
-        vector<int> columnSumAbove (lengthOfSequence,0);
-        // first fill the last column of c_aux
-        c_aux[0][lengthOfSequence-1] = cT[0][lengthOfSequence-1];
-        for (int i=1; i < lengthOfSequence; i++){
-            c_aux[i][lengthOfSequence-1] = cT[i][lengthOfSequence-1] + c_aux[i-1][lengthOfSequence-1];
-        }
-        // next fill the first row of c_aux
-        for (int j=lengthOfSequence-2; j>= 0; j--){
-            c_aux[0][j] = cT[0][j] + c_aux[0][j+1];
-            columnSumAbove[j] = cT[0][j];
-        }
-        // now fill the rest
-        for (int i=1; i < lengthOfSequence; i++){
-            for (int j=lengthOfSequence-2; j>= i; j--){
-                c_aux[i][j] = cT[i][j] + c_aux[i][j+1] + columnSumAbove[j];
-                columnSumAbove[j] += cT[i][j];
+    }
+   
+    // reader thread parses the quality lines, the workers run criterion
+    // (chosen by withFixedLength) on them
+    struct TrimCriterionPar {
+        const string& inputfile;
+        const int&    numberOfSequences;
+        const int&    num_threads;
+        
+        template <typename Criterion>
+        vector<vector<int> > operator()(Criterion criterion) const {
+            const int lengthOfSequence = criterion.length();
+            
+            vector<vector <vector<int> > > cth (num_threads, vector< vector <int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+            vector<vector <vector<int> > > cTth (num_threads, vector< vector <int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
+            
+            ConcurrentQueue<string*> q;
+            atomic<bool> ready(false);
+            
+            
+            vector<thread> threads(num_threads);
+            
+            
+            std::thread readerThread(std::bind(&readFromFASTQFile, inputfile, numberOfSequences, std::ref(q),std::ref(ready)));
+            
+            for (int i=0; i < num_threads; i++){
+                threads[i] = thread(std::bind(&computeCriterionMatrix<Criterion>, std::ref(q), std::ref(cth[i]), std::ref(cTth[i]), criterion, std::ref(ready)));
             }
-        }
-        
-        // add c and c_aux
-        
-        for (int i = 0; i < lengthOfSequence; i++) {
-            for (int j = i; j < lengthOfSequence; j++) {
-                c[i][j] += c_aux[i][j];
+            
+            // wait for all threads
+            readerThread.join();
+            std::for_each(threads.begin(), threads.end(),
+                          std::mem_fn(&std::thread::join));
+            
+            // collect the results: c_aux is computed from the sum of all cT
+            {
+                Stats::Stage reduction(Stats::Reduction);
+                for (int th=1; th < num_threads; th++){
+                    addMatrix(cth[0], cth[th], lengthOfSequence);
+                    addMatrix(cTth[0], cTth[th], lengthOfSequence);
+                }
             }
+            Stats::Stage prefix(Stats::Prefix);
+            addTriangleCounts(cTth[0], cth[0], lengthOfSequence);
+            
+            return cth[0];
         }
-        
-        
-    }
+    };
    
     // m-mean (parallelized version)
     vector<vector<int> > trimIntegerMeanPar(
@@ -632,43 +434,10 @@ namespace ComputeMatrices {
         // c(i,j)=x means, there are x lines where a block of starting at index i
         // and ending at index j with mean value at least "givenMean"
         
-        vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
- 
-        
-        vector<vector <vector<int> > > cth (num_threads, vector< vector <int> >(lengthOfSequence, vector<int>(lengthOfSequence,0)));
-        
-        
-        ConcurrentQueue<string*> q;
-        bool ready = false;
-        
-        
-        vector<thread> threads(num_threads);
-        
-        
-        std::thread readerThread(std::bind(&readFromFASTQFile, inputfile, numberOfSequences, std::ref(q),std::ref(ready)));
-        
-        for (int i=0; i < num_threads; i++){
-            threads[i] = thread(std::bind(&computeMeanMatrix, std::ref(q), std::ref(cth[i]),lengthOfSequence,givenMean,shiftToConvertChars,std::ref(ready)));
-        }
-        
-        // wait for all threads
-        readerThread.join();
-        std::for_each(threads.begin(), threads.end(),
-                      std::mem_fn(&std::thread::join));
-        
-        // collect the results
-        for (int th=0; th < num_threads; th++){
-            for (int i = 0; i < lengthOfSequence; i++){
-                for (int j=i; j <  lengthOfSequence; j++)
-                    c[i][j] += cth[th][i][j];
-            }
-        }
-        
-        return c;
+        TrimCriterionPar trim = {inputfile, numberOfSequences, num_threads};
+        return withFixedLength<MeanCriterion>(trim, lengthOfSequence, shiftToConvertChars + givenMean);
     }
     
-
-    
     
 }
 
@@ -0,0 +1,282 @@
+/*******************************************************************************
+ *
+ * ComputeMatricesSeries.h
+ *
+ * DESCRIPTION: Time series mode: the reads of a run are roughly in the order
+ *              of sequencing, so the best window of the reads up to now shows
+ *              how the optimal trimming drifts over the run.
+ *              trimSeries: every `every` reads one step with the matrix c of
+ *                          each problem (see Problems.h) of the last `last`
+ *                          reads (last == 0: all reads so far) and the change
+ *                          of these matrices since the previous step
+ *                          num_threads == 0: sequential
+ *                          num_threads >  0: one reading thread and
+ *                          num_threads workers (as in the group-by mode)
+ *              trimFollow: the same for a FASTQ file that is still being
+ *                          written (follow mode, see FollowFile.h): the
+ *                          records are added as they are appended, the last
+ *                          step is reported when the run has finished
+ *
+ *              The input is cut into chunks of `every` reads. A chunk is a
+ *              group of the group-by mode (see ComputeMatricesGroups.h), so
+ *              the workers add their counters to the sums of the chunk (as
+ *              soon as they move on to the next chunk or the queue is empty),
+ *              and a chunk is taken from the sums as soon as all of its reads
+ *              are processed. The matrices of the window are updated
+ *              incrementally: plus the new chunk, minus the chunk that leaves
+ *              the window (the chunks of the window are kept), instead of a
+ *              new pass over the last reads.
+ *
+ * RUNTIMES: as the kernels, plus O( l^2 ) per step and problem
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ComputeMatricesSeries_h
+#define _ComputeMatricesSeries_h
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <algorithm>
+#include <assert.h>
+
+#include "ConcurrentQueue.h"
+#include "QualityInput.h"
+#include "FollowFile.h"
+#include "ComputeMatricesGroups.h" // GroupSums, GroupBatch, addGroupBatches
+#include "Problems.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    struct SeriesStep {
+        int                           step;   // counting from 0
+        int                           first;  // reads [first,last] of the window, counting from 1
+        int                           last;
+        vector<vector<vector<int> > > cs;     // matrix c of each problem for the window
+        vector<vector<vector<int> > > deltas; // change of cs since the previous step
+    };
+
+    // returns the next quality line, false at the end of the input
+    typedef function<bool(string&)> LineSource;
+
+    // reads the next batch of at most size reads of the chunk key, returns
+    // the number of reads (less than size at the end of the input)
+    int readSeriesBatch(const LineSource& nextLine,
+                        const string& key,
+                        const int& size,
+                        GroupBatch& batch)
+    {
+        Stats::Stage parse(Stats::Parse);
+        batch.lines.resize(size);
+        int z = 0;
+        while (z < size && nextLine(batch.lines[z])) {
+            z++;
+        }
+        batch.lines.resize(z);
+        batch.keys.assign(z, key);
+        return z;
+    }
+
+    void readSeriesBatches(const LineSource& nextLine,
+                           const int& maxReads,
+                           const int& every,
+                           ConcurrentQueue<GroupBatch*>& q,
+                           atomic<int>& total,
+                           atomic<bool>& ready){
+
+        Stats::ThreadScope statsThread("reader");
+        int z = 0;
+        while (maxReads == 0 || z < maxReads) {
+            // a batch does not cross the end of a chunk
+            int size = min(fileBatchSize, every - z % every);
+            if (maxReads > 0) {
+                size = min(size, maxReads - z);
+            }
+            GroupBatch* batch = new GroupBatch;
+            int n = readSeriesBatch(nextLine, to_string(z / every), size, *batch);
+            if (n == 0) {
+                delete batch;
+                break;
+            }
+            z += n;
+
+            // same limit of buffered reads as in readFromFASTQFile
+            while (q.size() >= 10000 / fileBatchSize){
+                Stats::Stage wait(Stats::QueueWait);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            q.push(batch);
+            Stats::queueDepth(q.size() * fileBatchSize);
+            if (n < size) {
+                break;
+            }
+        }
+        // parsing of the input is completed, total is published before ready
+        total = z;
+        ready = true;
+
+    }
+
+    // a += sign * b
+    inline void addMatrix(vector<vector<int> >& a, const vector<vector<int> >& b, const int& sign) {
+        for (size_t i = 0; i < a.size(); i++) {
+            for (size_t j = i; j < a[i].size(); j++) {
+                a[i][j] += sign * b[i][j];
+            }
+        }
+    }
+
+    // calls step for every `every` reads of nextLine (and for the remaining
+    // reads at the end) with the matrices of the last `last` reads (last == 0:
+    // all reads so far), last has to be a multiple of every; reads at most
+    // maxReads reads (0: up to the end of the input)
+    void trimSeriesLines(const LineSource& nextLine,
+                         const int& maxReads,
+                         const vector<Problem>& problems,
+                         const int& every,
+                         const int& last,
+                         const int& num_threads,
+                         const function<void(const SeriesStep&)>& step)
+    {
+        assert (every > 0 && last % every == 0);
+        GroupSums sums(problems);
+
+        SeriesStep current;
+        current.first = 1;
+        current.last  = 0;
+        for (const auto& p: problems) {
+            current.cs.push_back(vector<vector<int> >(p.lengthOfSequence, vector<int>(p.lengthOfSequence, 0)));
+        }
+        deque<GroupResult> window; // chunks of the window
+
+        // updates the window with chunk and calls step
+        auto addChunk = [&](const int& chunk) {
+            Stats::Stage prefix(Stats::Prefix);
+            window.push_back(sums.take(to_string(chunk)));
+            current.deltas = window.back().cs;
+            for (size_t k = 0; k < problems.size(); k++) {
+                addMatrix(current.cs[k], window.back().cs[k], 1);
+            }
+            if (last > 0 && (int) window.size() > last / every) {
+                for (size_t k = 0; k < problems.size(); k++) {
+                    addMatrix(current.cs[k], window.front().cs[k], -1);
+                    addMatrix(current.deltas[k], window.front().cs[k], -1);
+                }
+                current.first += window.front().reads;
+                window.pop_front();
+            }
+            current.step  = chunk;
+            current.last += window.back().reads;
+            step(current);
+        };
+
+        if (num_threads == 0) {// sequential mode
+            GroupCounters own(problems, 1);
+            GroupBatch batch;
+            int z = 0;
+            for (int chunk = 0; maxReads == 0 || z < maxReads; chunk++) {
+                int size = every;
+                if (maxReads > 0) {
+                    size = min(size, maxReads - z);
+                }
+                int n = 0;
+                while (n < size) {
+                    int requested = min(fileBatchSize, size - n);
+                    int got = readSeriesBatch(nextLine, to_string(chunk), requested, batch);
+                    own.addBatch(batch, sums);
+                    n += got;
+                    if (got < requested) break;
+                }
+                if (n == 0) break;
+                own.flush(sums);
+                addChunk(chunk);
+                z += n;
+                if (n < size) break;
+            }
+        } else {// parallel mode
+            ConcurrentQueue<GroupBatch*> q;
+            atomic<int>  total(0);
+            atomic<bool> ready(false);
+
+            std::thread readerThread(std::bind(&readSeriesBatches, std::cref(nextLine), maxReads,
+                                               every, std::ref(q), std::ref(total), std::ref(ready)));
+
+            vector<thread> threads(num_threads);
+            for (int th = 0; th < num_threads; th++){
+                threads[th] = thread(std::bind(&addGroupBatches, std::ref(q), std::ref(ready),
+                                               std::cref(problems), std::ref(sums), 1, true));
+            }
+
+            // the steps in the order of the chunks, as soon as a chunk is complete
+            for (int chunk = 0; ; chunk++) {
+                int size;
+                while (true) {
+                    const int reads = sums.reads(to_string(chunk));
+                    if (reads == every) {
+                        size = every;
+                        break;
+                    }
+                    if (ready) {// the last chunk can be smaller
+                        size = min(every, total - chunk * every);
+                        if (size <= 0 || reads == size) break;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                if (size <= 0) break;
+                addChunk(chunk);
+            }
+
+            // wait for all threads
+            readerThread.join();
+            std::for_each(threads.begin(), threads.end(),
+                          std::mem_fn(&std::thread::join));
+        }
+    }
+
+    // time series of the first numberOfSequences reads of inputfile
+    void trimSeries(const string& inputfile,
+                    const int& numberOfSequences,
+                    const vector<Problem>& problems,
+                    const int& every,
+                    const int& last,
+                    const int& num_threads,
+                    const function<void(const SeriesStep&)>& step)
+    {
+        if (numberOfSequences == 0) return;
+        QualityLineReader in(inputfile);
+        trimSeriesLines([&](string& zeile) { return in.nextQualityLine(zeile); },
+                        numberOfSequences, problems, every, last, num_threads, step);
+    }
+
+    // time series of a FASTQ file that is still being written (see
+    // FollowFile.h), up to numberOfSequences reads (0: until no data arrived
+    // for idleSeconds, or SIGINT, SIGTERM)
+    void trimFollow(const string& inputfile,
+                    const int& numberOfSequences,
+                    const int& idleSeconds,
+                    const vector<Problem>& problems,
+                    const int& every,
+                    const int& last,
+                    const int& num_threads,
+                    const function<void(const SeriesStep&)>& step)
+    {
+        if (QualityStore::isQualityStore(inputfile)) {
+            throw runtime_error("the follow mode needs the FASTQ file");
+        }
+        FollowFile::Reader in(inputfile, idleSeconds);
+        FollowFile::installStopHandlers();
+        trimSeriesLines([&](string& zeile) { return in.nextQualityLine(zeile); },
+                        numberOfSequences, problems, every, last, num_threads, step);
+    }
+
+}
+
+#endif
@@ -0,0 +1,295 @@
+/*******************************************************************************
+ *
+ * Criteria.h
+ *
+ * DESCRIPTION: The per read algorithm of 0-zeros, p-percent and m-mean as one
+ *              template, parametrised by a criterion policy and the type of
+ *              the counters. The single-end engines (sequential, parallel,
+ *              bitmap cache, and through Problems.h batch, group-by, time
+ *              series, server and library) call addCriterionRow or
+ *              addCriterionRowBits, so the per cell test is inlined and a
+ *              change of the algorithm is made only once. The paired-end
+ *              engine (trimCriterionPaired in ComputeMatricesPaired.h) uses
+ *              one policy per mate and calls addRowOutsideOneBlocks with the
+ *              AND of their 1-blocks and of their valid tests.
+ *
+ *              The algorithm: the maximal blocks of "good" positions of a
+ *              read (every window inside of them fulfills the criterion) are
+ *              counted as triangles in cT, all other windows (l,r) are
+ *              checked one by one (HORIZONTAL: rows between the blocks,
+ *              VERTICAL: right of a block) and counted in c. c is completed
+ *              with addTriangleCounts(cT, c).
+ *
+ *              A criterion policy has
+ *              oneBlocks(zeile):    per read preprocessing, returns the read
+ *                                   as 0/1 bitmap of good positions
+ *              oneBlocksBits(g):    the same for a read that is already a 0/1
+ *                                   bitmap (only criteria on 0/1 reads)
+ *              valid(l,r):          window test for (l,r) outside the blocks
+ *              checksOutsideBlocks: false if only windows inside the blocks
+ *                                   are valid (0-zeros), then valid is never
+ *                                   called
+ *              Each thread needs its own copy of a policy (scratch buffers).
+ *
+ *              The policies are templates over FixedLength: for FixedLength > 0
+ *              the length of the reads is a compile-time constant, so the
+ *              loop bounds are known and the scratch buffers are arrays in
+ *              the policy. withFixedLength picks the instantiation for the
+ *              common lengths 50, 75, 100, 101, 150 and 250, all other lengths
+ *              use FixedLength = 0 (length at runtime).
+ *              z-zeros is not a 1-block problem (column counters cC), its
+ *              kernels stay in ComputeMatrices.h and ComputeMatricesBitmap.h.
+ *
+ * RUNTIMES: per read: O( l ) inside of the blocks, O( l^2 ) in the worst case
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _Criteria_h
+#define _Criteria_h
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "ZeroOneBitmap.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    // (l,r) in triangles of the 1-blocks of oneBlocks are counted in cT, all
+    // other (l,r) with l < r are counted in c if valid(l,r)
+    template <typename Valid, typename Counter>
+    inline void addRowOutsideOneBlocks(const uint64_t* oneBlocks,
+                                       const int& lengthOfSequence,
+                                       vector<vector<Counter> >& c,
+                                       vector<vector<Counter> >& cT,
+                                       Valid valid)
+    {
+        // without a branch in the inner loop, so it can be vectorised
+        auto checkRows = [&](int firstRow, int lastRow, int firstCol) {
+            for (int row = firstRow; row <= lastRow; row++) {
+                Counter* cRow = c[row].data();
+                for (int col = max(row+1, firstCol); col < lengthOfSequence; col++) {
+                    cRow[col] += valid(row, col);
+                }
+            }
+        };
+
+        int startrow = 0;
+        ZeroOneBitmap::forEachOneBlock(oneBlocks, lengthOfSequence, [&](int start, int end) {
+            cT[start][end]++;
+            // HORIZONTAL
+            checkRows(startrow, start-1, 0);
+            // VERTICAL: everything right of the triangle induced by [start,end]
+            checkRows(start, end, end+1);
+            startrow = end + 1;
+        });
+        // everything after last triangle of 1s
+        checkRows(startrow, lengthOfSequence-1, 0);
+    }
+
+    // 0-zeros: count each maximal 1-block [start,end] in cT
+    template <typename Counter>
+    inline void addZeroOneRowBits(const uint64_t* g,
+                                  const int& lengthOfSequence,
+                                  vector<vector<Counter> >& cT)
+    {
+        ZeroOneBitmap::forEachOneBlock(g, lengthOfSequence, [&](int start, int end) {
+            cT[start][end]++;
+        });
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    // read lengths known at compile time
+
+    template <int FixedLength>
+    inline int readLength(const int& lengthOfSequence) {
+        return FixedLength > 0 ? FixedLength : lengthOfSequence;
+    }
+
+    // Size values in the object itself or, for Size == 0, in a vector
+    template <typename T, int Size>
+    struct ScratchBuffer {
+        alignas(16) T values[Size];
+        explicit ScratchBuffer(const int&) : values() {}
+        T*       data()                     { return values; }
+        T&       operator[](const int& i)       { return values[i]; }
+        const T& operator[](const int& i) const { return values[i]; }
+    };
+
+    template <typename T>
+    struct ScratchBuffer<T, 0> {
+        vector<T> values;
+        explicit ScratchBuffer(const int& size) : values(size, T()) {}
+        T*       data()                     { return values.data(); }
+        T&       operator[](const int& i)       { return values[i]; }
+        const T& operator[](const int& i) const { return values[i]; }
+    };
+
+    // sizes of the scratch buffers (0 = runtime length)
+    template <int FixedLength>
+    struct FixedSizes {
+        static const int partialSums = FixedLength > 0 ? FixedLength + 1 : 0;
+        static const int words       = FixedLength > 0 ? (FixedLength + 63) / 64 : 0;
+    };
+
+    // returns f(Criterion<N>(lengthOfSequence, args...)) with N = lengthOfSequence
+    // for the common read lengths and N = 0 for all others
+    template <template <int> class Criterion, typename F, typename... Args>
+    auto withFixedLength(const F& f, const int& lengthOfSequence, const Args&... args)
+        -> decltype(f(Criterion<0>(lengthOfSequence, args...)))
+    {
+        switch (lengthOfSequence) {
+            case 50:  return f(Criterion<50>(lengthOfSequence, args...));
+            case 75:  return f(Criterion<75>(lengthOfSequence, args...));
+            case 100: return f(Criterion<100>(lengthOfSequence, args...));
+            case 101: return f(Criterion<101>(lengthOfSequence, args...));
+            case 150: return f(Criterion<150>(lengthOfSequence, args...));
+            case 250: return f(Criterion<250>(lengthOfSequence, args...));
+            default:  return f(Criterion<0>(lengthOfSequence, args...));
+        }
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    // criterion policies
+
+    // 0-zeros: only the 1-blocks for the threshold
+    template <int FixedLength = 0>
+    struct ZeroOneCriterion {
+        static const bool checksOutsideBlocks = false;
+        int              lengthOfSequence;
+        int              thresholdPlusShift;
+        ScratchBuffer<uint64_t, FixedSizes<FixedLength>::words> g;
+
+        ZeroOneCriterion(const int& lengthOfSequence, const int& thresholdPlusShift)
+        : lengthOfSequence(lengthOfSequence), thresholdPlusShift(thresholdPlusShift),
+          g(ZeroOneBitmap::wordsPerRead(lengthOfSequence)) {}
+
+        int length() const { return readLength<FixedLength>(lengthOfSequence); }
+
+        const uint64_t* oneBlocks(const string& zeile) {
+            ZeroOneBitmap::packRead(zeile, length(), thresholdPlusShift, g.data());
+            return g.data();
+        }
+        const uint64_t* oneBlocksBits(const uint64_t* bits) { return bits; }
+        bool valid(const int&, const int&) const { return false; }
+    };
+
+    // p-percent: at most preCompAllowedZeros[width] zeros in the window
+    template <int FixedLength = 0>
+    struct PercentCriterion {
+        static const bool checksOutsideBlocks = true;
+        int              lengthOfSequence;
+        int              thresholdPlusShift;
+        ScratchBuffer<int, FixedSizes<FixedLength>::partialSums> preCompAllowedZeros;
+        ScratchBuffer<int, FixedSizes<FixedLength>::partialSums> partialSums; // #zeros in g[L..R] = partialSums[R+1] - partialSums[L]
+        ScratchBuffer<uint64_t, FixedSizes<FixedLength>::words>  g;
+
+        PercentCriterion(const int& lengthOfSequence,
+                         const double& percentOfAllowedZerosPerSequence,
+                         const int& thresholdPlusShift)
+        : lengthOfSequence(lengthOfSequence), thresholdPlusShift(thresholdPlusShift),
+          preCompAllowedZeros(lengthOfSequence+1), partialSums(lengthOfSequence+1),
+          g(ZeroOneBitmap::wordsPerRead(lengthOfSequence))
+        {
+            // pre compute allowed zeros per width for given percent
+            for (int i = 0; i <= lengthOfSequence; i++) {
+                preCompAllowedZeros[i] = (int) (percentOfAllowedZerosPerSequence * i);
+            }
+        }
+
+        int length() const { return readLength<FixedLength>(lengthOfSequence); }
+
+        const uint64_t* oneBlocks(const string& zeile) {
+            ZeroOneBitmap::packRead(zeile, length(), thresholdPlusShift, g.data());
+            return oneBlocksBits(g.data());
+        }
+        const uint64_t* oneBlocksBits(const uint64_t* bits) {
+            partialSums[0] = 0;
+            for (int i = 0; i < length(); i++) {
+                partialSums[i+1] = !ZeroOneBitmap::bit(bits, i) + partialSums[i];
+            }
+            return bits;
+        }
+        bool valid(const int& row, const int& col) const {
+            return (partialSums[col+1] - partialSums[row]) <= preCompAllowedZeros[col+1-row];
+        }
+    };
+
+    // m-mean: the (integer) partial sums of the quality scores minus the mean
+    // are >= 0 in the window, positions >= the mean form the 1-blocks
+    template <int FixedLength = 0>
+    struct MeanCriterion {
+        static const bool checksOutsideBlocks = true;
+        int              lengthOfSequence;
+        double           shiftedMean;
+        ScratchBuffer<int, FixedSizes<FixedLength>::partialSums> partialSums;
+        ScratchBuffer<uint64_t, FixedSizes<FixedLength>::words>  g;
+
+        MeanCriterion(const int& lengthOfSequence, const double& shiftedMean)
+        : lengthOfSequence(lengthOfSequence), shiftedMean(shiftedMean),
+          partialSums(lengthOfSequence+1), g(ZeroOneBitmap::wordsPerRead(lengthOfSequence)) {}
+
+        int length() const { return readLength<FixedLength>(lengthOfSequence); }
+
+        const uint64_t* oneBlocks(const string& zeile) {
+            // pre processing to access the mean in O(1)
+            for (int w = 0; w < ZeroOneBitmap::wordsPerRead(length()); w++) {
+                g[w] = 0;
+            }
+            partialSums[0] = 0;
+            for (int i = 0; i < length(); i++) {
+                partialSums[i+1] = (zeile[i] - shiftedMean) + partialSums[i];
+                g[i >> 6] |= ((uint64_t) (zeile[i] >= shiftedMean)) << (i & 63);
+            }
+            return g.data();
+        }
+        bool valid(const int& row, const int& col) const {
+            return (partialSums[col+1] - partialSums[row]) >= 0;
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+
+    // adds a read whose 1-blocks were computed by criterion
+    template <typename Criterion, typename Counter>
+    inline void addOneBlocksRow(const uint64_t* oneBlocks,
+                                const Criterion& criterion,
+                                vector<vector<Counter> >& c,
+                                vector<vector<Counter> >& cT)
+    {
+        if (!Criterion::checksOutsideBlocks) {
+            addZeroOneRowBits(oneBlocks, criterion.length(), cT);
+            return;
+        }
+        addRowOutsideOneBlocks(oneBlocks, criterion.length(), c, cT,
+                               [&](const int& row, const int& col) { return criterion.valid(row, col); });
+    }
+
+    // adds a quality line
+    template <typename Criterion, typename Counter>
+    inline void addCriterionRow(const string& zeile,
+                                Criterion& criterion,
+                                vector<vector<Counter> >& c,
+                                vector<vector<Counter> >& cT)
+    {
+        addOneBlocksRow(criterion.oneBlocks(zeile), criterion, c, cT);
+    }
+
+    // adds a read that is packed into a 0/1 bitmap (see ZeroOneBitmap.h)
+    template <typename Criterion, typename Counter>
+    inline void addCriterionRowBits(const uint64_t* g,
+                                    Criterion& criterion,
+                                    vector<vector<Counter> >& c,
+                                    vector<vector<Counter> >& cT)
+    {
+        addOneBlocksRow(criterion.oneBlocksBits(g), criterion, c, cT);
+    }
+
+}
+
+#endif
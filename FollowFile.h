@@ -0,0 +1,179 @@
+/*******************************************************************************
+ *
+ * FollowFile.h
+ *
+ * DESCRIPTION: Reads the quality lines of a FASTQ file that is still being
+ *              written (e.g. by the basecaller during a sequencing run), like
+ *              tail -f.
+ *              Reader: returns the quality line of the next complete record
+ *                      (4 lines, each ending with '\n'), a record that is
+ *                      only partly written is kept until the rest arrives. At
+ *                      the end of the file it waits for new data with inotify
+ *                      (IN_MODIFY) or, if inotify is not available (limit of
+ *                      watches, network file systems, ...), by polling the
+ *                      file every pollInterval milliseconds.
+ *                      nextQualityLine returns false if no data arrived for
+ *                      idleSeconds (0: wait forever) or after SIGINT or
+ *                      SIGTERM (see installStopHandlers).
+ *
+ *              All methods throw runtime_error if a system call fails.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _FollowFile_h
+#define _FollowFile_h
+
+#include <string>
+#include <chrono>
+#include <thread>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+using namespace std;
+
+namespace FollowFile {
+
+    const int pollInterval = 500;     // milliseconds
+    const int readSize     = 1 << 20; // bytes per read
+
+    // set by SIGINT and SIGTERM
+    inline volatile sig_atomic_t& stopRequested() {
+        static volatile sig_atomic_t flag = 0;
+        return flag;
+    }
+
+    inline void requestStop(int) {
+        stopRequested() = 1;
+    }
+
+    // SIGINT and SIGTERM end the reading instead of the program, so the
+    // reads up to now are still reported
+    inline void installStopHandlers() {
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_handler = requestStop;
+        sigemptyset(&action.sa_mask);
+        sigaction(SIGINT,  &action, nullptr);
+        sigaction(SIGTERM, &action, nullptr);
+    }
+
+    class Reader {
+    public:
+        Reader(const string& inputfile, const int& idleSeconds)
+        : idleSeconds_(idleSeconds), pos_(0), notify_(-1),
+          lastData_(chrono::steady_clock::now())
+        {
+            fd_ = open(inputfile.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd_ < 0) {
+                throw runtime_error("can not open " + inputfile + ": " + strerror(errno));
+            }
+            notify_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+            if (notify_ >= 0 && inotify_add_watch(notify_, inputfile.c_str(), IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+                close(notify_);
+                notify_ = -1; // polling
+            }
+        }
+
+        ~Reader() {
+            if (notify_ >= 0) close(notify_);
+            close(fd_);
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        bool usesInotify() const { return notify_ >= 0; }
+
+        bool nextQualityLine(string& zeile) {
+            while (true) {
+                if (nextRecord(zeile)) {
+                    return true;
+                }
+                if (stopRequested()) {
+                    return false;
+                }
+                if (readMore()) {
+                    continue;
+                }
+                // at the end of the file
+                if (idleSeconds_ > 0 &&
+                    chrono::steady_clock::now() - lastData_ >= chrono::seconds(idleSeconds_)) {
+                    return false;
+                }
+                waitForData();
+            }
+        }
+
+    private:
+        // the quality line of the next complete record in buffer_
+        bool nextRecord(string& zeile) {
+            size_t end = pos_;
+            size_t lineStart[4];
+            for (int line = 0; line < 4; line++) {
+                lineStart[line] = end;
+                end = buffer_.find('\n', end);
+                if (end == string::npos) {
+                    return false;
+                }
+                end++;
+            }
+            zeile.assign(buffer_, lineStart[3], end - 1 - lineStart[3]);
+            pos_ = end;
+            return true;
+        }
+
+        // appends new data of the file to buffer_, false at the end of the file
+        bool readMore() {
+            if (pos_ > 0) {
+                buffer_.erase(0, pos_);
+                pos_ = 0;
+            }
+            size_t size = buffer_.size();
+            buffer_.resize(size + readSize);
+            ssize_t n;
+            do {
+                n = read(fd_, &buffer_[size], readSize);
+            } while (n < 0 && errno == EINTR);
+            if (n < 0) {
+                throw runtime_error(string("read: ") + strerror(errno));
+            }
+            buffer_.resize(size + n);
+            if (n > 0) {
+                lastData_ = chrono::steady_clock::now();
+            }
+            return n > 0;
+        }
+
+        // until the file was modified, at most pollInterval milliseconds
+        void waitForData() {
+            if (notify_ < 0) {
+                this_thread::sleep_for(chrono::milliseconds(pollInterval));
+                return;
+            }
+            pollfd p = {notify_, POLLIN, 0};
+            if (poll(&p, 1, pollInterval) > 0) {
+                char events[4096];
+                while (read(notify_, events, sizeof(events)) > 0) {}
+            }
+        }
+
+        int    idleSeconds_;
+        int    fd_;
+        string buffer_;
+        size_t pos_; // start of the first record in buffer_ that was not returned
+        int    notify_;
+        chrono::steady_clock::time_point lastData_;
+    };
+
+}
+
+#endif
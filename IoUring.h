@@ -0,0 +1,233 @@
+/*******************************************************************************
+ *
+ * IoUring.h
+ *
+ * DESCRIPTION: Sequential reading of a file with io_uring (Linux >= 5.6),
+ *              directly with the system calls (no liburing needed).
+ *              available:        true, if the kernel supports io_uring and
+ *                                IORING_OP_READ (not forbidden by seccomp,
+ *                                io_uring_disabled, ...)
+ *              SequentialReader: keeps depth reads of blockSize bytes in
+ *                                flight and returns the blocks in the order of
+ *                                the file. A block stays valid until the next
+ *                                call of next(). With direct = true the file
+ *                                must be opened with O_DIRECT, the buffers are
+ *                                aligned to 4096 bytes.
+ *
+ *              All methods throw runtime_error if a system call fails, so a
+ *              caller can fall back to another reader.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _IoUring_h
+#define _IoUring_h
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdint>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+using namespace std;
+
+namespace IoUring {
+
+    inline int setup(const unsigned& entries, io_uring_params& p) {
+        return (int) syscall(__NR_io_uring_setup, entries, &p);
+    }
+
+    inline int enter(const int& fd, const unsigned& toSubmit, const unsigned& minComplete) {
+        return (int) syscall(__NR_io_uring_enter, fd, toSubmit, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0);
+    }
+
+    class Ring {
+    public:
+        Ring(const unsigned& entries) : fd_(-1), sq_(MAP_FAILED), cq_(MAP_FAILED), sqes_(MAP_FAILED) {
+            io_uring_params p;
+            memset(&p, 0, sizeof(io_uring_params));
+            fd_ = setup(entries, p);
+            if (fd_ < 0) {
+                throw runtime_error(string("io_uring_setup: ") + strerror(errno));
+            }
+            sqSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            cqSize_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            sq_ = mmap(nullptr, sqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+            cq_ = mmap(nullptr, cqSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+            sqesSize_ = p.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+            if (sq_ == MAP_FAILED || cq_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+                release();
+                throw runtime_error(string("io_uring mmap: ") + strerror(errno));
+            }
+            char* sq = (char*) sq_;
+            char* cq = (char*) cq_;
+            sqHead_  = (unsigned*) (sq + p.sq_off.head);
+            sqTail_  = (unsigned*) (sq + p.sq_off.tail);
+            sqMask_  = (unsigned*) (sq + p.sq_off.ring_mask);
+            sqArray_ = (unsigned*) (sq + p.sq_off.array);
+            cqHead_  = (unsigned*) (cq + p.cq_off.head);
+            cqTail_  = (unsigned*) (cq + p.cq_off.tail);
+            cqMask_  = (unsigned*) (cq + p.cq_off.ring_mask);
+            cqes_    = (io_uring_cqe*) (cq + p.cq_off.cqes);
+            pending_ = 0;
+        }
+
+        ~Ring() { release(); }
+
+        Ring(const Ring&) = delete;
+        Ring& operator=(const Ring&) = delete;
+
+        // queues a read, it is submitted by the next wait()
+        void read(const int& fd, void* buffer, const unsigned& length,
+                  const uint64_t& offset, const uint64_t& userData) {
+            unsigned tail = *sqTail_;
+            unsigned index = tail & *sqMask_;
+            io_uring_sqe* sqe = (io_uring_sqe*) sqes_ + index;
+            memset(sqe, 0, sizeof(io_uring_sqe));
+            sqe->opcode    = IORING_OP_READ;
+            sqe->fd        = fd;
+            sqe->addr      = (uint64_t) buffer;
+            sqe->len       = length;
+            sqe->off       = offset;
+            sqe->user_data = userData;
+            sqArray_[index] = index;
+            __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+            pending_++;
+        }
+
+        // submits the queued reads and waits for one completion
+        io_uring_cqe wait() {
+            while (true) {
+                unsigned head = *cqHead_;
+                if (head != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+                    io_uring_cqe cqe = cqes_[head & *cqMask_];
+                    __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+                    return cqe;
+                }
+                int submitted = enter(fd_, pending_, 1);
+                if (submitted < 0) {
+                    if (errno == EINTR) continue;
+                    throw runtime_error(string("io_uring_enter: ") + strerror(errno));
+                }
+                pending_ -= submitted;
+            }
+        }
+
+    private:
+        void release() {
+            if (sqes_ != MAP_FAILED) munmap(sqes_, sqesSize_);
+            if (cq_ != MAP_FAILED) munmap(cq_, cqSize_);
+            if (sq_ != MAP_FAILED) munmap(sq_, sqSize_);
+            if (fd_ >= 0) close(fd_);
+        }
+
+        int           fd_;
+        void          *sq_, *cq_, *sqes_;
+        size_t        sqSize_, cqSize_, sqesSize_;
+        unsigned      *sqHead_, *sqTail_, *sqMask_, *sqArray_;
+        unsigned      *cqHead_, *cqTail_, *cqMask_;
+        io_uring_cqe* cqes_;
+        unsigned      pending_;
+    };
+
+    inline bool available() {
+        try {
+            Ring ring(2);
+            // a read of 0 bytes from stdin checks IORING_OP_READ (Linux >= 5.6)
+            char c;
+            ring.read(0, &c, 0, 0, 0);
+            io_uring_cqe cqe = ring.wait();
+            return cqe.res != -EINVAL && cqe.res != -EOPNOTSUPP;
+        } catch (runtime_error&) {
+            return false;
+        }
+    }
+
+    class SequentialReader {
+    public:
+        SequentialReader(const int& fd, const uint64_t& fileSize,
+                         const size_t& blockSize = 1 << 20, const int& depth = 8,
+                         const bool& direct = false)
+        : fd_(fd), fileSize_(fileSize), blockSize_(blockSize), depth_(depth), direct_(direct),
+          ring_(depth), buffers_(depth, nullptr), lengths_(depth, -1), nextBlock_(0), submitted_(0)
+        {
+            for (int k = 0; k < depth_; k++) {
+                if (posix_memalign((void**) &buffers_[k], 4096, blockSize_) != 0) {
+                    freeBuffers();
+                    throw runtime_error("cannot allocate the io_uring buffers");
+                }
+            }
+            for (int k = 0; k < depth_; k++) submit();
+        }
+
+        ~SequentialReader() { freeBuffers(); }
+
+        SequentialReader(const SequentialReader&) = delete;
+        SequentialReader& operator=(const SequentialReader&) = delete;
+
+        // next block of the file, 0 at the end of the file
+        size_t next(const char*& data) {
+            if (nextBlock_ > 0) {
+                submit(); // reuse the buffer of the last block
+            }
+            uint64_t offset = nextBlock_ * blockSize_;
+            if (offset >= fileSize_) return 0;
+            int slot = nextBlock_ % depth_;
+            while (lengths_[slot] < 0) {
+                io_uring_cqe cqe = ring_.wait();
+                if (cqe.res < 0) {
+                    throw runtime_error(string("io_uring read: ") + strerror(-cqe.res));
+                }
+                lengths_[cqe.user_data] = cqe.res;
+            }
+            size_t expected = min((uint64_t) blockSize_, fileSize_ - offset);
+            size_t length = lengths_[slot];
+            // short read inside of the file: read the rest synchronously
+            while (length < expected && !direct_) {
+                ssize_t r = pread(fd_, buffers_[slot] + length, expected - length, offset + length);
+                if (r <= 0) break;
+                length += r;
+            }
+            lengths_[slot] = -1;
+            nextBlock_++;
+            data = buffers_[slot];
+            return length;
+        }
+
+    private:
+        void submit() {
+            uint64_t offset = submitted_ * blockSize_;
+            if (offset >= fileSize_) return;
+            int slot = submitted_ % depth_;
+            ring_.read(fd_, buffers_[slot], blockSize_, offset, slot);
+            submitted_++;
+        }
+
+        void freeBuffers() {
+            for (char* b: buffers_) free(b);
+        }
+
+        int             fd_;
+        uint64_t        fileSize_;
+        size_t          blockSize_;
+        int             depth_;
+        bool            direct_;
+        Ring            ring_;
+        vector<char*>   buffers_;
+        vector<long>    lengths_;   // -1 = read in flight
+        uint64_t        nextBlock_; // next block for next()
+        uint64_t        submitted_; // next block to submit
+    };
+
+}
+
+#endif
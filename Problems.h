@@ -0,0 +1,209 @@
+/*******************************************************************************
+ *
+ * Problems.h
+ *
+ * DESCRIPTION: The four problems 0-zeros, z-zeros, p-percent and m-mean as
+ *              exchangeable objects for pipelines that do not care which
+ *              problem they solve (e.g. the batch mode). A Problem consists of
+ *              makeKernel: creates a kernel that adds one quality line to
+ *                          RowCounters. Each worker thread creates its own
+ *                          kernel, so the kernel may own scratch buffers.
+ *              finalize:   turns the counters into the matrix c, where c(l,r)
+ *                          is the number of reads that fulfill the problem in
+ *                          the window [l,r].
+ *              selects:    true, if a quality line fulfills the problem in the
+ *                          window [l,r] (for the output of the selected reads).
+ *              RowCounters are additive: counters of different threads (or
+ *              files) may be added before finalize is called.
+ *
+ *              The kernels of 0-zeros, p-percent and m-mean are the criterion
+ *              policies of Criteria.h.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _Problems_h
+#define _Problems_h
+
+#include <string>
+#include <vector>
+#include <functional>
+
+#include "ComputeMatricesBitmap.h"
+#include "Criteria.h"
+
+using namespace std;
+
+namespace ComputeMatrices {
+
+    struct RowCounters {
+        vector<vector<int> > c;   // (l,r) counted directly
+        vector<vector<int> > aux; // triangle counters cT or column counters cC
+
+        RowCounters(const int& lengthOfSequence)
+        : c (lengthOfSequence, vector<int>(lengthOfSequence,0)),
+          aux (lengthOfSequence, vector<int>(lengthOfSequence,0)) {}
+
+        void add(const RowCounters& other) {
+            for (size_t i = 0; i < c.size(); i++) {
+                for (size_t j = 0; j < c.size(); j++) {
+                    c[i][j]   += other.c[i][j];
+                    aux[i][j] += other.aux[i][j];
+                }
+            }
+        }
+
+        void clear() {
+            for (size_t i = 0; i < c.size(); i++) {
+                fill(c[i].begin(), c[i].end(), 0);
+                fill(aux[i].begin(), aux[i].end(), 0);
+            }
+        }
+    };
+
+    typedef function<void(const string&, RowCounters&)> Kernel;
+
+    struct Problem {
+        string                                name;
+        int                                   lengthOfSequence;
+        function<Kernel()>                    makeKernel;
+        function<vector<vector<int> >(const RowCounters&)> finalize;
+        function<bool(const string&, const int&, const int&)> selects;
+    };
+
+    // the kernel of the criterion chosen by withFixedLength (see Criteria.h)
+    struct CriterionKernel {
+        template <typename Criterion>
+        Kernel operator()(Criterion criterion) const {
+            return [=](const string& zeile, RowCounters& counters) mutable {
+                addCriterionRow(zeile, criterion, counters.c, counters.aux);
+            };
+        }
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+
+    Problem zeroOneProblem(const int& lengthOfSequence,
+                           const int& thresholdGoodValues,
+                           const int& shiftToConvertChars)
+    {
+        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
+        Problem p;
+        p.name = "0-zeros";
+        p.lengthOfSequence = lengthOfSequence;
+        p.makeKernel = [=]() -> Kernel {
+            return withFixedLength<ZeroOneCriterion>(CriterionKernel(), lengthOfSequence,
+                                                     thresholdPlusShift);
+        };
+        p.finalize = [=](const RowCounters& counters) {
+            vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
+            addTriangleCounts(counters.aux, c, lengthOfSequence);
+            return c;
+        };
+        p.selects = [=](const string& zeile, const int& left, const int& right) {
+            for (int i = left; i <= right; i++) {
+                if (zeile[i] < thresholdPlusShift) return false;
+            }
+            return true;
+        };
+        return p;
+    }
+
+    Problem zerosAllowedProblem(const int& lengthOfSequence,
+                                const int& numberOfAllowedZerosPerSequence,
+                                const int& thresholdGoodValues,
+                                const int& shiftToConvertChars)
+    {
+        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
+        Problem p;
+        p.name = "z-zeros";
+        p.lengthOfSequence = lengthOfSequence;
+        p.makeKernel = [=]() -> Kernel {
+            vector<uint64_t> g(ZeroOneBitmap::wordsPerRead(lengthOfSequence));
+            vector<int> positionsOfZeros(lengthOfSequence,0);
+            return [=](const string& zeile, RowCounters& counters) mutable {
+                ZeroOneBitmap::packRead(zeile, lengthOfSequence, thresholdPlusShift, g.data());
+                addZerosAllowedRowBits(g.data(), lengthOfSequence, numberOfAllowedZerosPerSequence,
+                                       counters.aux, positionsOfZeros);
+            };
+        };
+        p.finalize = [=](const RowCounters& counters) {
+            vector<vector<int> > c (lengthOfSequence, vector<int>(lengthOfSequence,0));
+            addColumnCounts(counters.aux, c, lengthOfSequence);
+            return c;
+        };
+        p.selects = [=](const string& zeile, const int& left, const int& right) {
+            int zeros = 0;
+            for (int i = left; i <= right; i++) {
+                zeros += (zeile[i] < thresholdPlusShift);
+            }
+            return zeros <= numberOfAllowedZerosPerSequence;
+        };
+        return p;
+    }
+
+    Problem percentZerosAllowedProblem(const int& lengthOfSequence,
+                                       const double& percentOfAllowedZerosPerSequence,
+                                       const int& thresholdGoodValues,
+                                       const int& shiftToConvertChars)
+    {
+        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
+        // pre compute allowed zeros per width for given percent
+        vector<int> preCompAllowedZeros (lengthOfSequence+1);
+        for (int i = 0; i <= lengthOfSequence; i++) {
+            preCompAllowedZeros[i] = (int) (percentOfAllowedZerosPerSequence * i);
+        }
+        Problem p;
+        p.name = "p-percent";
+        p.lengthOfSequence = lengthOfSequence;
+        p.makeKernel = [=]() -> Kernel {
+            return withFixedLength<PercentCriterion>(CriterionKernel(), lengthOfSequence,
+                                                     percentOfAllowedZerosPerSequence, thresholdPlusShift);
+        };
+        p.finalize = [=](const RowCounters& counters) {
+            vector<vector<int> > c = counters.c;
+            addTriangleCounts(counters.aux, c, lengthOfSequence);
+            return c;
+        };
+        p.selects = [=](const string& zeile, const int& left, const int& right) {
+            int zeros = 0;
+            for (int i = left; i <= right; i++) {
+                zeros += (zeile[i] < thresholdPlusShift);
+            }
+            return zeros <= preCompAllowedZeros[right-left+1];
+        };
+        return p;
+    }
+
+    Problem meanProblem(const int& lengthOfSequence,
+                        const double& givenMean,
+                        const int& shiftToConvertChars)
+    {
+        double shiftedMean = shiftToConvertChars + givenMean;
+        Problem p;
+        p.name = "m-mean";
+        p.lengthOfSequence = lengthOfSequence;
+        p.makeKernel = [=]() -> Kernel {
+            return withFixedLength<MeanCriterion>(CriterionKernel(), lengthOfSequence, shiftedMean);
+        };
+        p.finalize = [=](const RowCounters& counters) {
+            vector<vector<int> > c = counters.c;
+            addTriangleCounts(counters.aux, c, lengthOfSequence);
+            return c;
+        };
+        // same (integer) partial sums as in MeanCriterion
+        p.selects = [=](const string& zeile, const int& left, const int& right) {
+            int partialSum = 0, partialSumBeforeLeft = 0;
+            for (int i = 0; i <= right; i++) {
+                if (i == left) partialSumBeforeLeft = partialSum;
+                partialSum = (zeile[i] - shiftedMean) + partialSum;
+            }
+            return partialSum - partialSumBeforeLeft >= 0;
+        };
+        return p;
+    }
+
+}
+
+#endif
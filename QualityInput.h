@@ -0,0 +1,374 @@
+/*******************************************************************************
+ *
+ * QualityInput.h
+ *
+ * DESCRIPTION: Sequential access to the quality lines of the input file. The
+ *              input is either a FASTQ file (every forth line is a quality
+ *              line) or a quality store written by convertToQualityStore
+ *              (see QualityStore.h). The format is detected by the magic
+ *              bytes at the beginning of the file.
+ *
+ *              Reader backends for FASTQ files (setReader, --reader):
+ *              ifstream: in.ignore and getline (default)
+ *              io_uring: depth reads of blockSize bytes in flight
+ *                        (IoUring.h), the parser takes the blocks in the
+ *                        order of the file
+ *              threads:  min(depth,4) I/O threads read the blocks with
+ *                        pread, at most depth blocks are read ahead
+ *              auto:     io_uring if the kernel supports it, else threads
+ *              If io_uring cannot be used, io_uring falls back to threads,
+ *              if the file cannot be opened all fall back to ifstream. A read
+ *              error is printed and ends the input.
+ *              The backend that is used is written to the --stats report.
+ *
+ *              checkQualityStore: --reads and --length of a quality store
+ *              must fit its header (a FASTQ file is not checked)
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _QualityInput_h
+#define _QualityInput_h
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "QualityStore.h"
+#include "Stats.h"
+#include "IoUring.h"
+
+using namespace std;
+
+namespace QualityInput {
+
+    const vector<string> readers = {"ifstream", "io_uring", "threads", "auto"};
+
+    struct Settings {
+        string reader;
+        int    depth;      // blocks in flight
+        size_t blockSize;  // bytes per read
+        Settings() : reader("ifstream"), depth(8), blockSize(1 << 20) {}
+    };
+
+    inline Settings& settings() {
+        static Settings s;
+        return s;
+    }
+
+    // reader backend and queue depth of all QualityLineReaders opened later
+    inline void setReader(const string& reader, const int& depth) {
+        settings().reader = reader;
+        settings().depth  = depth;
+    }
+
+    // a quality store has numberOfReads reads of lengthOfSequence, reading
+    // more reads or reads of another length is an error
+    void checkQualityStore(const string& inputfile,
+                           const int& numberOfSequences,
+                           const int& lengthOfSequence) {
+        if (!QualityStore::isQualityStore(inputfile)) {
+            return;
+        }
+        QualityStore::Reader store(inputfile);
+        const QualityStore::Header& header = store.header();
+        if ((uint32_t) lengthOfSequence != header.lengthOfSequence) {
+            throw runtime_error(inputfile + " is a quality store of reads of length "
+                                + to_string(header.lengthOfSequence) + ", not "
+                                + to_string(lengthOfSequence));
+        }
+        if (numberOfSequences < 0 || (uint64_t) numberOfSequences > header.numberOfReads) {
+            throw runtime_error(inputfile + " is a quality store of "
+                                + to_string(header.numberOfReads) + " reads, not "
+                                + to_string(numberOfSequences));
+        }
+    }
+
+    // blocks of a file in the order of the file
+    class BlockSource {
+    public:
+        virtual ~BlockSource() {}
+        // next block, valid until the next call, 0 at the end of the file
+        virtual size_t next(const char*& data) = 0;
+    };
+
+    class IoUringSource : public BlockSource {
+    public:
+        IoUringSource(const int& fd, const uint64_t& fileSize, const Settings& s)
+        : reader_(fd, fileSize, s.blockSize, s.depth) {}
+        size_t next(const char*& data) { return reader_.next(data); }
+    private:
+        IoUring::SequentialReader reader_;
+    };
+
+    class ThreadSource : public BlockSource {
+    public:
+        ThreadSource(const int& fd, const uint64_t& fileSize, const Settings& s)
+        : fd_(fd), fileSize_(fileSize), blockSize_(s.blockSize), depth_(s.depth),
+          buffers_(s.depth, vector<char>(s.blockSize)), lengths_(s.depth, -1),
+          nextBlock_(0), consumed_(0), claimed_(0), stop_(false)
+        {
+            int numberOfThreads = min(depth_, 4);
+            for (int k = 0; k < numberOfThreads; k++) {
+                threads_.push_back(thread(&ThreadSource::run, this));
+            }
+        }
+
+        ~ThreadSource() {
+            {
+                lock_guard<mutex> lock(m_);
+                stop_ = true;
+            }
+            cond_.notify_all();
+            for (auto& t: threads_) t.join();
+        }
+
+        size_t next(const char*& data) {
+            unique_lock<mutex> lock(m_);
+            if (nextBlock_ > 0) {
+                // the buffer of the last block can be read again
+                consumed_ = nextBlock_;
+                cond_.notify_all();
+            }
+            if (nextBlock_ * blockSize_ >= fileSize_) return 0;
+            int slot = nextBlock_ % depth_;
+            while (lengths_[slot] < 0) cond_.wait(lock);
+            if (error_ != "") throw runtime_error(error_);
+            size_t length = lengths_[slot];
+            lengths_[slot] = -1;
+            nextBlock_++;
+            data = buffers_[slot].data();
+            return length;
+        }
+
+    private:
+        // I/O thread: claims the next block and reads it into its slot
+        void run() {
+            Stats::ThreadScope statsThread("io");
+            while (true) {
+                uint64_t block;
+                {
+                    unique_lock<mutex> lock(m_);
+                    while (!stop_ && claimed_ * blockSize_ < fileSize_ && claimed_ >= consumed_ + depth_) {
+                        cond_.wait(lock);
+                    }
+                    if (stop_ || claimed_ * blockSize_ >= fileSize_) return;
+                    block = claimed_++;
+                }
+                const int slot = block % depth_;
+                const uint64_t offset = block * blockSize_;
+                const size_t expected = min((uint64_t) blockSize_, fileSize_ - offset);
+                size_t length = 0;
+                string error;
+                {
+                    Stats::Stage io(Stats::Io);
+                    while (length < expected) {
+                        ssize_t r = pread(fd_, buffers_[slot].data() + length, expected - length, offset + length);
+                        if (r < 0 && errno == EINTR) continue;
+                        if (r < 0) error = string("read: ") + strerror(errno);
+                        if (r <= 0) break;
+                        length += r;
+                    }
+                }
+                {
+                    lock_guard<mutex> lock(m_);
+                    if (error != "" && error_ == "") error_ = error;
+                    lengths_[slot] = length;
+                }
+                cond_.notify_all();
+            }
+        }
+
+        int                    fd_;
+        uint64_t               fileSize_;
+        size_t                 blockSize_;
+        int                    depth_;
+        vector<vector<char> >  buffers_;
+        vector<long>           lengths_;   // -1 = not read yet
+        uint64_t               nextBlock_; // next block for next()
+        uint64_t               consumed_;  // blocks given back by next()
+        uint64_t               claimed_;   // next block for an I/O thread
+        bool                   stop_;
+        string                 error_;
+        mutex                  m_;
+        condition_variable     cond_;
+        vector<thread>         threads_;
+    };
+
+    // lines of the blocks of a BlockSource
+    class BlockLineReader {
+    public:
+        BlockLineReader(const string& inputfile, const string& reader) : fd_(-1), data_(nullptr), pos_(0), length_(0) {
+            fd_ = open(inputfile.c_str(), O_RDONLY);
+            if (fd_ < 0) {
+                throw runtime_error("cannot open " + inputfile + ": " + strerror(errno));
+            }
+            struct stat st;
+            if (fstat(fd_, &st) != 0) {
+                close(fd_);
+                throw runtime_error("cannot stat " + inputfile + ": " + strerror(errno));
+            }
+            posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+            const Settings& s = settings();
+            if (reader == "io_uring" || reader == "auto") {
+                try {
+                    if (IoUring::available()) {
+                        source_.reset(new IoUringSource(fd_, st.st_size, s));
+                        name_ = "io_uring";
+                    }
+                } catch (runtime_error&) {
+                    source_.reset();
+                }
+            }
+            if (!source_) {
+                source_.reset(new ThreadSource(fd_, st.st_size, s));
+                name_ = "threads";
+            }
+        }
+
+        ~BlockLineReader() {
+            source_.reset();
+            close(fd_);
+        }
+
+        // backend that is used
+        const string& name() const { return name_; }
+
+        // skips a line, false at the end of the file
+        bool skipLine() {
+            while (true) {
+                if (pos_ == length_ && !refill()) return false;
+                const char* nl = (const char*) memchr(data_ + pos_, '\n', length_ - pos_);
+                if (nl != nullptr) {
+                    pos_ = nl - data_ + 1;
+                    return true;
+                }
+                pos_ = length_;
+            }
+        }
+
+        // the next line without '\n' (as getline), false at the end of the file
+        bool getLine(string& zeile) {
+            zeile.clear();
+            bool any = false;
+            while (true) {
+                if (pos_ == length_ && !refill()) return any;
+                any = true;
+                const char* start = data_ + pos_;
+                const char* nl = (const char*) memchr(start, '\n', length_ - pos_);
+                if (nl != nullptr) {
+                    zeile.append(start, nl - start);
+                    pos_ = nl - data_ + 1;
+                    return true;
+                }
+                zeile.append(start, length_ - pos_);
+                pos_ = length_;
+            }
+        }
+
+    private:
+        // a read error ends the file (as in ifstream)
+        bool refill() {
+            pos_ = 0;
+            try {
+                length_ = source_->next(data_);
+            } catch (runtime_error& e) {
+                cerr << "ERROR: " << e.what() << endl;
+                length_ = 0;
+            }
+            return length_ > 0;
+        }
+
+        int                     fd_;
+        unique_ptr<BlockSource> source_;
+        string                  name_;
+        const char*             data_;
+        size_t                  pos_, length_;
+    };
+
+}
+
+class QualityLineReader {
+public:
+
+    QualityLineReader(const string& inputfile) : nextRead_(0) {
+        Stats::Stage open(Stats::Open);
+        if (QualityStore::isQualityStore(inputfile)) {
+            store_.reset(new QualityStore::Reader(inputfile));
+            Stats::setReader("quality_store");
+            return;
+        }
+        if (QualityInput::settings().reader != "ifstream") {
+            try {
+                blocks_.reset(new QualityInput::BlockLineReader(inputfile, QualityInput::settings().reader));
+                Stats::setReader(blocks_->name());
+                return;
+            } catch (runtime_error&) {
+                blocks_.reset(); // e.g. no such file, handled as by ifstream
+            }
+        }
+        in_.open(inputfile, ios::in);
+        Stats::setReader("ifstream");
+    }
+
+    // store the next quality line in zeile, false if there is none
+    bool nextQualityLine(string& zeile) {
+        if (store_) {
+            if (nextRead_ >= store_->header().numberOfReads) {
+                return false;
+            }
+            store_->decodeRead(nextRead_++, zeile);
+            return true;
+        }
+        if (blocks_) {
+            blocks_->skipLine(); // skip 3 lines
+            blocks_->skipLine(); // skip 3 lines
+            blocks_->skipLine(); // skip 3 lines
+            return blocks_->getLine(zeile);
+        }
+        in_.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+        in_.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+        in_.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+        return (bool) getline(in_,zeile);
+    }
+
+    // store the header line and the quality line of the next read in header
+    // and zeile, false if there is none (FASTQ files only)
+    bool nextRecord(string& header, string& zeile) {
+        if (store_) {
+            throw runtime_error("a quality store has no header lines, use the FASTQ file");
+        }
+        if (blocks_) {
+            blocks_->getLine(header);
+            blocks_->skipLine(); // skip 2 lines
+            blocks_->skipLine(); // skip 2 lines
+            return blocks_->getLine(zeile);
+        }
+        getline(in_,header);
+        in_.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 2 lines
+        in_.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 2 lines
+        return (bool) getline(in_,zeile);
+    }
+
+private:
+    ifstream                                  in_;
+    unique_ptr<QualityStore::Reader>          store_;
+    unique_ptr<QualityInput::BlockLineReader> blocks_;
+    uint64_t                                  nextRead_;
+};
+
+#endif
@@ -0,0 +1,359 @@
+/*******************************************************************************
+ *
+ * QualityStore.h
+ *
+ * DESCRIPTION: Compact binary file that holds only the quality lines of a
+ *              FASTQ file. Header and sequence lines are dropped, the quality
+ *              chars are optionally binned and then bit-packed: with k
+ *              different chars each quality score needs ceil(log2(k)) bits.
+ *              Every read occupies the same number of bytes, so read z starts
+ *              at dataOffset + z * bytesPerRead.
+ *
+ *              Layout: | Header | read 0 | read 1 | ... | read r-1 |
+ *
+ *              convertFASTQ: writes a quality store for a FASTQ file
+ *              Reader:       memory-maps a quality store and decodes single
+ *                            reads back into quality strings
+ *              InMemory:     the same layout in memory, loaded from a quality
+ *                            store or packed from a FASTQ file (trimServer)
+ *              checkBins:    compares a binned quality store with its FASTQ
+ *                            file at every bin border
+ *
+ * RUNTIMES: If the input has r reads of length l:
+ *           convertFASTQ: O( r * l ) (two passes over the FASTQ file)
+ *           decodeRead:   O( l )
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _QualityStore_h
+#define _QualityStore_h
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <limits>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace QualityStore {
+
+    const char     magic[8] = {'S','E','Q','T','R','Q','S','1'};
+    const uint32_t version  = 1;
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t bitsPerQuality;
+        uint64_t numberOfReads;
+        uint32_t lengthOfSequence;
+        int32_t  shiftToConvertChars;  // offset of the original FASTQ file
+        uint32_t bytesPerRead;
+        uint32_t numberOfCodes;
+        char     codeToChar[256];      // decoding table: code -> quality char
+        uint64_t dataOffset;
+    };
+
+    // bin a quality char: the quality score q = c - shift is replaced by the
+    // largest bin border <= q, a score below the first border by the first
+    // border - 1. Rounding down keeps the decision "q >= t" of the 0/1
+    // problems exact for every threshold t that is a bin border.
+    inline char binChar(const char& c, const int& shiftToConvertChars, const vector<int>& bins) {
+        if (bins.empty()) {
+            return c;
+        }
+        int q = c - shiftToConvertChars;
+        int binned = bins[0] - 1;
+        for (int b: bins) {
+            if (b <= q) {
+                binned = b;
+            }
+        }
+        return (char) (binned + shiftToConvertChars);
+    }
+
+    // packs the quality lines of a FASTQ file: write gets the header and then
+    // the packed reads one by one. bins must be sorted ascending, an empty
+    // vector means "no binning".
+    void packFASTQ(const string& inputfile,
+                   const int& numberOfSequences,
+                   const int& lengthOfSequence,
+                   const int& shiftToConvertChars,
+                   const vector<int>& bins,
+                   const function<void(const char*, const size_t&)>& write)
+    {
+        string zeile;
+
+        // first pass: which (binned) chars occur?
+        vector<bool> used(256,false);
+        ifstream in(inputfile, ios::in);
+        if (!in) {
+            throw runtime_error("cannot open " + inputfile);
+        }
+        for (int z = 0; z < numberOfSequences; z++) {
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            getline(in,zeile);
+            for (int i = 0; i < lengthOfSequence; i++) {
+                used[(unsigned char) binChar(zeile[i], shiftToConvertChars, bins)] = true;
+            }
+        }
+
+        // codes are assigned in ascending order of the chars, so comparisons
+        // of codes and chars are equivalent
+        Header h;
+        memset(&h, 0, sizeof(Header));
+        memcpy(h.magic, magic, sizeof(magic));
+        h.version             = version;
+        h.numberOfReads       = numberOfSequences;
+        h.lengthOfSequence    = lengthOfSequence;
+        h.shiftToConvertChars = shiftToConvertChars;
+        vector<uint8_t> charToCode(256,0);
+        for (int c = 0; c < 256; c++) {
+            if (used[c]) {
+                charToCode[c] = h.numberOfCodes;
+                h.codeToChar[h.numberOfCodes] = (char) c;
+                h.numberOfCodes++;
+            }
+        }
+        h.bitsPerQuality = 1;
+        while ((1u << h.bitsPerQuality) < h.numberOfCodes) {
+            h.bitsPerQuality++;
+        }
+        h.bytesPerRead = (lengthOfSequence * h.bitsPerQuality + 7) / 8;
+        h.dataOffset   = sizeof(Header);
+
+        write((const char*) &h, sizeof(Header));
+
+        // second pass: pack the codes (LSB first)
+        in.clear();
+        in.seekg(0, ios::beg);
+        vector<uint8_t> packed(h.bytesPerRead);
+        for (int z = 0; z < numberOfSequences; z++) {
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            getline(in,zeile);
+            fill(packed.begin(), packed.end(), 0);
+            size_t bit = 0;
+            for (int i = 0; i < lengthOfSequence; i++) {
+                uint32_t code = charToCode[(unsigned char) binChar(zeile[i], shiftToConvertChars, bins)];
+                for (uint32_t b = 0; b < h.bitsPerQuality; b++, bit++) {
+                    packed[bit >> 3] |= ((code >> b) & 1) << (bit & 7);
+                }
+            }
+            write((const char*) packed.data(), h.bytesPerRead);
+        }
+    }
+
+    // convert a FASTQ file into a quality store (see packFASTQ)
+    void convertFASTQ(const string& inputfile,
+                      const string& outputfile,
+                      const int& numberOfSequences,
+                      const int& lengthOfSequence,
+                      const int& shiftToConvertChars,
+                      const vector<int>& bins)
+    {
+        ofstream out;
+        packFASTQ(inputfile, numberOfSequences, lengthOfSequence, shiftToConvertChars, bins,
+                  [&](const char* data, const size_t& size) {
+            if (!out.is_open()) {// after the first pass over the input
+                out.open(outputfile, ios::out | ios::binary);
+                if (!out) {
+                    throw runtime_error("cannot open " + outputfile);
+                }
+            }
+            out.write(data, size);
+        });
+    }
+
+    // true, if the file starts with the magic bytes of a quality store
+    bool isQualityStore(const string& inputfile) {
+        char buffer[sizeof(magic)];
+        ifstream in(inputfile, ios::in | ios::binary);
+        if (!in.read(buffer, sizeof(magic))) {
+            return false;
+        }
+        return memcmp(buffer, magic, sizeof(magic)) == 0;
+    }
+
+    // decode the packed codes of a read into a quality string of length
+    // lengthOfSequence
+    inline void decodePacked(const Header& header, const uint8_t* packed, string& zeile) {
+        const uint32_t bits = header.bitsPerQuality;
+        const uint32_t mask = (1u << bits) - 1;
+        zeile.resize(header.lengthOfSequence);
+        size_t bit = 0;
+        for (uint32_t i = 0; i < header.lengthOfSequence; i++, bit += bits) {
+            // a code never spans more than two bytes (bits <= 8)
+            uint32_t word = packed[bit >> 3];
+            if ((bit & 7) + bits > 8) {
+                word |= ((uint32_t) packed[(bit >> 3) + 1]) << 8;
+            }
+            zeile[i] = header.codeToChar[(word >> (bit & 7)) & mask];
+        }
+    }
+
+    // read-only memory-mapped view on a quality store
+    class Reader {
+    public:
+
+        Reader(const string& inputfile) {
+            int fd = open(inputfile.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw runtime_error("cannot open " + inputfile);
+            }
+            struct stat st;
+            fstat(fd, &st);
+            size_ = st.st_size;
+            if (size_ < sizeof(Header)) {
+                close(fd);
+                throw runtime_error(inputfile + " is not a quality store");
+            }
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED) {
+                throw runtime_error("cannot map " + inputfile);
+            }
+            madvise(p, size_, MADV_SEQUENTIAL);
+            base_ = (const uint8_t*) p;
+            memcpy(&header_, base_, sizeof(Header));
+            if (memcmp(header_.magic, magic, sizeof(magic)) != 0 || header_.version != version) {
+                munmap(p, size_);
+                throw runtime_error(inputfile + " is not a quality store");
+            }
+            if (header_.bitsPerQuality < 1 || header_.bitsPerQuality > 8
+                || header_.bytesPerRead != (header_.lengthOfSequence * header_.bitsPerQuality + 7) / 8) {
+                munmap(p, size_);
+                throw runtime_error(inputfile + " has an invalid header");
+            }
+            // all reads have to be in the file (e.g. not truncated by a copy)
+            if (header_.dataOffset > size_
+                || (header_.bytesPerRead > 0 && (size_ - header_.dataOffset) / header_.bytesPerRead < header_.numberOfReads)) {
+                munmap(p, size_);
+                throw runtime_error(inputfile + " is truncated");
+            }
+        }
+
+        ~Reader() {
+            munmap((void*) base_, size_);
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        const Header& header() const { return header_; }
+
+        // decode read z into a quality string of length lengthOfSequence
+        void decodeRead(const uint64_t& z, string& zeile) const {
+            decodePacked(header_, read(z), zeile);
+        }
+
+        // packed codes of read z
+        const uint8_t* read(const uint64_t& z) const {
+            return base_ + header_.dataOffset + z * header_.bytesPerRead;
+        }
+
+    private:
+        Header         header_;
+        const uint8_t* base_;
+        size_t         size_;
+    };
+
+    // compares a quality store with the FASTQ file it was converted from: for
+    // every bin border t the decision "q >= t" of each quality score has to be
+    // the same (so the 0/1 problems give the same matrices), throws
+    // runtime_error at the first difference
+    void checkBins(const string& inputfile,
+                   const string& storefile,
+                   const vector<int>& bins)
+    {
+        Reader store(storefile);
+        const Header& h = store.header();
+        ifstream in(inputfile, ios::in);
+        if (!in) {
+            throw runtime_error("cannot open " + inputfile);
+        }
+        string zeile, decoded;
+        for (uint64_t z = 0; z < h.numberOfReads; z++) {
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            in.ignore(numeric_limits<streamsize>::max(), '\n'); // skip 3 lines
+            getline(in,zeile);
+            if (zeile.size() < h.lengthOfSequence) {
+                throw runtime_error("read " + to_string(z + 1) + " of " + inputfile + " is too short");
+            }
+            store.decodeRead(z, decoded);
+            for (uint32_t i = 0; i < h.lengthOfSequence; i++) {
+                for (int t: bins) {
+                    if ((zeile[i] - h.shiftToConvertChars >= t) != (decoded[i] - h.shiftToConvertChars >= t)) {
+                        throw runtime_error("read " + to_string(z + 1) + ", position " + to_string(i + 1)
+                                            + ": threshold " + to_string(t) + " differs in " + storefile);
+                    }
+                }
+            }
+        }
+    }
+
+    // quality store in memory
+    class InMemory {
+    public:
+
+        // loads a quality store, or packs the first numberOfSequences reads of
+        // a FASTQ file (without binning)
+        InMemory(const string& inputfile,
+                 const int& numberOfSequences,
+                 const int& lengthOfSequence,
+                 const int& shiftToConvertChars)
+        {
+            if (isQualityStore(inputfile)) {
+                Reader store(inputfile);
+                header_ = store.header();
+                data_.assign(store.read(0), store.read(header_.numberOfReads));
+            } else {
+                bool first = true;
+                packFASTQ(inputfile, numberOfSequences, lengthOfSequence, shiftToConvertChars, {},
+                          [&](const char* data, const size_t& size) {
+                    if (first) {
+                        memcpy(&header_, data, sizeof(Header));
+                        data_.reserve(header_.numberOfReads * header_.bytesPerRead);
+                        first = false;
+                    } else {
+                        data_.insert(data_.end(), (const uint8_t*) data, (const uint8_t*) data + size);
+                    }
+                });
+            }
+        }
+
+        InMemory(const InMemory&) = delete;
+        InMemory& operator=(const InMemory&) = delete;
+
+        const Header& header() const { return header_; }
+
+        // bytes of the packed reads
+        size_t size() const { return data_.size(); }
+
+        // decode read z into a quality string of length lengthOfSequence
+        void decodeRead(const uint64_t& z, string& zeile) const {
+            decodePacked(header_, data_.data() + z * header_.bytesPerRead, zeile);
+        }
+
+    private:
+        Header          header_;
+        vector<uint8_t> data_;
+    };
+
+}
+
+#endif
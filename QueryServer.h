@@ -0,0 +1,153 @@
+/*******************************************************************************
+ *
+ * QueryServer.h
+ *
+ * DESCRIPTION: Unix domain socket of trimServer and trimClient. One request
+ *              per connection: the client sends one line, the server answers
+ *              with a status line ("OK" or "ERROR <message>"), followed by
+ *              the result, and closes the connection.
+ *              Requests:
+ *                info
+ *                best <criterion> [json] [top=<k>] [pareto] [minwidth=<w>] [minreads=<p>]
+ *                matrix <criterion> [csv|csv-upper|binary|npy]
+ *                shutdown
+ *              <criterion> as in trimAllCriteria, e.g. "m-mean:m=25" (see
+ *              ComputeMatricesMulti.h).
+ *              listenOn:    binds the socket, a socket file of a server that
+ *                           is not running anymore is replaced
+ *              connectTo:   connects to the socket of a server
+ *              readLine:    the request line
+ *              sendAll:     writes all of a string
+ *              receiveAll:  reads up to the end of the connection
+ *
+ *              All functions throw runtime_error if a system call fails.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _QueryServer_h
+#define _QueryServer_h
+
+#include <string>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+namespace QueryServer {
+
+    const size_t maxRequestSize = 1 << 16;
+
+    inline sockaddr_un socketAddress(const string& path) {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw runtime_error("socket path too long: " + path);
+        }
+        strcpy(address.sun_path, path.c_str());
+        return address;
+    }
+
+    // returns the connected socket
+    int connectTo(const string& path) {
+        sockaddr_un address = socketAddress(path);
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw runtime_error(string("socket: ") + strerror(errno));
+        }
+        if (connect(fd, (const sockaddr*) &address, sizeof(address)) < 0) {
+            int error = errno;
+            close(fd);
+            throw runtime_error("can not connect to " + path + ": " + strerror(error));
+        }
+        return fd;
+    }
+
+    // returns the listening socket
+    int listenOn(const string& path) {
+        sockaddr_un address = socketAddress(path);
+        bool running = true;
+        try {
+            close(connectTo(path));
+        } catch (runtime_error&) {
+            running = false;
+        }
+        if (running) {
+            throw runtime_error("a server is already listening on " + path);
+        }
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode)) {
+                throw runtime_error(path + " exists and is not a socket");
+            }
+            unlink(path.c_str()); // socket file of a server that is not running anymore
+        }
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            throw runtime_error(string("socket: ") + strerror(errno));
+        }
+        if (bind(fd, (const sockaddr*) &address, sizeof(address)) < 0 || listen(fd, 16) < 0) {
+            int error = errno;
+            close(fd);
+            throw runtime_error("can not listen on " + path + ": " + strerror(error));
+        }
+        return fd;
+    }
+
+    // the request line (without '\n')
+    string readLine(const int& fd) {
+        string line;
+        char c;
+        while (line.size() < maxRequestSize) {
+            ssize_t n = recv(fd, &c, 1, 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                throw runtime_error(string("recv: ") + strerror(errno));
+            }
+            if (n == 0 || c == '\n') {
+                return line;
+            }
+            line += c;
+        }
+        throw runtime_error("request too long");
+    }
+
+    void sendAll(const int& fd, const string& data) {
+        size_t sent = 0;
+        while (sent < data.size()) {
+            ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                throw runtime_error(string("send: ") + strerror(errno));
+            }
+            sent += n;
+        }
+    }
+
+    string receiveAll(const int& fd) {
+        string data;
+        char buffer[1 << 16];
+        while (true) {
+            ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0) {
+                throw runtime_error(string("recv: ") + strerror(errno));
+            }
+            if (n == 0) {
+                return data;
+            }
+            data.append(buffer, n);
+        }
+    }
+
+}
+
+#endif
@@ -5,8 +5,15 @@
  * DESCRIPTION: Output routines. Given a matrix c with the number c(l,r) of
  *              reads that fulfill 0-zeros, z-zeros, p-percent or m-mean
  *              starting at column l and ending at column r.
- *              exportMatrix: exports the matrix c as CSV with the rows
- *                            "l; r; c(l,r)"
+ *              exportMatrix: exports the matrix c (writeMatrix: to a stream) in
+ *                            one of the formats
+ *                            csv:       rows "l; r; c(l,r)" for all l, r
+ *                            csv-upper: like csv, but only for l <= r
+ *                            binary:    header (magic "SEQTRMX1", version,
+ *                                       l) followed by c(l,r) for l <= r
+ *                                       row by row as 32 bit little-endian
+ *                            npy:       (n x n) int32 array for numpy.load
+ *                            The output is buffered and written in blocks.
  *              printMaxArea: computes l',r':=argmax{ c(l,r)*(r-l+1) } and
  *                            returns c(l',r')*(r'-l'+1),
  *                                    r'-l'+1,
@@ -14,6 +21,29 @@
  *                                    l',
  *                                    r'
  *                            on screen
+ *              queryWindows: computes in one pass over c
+ *                            - the best window by area under the
+ *                              constraints width >= minWidth and
+ *                              c(l,r) >= minReadsPercent % of the reads
+ *                            - the top k windows by area
+ *                            - the Pareto frontier of width vs. selected
+ *                              reads (no other window is at least as wide
+ *                              and selects at least as many reads)
+ *              parseWindow:  window "l,r" given by the user
+ *              printWindows: prints the result of queryWindows as text or
+ *                            as JSON (on screen or to a stream)
+ *              numberedFileName: <outfile>_<suffix> with the extension of
+ *                            the format
+ *              printBatchResults: exportMatrix and/or printWindows for each
+ *                            file of the batch mode and optionally for the
+ *                            sum of all matrices (aggregate)
+ *              printGroupResults: group-by mode: one line with the best
+ *                            window per group and optionally exportMatrix for
+ *                            each group
+ *              printSeriesStep: time series mode: one line with the best
+ *                            window of the reads of a step and optionally
+ *                            exportMatrix of the change of c since the
+ *                            previous step
  *
  * RUNTIMES: O(n^2) if the input matrix is of type (n x n).
  *
@@ -24,41 +54,401 @@
  *
  */
 
+#ifndef _Results_h
+#define _Results_h
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <queue>
+#include <algorithm>
+#include <cstdint>
+
+#include "Stats.h"
 
 using namespace std;
 
 namespace Results {
-    
-    void exportMatrix(vector<vector<int> > c, string outfile) {
-        ofstream out(outfile, ios::out);
-        for ( int i = 0; i < c.size(); i++ ) {
-            for ( int j = 0; j < c[i].size(); j++ ) {
-                out << i << "; " << j << "; " << c[i][j] << endl;
+
+    // supported formats of exportMatrix, the first one is the default
+    const vector<string> exportFormats = {"csv", "csv-upper", "binary", "npy"};
+
+    const char binaryMagic[8] = {'S','E','Q','T','R','M','X','1'};
+
+    string fileExtension(const string& format) {
+        if (format == "binary") return ".bin";
+        if (format == "npy")    return ".npy";
+        return ".csv";
+    }
+
+    // <outfile>_<suffix>.csv (.bin, .npy), an extension of the format at the
+    // end of outfile stays at the end: x.csv -> x_<suffix>.csv
+    string numberedFileName(const string& outfile,
+                            const string& suffix,
+                            const string& format) {
+        const string extension = fileExtension(format);
+        string stem = outfile;
+        if (stem.size() > extension.size()
+            && stem.compare(stem.size() - extension.size(), extension.size(), extension) == 0) {
+            stem.erase(stem.size() - extension.size());
+        }
+        return stem + "_" + suffix + extension;
+    }
+
+    // appends the decimal representation of value to buffer
+    inline void appendInt(string& buffer, long long value) {
+        char digits[24];
+        int n = 0;
+        bool negative = value < 0;
+        unsigned long long v = negative ? -(unsigned long long) value : value;
+        do {
+            digits[n++] = '0' + (v % 10);
+            v /= 10;
+        } while (v > 0);
+        if (negative) {
+            buffer += '-';
+        }
+        while (n > 0) {
+            buffer += digits[--n];
+        }
+    }
+
+    // appends value as 4 bytes in little-endian order to buffer
+    inline void appendLittleEndian32(string& buffer, uint32_t value) {
+        for (int b = 0; b < 4; b++) {
+            buffer += (char) ((value >> (8*b)) & 0xFF);
+        }
+    }
+
+    // writes the matrix c in format to out (see exportMatrix)
+    void writeMatrix(const vector<vector<int> >& c,
+                     ostream& out,
+                     const string& format = "csv") {
+        const size_t blockSize = 1 << 20;
+        const int n = c.size();
+        string buffer;
+        buffer.reserve(blockSize + 64);
+        auto flushIfFull = [&]() {
+            if (buffer.size() >= blockSize) {
+                out.write(buffer.data(), buffer.size());
+                buffer.clear();
+            }
+        };
+
+        if (format == "csv" || format == "csv-upper") {
+            for (int i = 0; i < n; i++) {
+                for (int j = (format == "csv") ? 0 : i; j < n; j++) {
+                    appendInt(buffer, i);
+                    buffer += "; ";
+                    appendInt(buffer, j);
+                    buffer += "; ";
+                    appendInt(buffer, c[i][j]);
+                    buffer += '\n';
+                    flushIfFull();
+                }
+            }
+        } else if (format == "binary") {
+            buffer.append(binaryMagic, sizeof(binaryMagic));
+            appendLittleEndian32(buffer, 1); // version
+            appendLittleEndian32(buffer, n);
+            for (int i = 0; i < n; i++) {
+                for (int j = i; j < n; j++) {
+                    appendLittleEndian32(buffer, c[i][j]);
+                    flushIfFull();
+                }
+            }
+        } else if (format == "npy") {
+            // NPY format version 1.0: magic, version, length of the header
+            // (16 bit little-endian), header dict padded with spaces and
+            // terminated by '\n', such that the data starts at a multiple of 64
+            string header = "{'descr': '<i4', 'fortran_order': False, 'shape': ("
+                          + to_string(n) + ", " + to_string(n) + "), }";
+            size_t total = 10 + header.size() + 1;
+            header.append((64 - total % 64) % 64, ' ');
+            header += '\n';
+            buffer += "\x93NUMPY";
+            buffer += (char) 1;
+            buffer += (char) 0;
+            buffer += (char) (header.size() & 0xFF);
+            buffer += (char) (header.size() >> 8);
+            buffer += header;
+            for (int i = 0; i < n; i++) {
+                for (int j = 0; j < n; j++) {
+                    appendLittleEndian32(buffer, c[i][j]);
+                    flushIfFull();
+                }
             }
         }
+        out.write(buffer.data(), buffer.size());
     }
 
-    void printMaxArea(vector<vector<int> > c, int rows) {
-        long long int maxvalue = 0;
-        long long int value;
-        int indexL = -1;
-        int indexR = -1;
-        for (int i = 0; i < c.size(); i++) {
-            for (int j = i; j < c[i].size(); j++) {
-                value = ((long long int) (j-i+1)) *((long long int) c[i][j]);
-                if (value > maxvalue){
-                    maxvalue = value;
-                    indexL = i;
-                    indexR = j;
+    void exportMatrix(const vector<vector<int> >& c,
+                      const string& outfile,
+                      const string& format = "csv") {
+        Stats::Stage stage(Stats::Export);
+        ofstream out(outfile, ios::out | ios::binary);
+        writeMatrix(c, out, format);
+    }
+
+    struct Window {
+        int       left;
+        int       right;
+        int       reads;     // c(left,right)
+        long long area;      // reads * width
+        int width() const { return right - left + 1; }
+    };
+
+    struct WindowQuery {
+        int    top;             // number of windows with the largest areas
+        bool   pareto;          // compute the Pareto frontier
+        int    minWidth;        // constraints for the best window
+        double minReadsPercent;
+        WindowQuery() : top(0), pareto(false), minWidth(0), minReadsPercent(0.0) {}
+    };
+
+    struct WindowSummary {
+        bool           found;   // false: no window fulfills the constraints
+        Window         best;
+        vector<Window> top;     // by decreasing area
+        vector<Window> pareto;  // by decreasing width (increasing reads)
+    };
+
+    WindowSummary queryWindows(const vector<vector<int> >& c,
+                               const int& rows,
+                               const WindowQuery& query) {
+        const int n = c.size();
+        WindowSummary result;
+        result.found = false;
+        result.best  = Window{-1, -1, 0, 0};
+
+        // top k: min-heap by area, on equal areas the window found first wins
+        auto worse = [](const pair<Window,int>& a, const pair<Window,int>& b) {
+            return a.first.area != b.first.area ? a.first.area > b.first.area
+                                                : a.second < b.second;
+        };
+        priority_queue<pair<Window,int>, vector<pair<Window,int> >, decltype(worse)> top(worse);
+        // Pareto frontier: the window with the most reads for each width
+        vector<Window> widest(query.pareto ? n+1 : 0, Window{-1, -1, 0, 0});
+
+        int order = 0;
+        for (int i = 0; i < n; i++) {
+            for (int j = i; j < n; j++, order++) {
+                Window w = {i, j, c[i][j], ((long long) (j-i+1)) * ((long long) c[i][j])};
+                if (w.reads == 0) {
+                    continue;
+                }
+                if (w.width() >= query.minWidth
+                    && w.reads * 100.0 >= query.minReadsPercent * rows
+                    && (!result.found || w.area > result.best.area)) {
+                    result.found = true;
+                    result.best  = w;
+                }
+                if (query.top > 0) {
+                    if ((int) top.size() < query.top) {
+                        top.push(make_pair(w, order));
+                    } else if (w.area > top.top().first.area) {
+                        top.pop();
+                        top.push(make_pair(w, order));
+                    }
+                }
+                if (query.pareto && w.reads > widest[w.width()].reads) {
+                    widest[w.width()] = w;
                 }
             }
         }
-        int width = indexR - indexL + 1;
-        cout << "area:  " << maxvalue << endl;
-        cout << "width: " << width << " (" << (width*100.0)/((float) c.size()) << "%)" << endl;
-        cout << "rows:  " << c[indexL][indexR] << " (" << (c[indexL][indexR]*100.0)/((float) rows) << "%)" << endl;
-        cout << "left:  " << indexL << endl;
-        cout << "right: " << indexR << endl;
+
+        while (!top.empty()) {
+            result.top.push_back(top.top().first);
+            top.pop();
+        }
+        reverse(result.top.begin(), result.top.end());
+
+        int mostReads = 0;
+        for (int width = n; width >= 1 && query.pareto; width--) {
+            if (widest[width].reads > mostReads) {
+                mostReads = widest[width].reads;
+                result.pareto.push_back(widest[width]);
+            }
+        }
+        return result;
+    }
+
+    void printWindows(const WindowSummary& result,
+                      const int& lengthOfSequence,
+                      const int& rows,
+                      const bool& json,
+                      ostream& out = cout) {
+        auto percent = [](double part, double whole) { return (part*100.0)/whole; };
+        if (json) {
+            auto windowJSON = [&](const Window& w) {
+                out << "{\"left\": " << w.left << ", \"right\": " << w.right
+                    << ", \"width\": " << w.width() << ", \"reads\": " << w.reads
+                    << ", \"area\": " << w.area << "}";
+            };
+            auto listJSON = [&](const string& name, const vector<Window>& windows) {
+                out << ",\n  \"" << name << "\": [";
+                for (size_t k = 0; k < windows.size(); k++) {
+                    out << (k ? ",\n    " : "\n    ");
+                    windowJSON(windows[k]);
+                }
+                out << (windows.empty() ? "]" : "\n  ]");
+            };
+            out << "{\n  \"length\": " << lengthOfSequence << ",\n  \"reads\": " << rows
+                << ",\n  \"best\": ";
+            if (result.found) {
+                windowJSON(result.best);
+            } else {
+                out << "null";
+            }
+            listJSON("top", result.top);
+            listJSON("pareto", result.pareto);
+            out << "\n}" << endl;
+            return;
+        }
+        if (result.found) {
+            const Window& w = result.best;
+            out << "area:  " << w.area << endl;
+            out << "width: " << w.width() << " (" << percent(w.width(), lengthOfSequence) << "%)" << endl;
+            out << "rows:  " << w.reads << " (" << percent(w.reads, rows) << "%)" << endl;
+            out << "left:  " << w.left << endl;
+            out << "right: " << w.right << endl;
+        } else {
+            out << "no window fulfills the constraints" << endl;
+        }
+        auto printList = [&](const string& title, const vector<Window>& windows) {
+            out << endl << title << endl;
+            out << "area\twidth\trows\tleft\tright" << endl;
+            for (const auto& w: windows) {
+                out << w.area << "\t" << w.width() << "\t" << w.reads << "\t"
+                    << w.left << "\t" << w.right << endl;
+            }
+        };
+        if (!result.top.empty()) {
+            printList("top " + to_string(result.top.size()) + " windows:", result.top);
+        }
+        if (!result.pareto.empty()) {
+            printList("pareto frontier (width vs. rows):", result.pareto);
+        }
+    }
+
+    // window "l,r" given by the user
+    Window parseWindow(const string& text, const vector<vector<int> >& c) {
+        int left, right;
+        char comma;
+        stringstream fields(text);
+        if (!(fields >> left >> comma >> right) || comma != ',' || !fields.eof()
+            || left < 0 || left > right || right >= (int) c.size()) {
+            throw runtime_error("invalid window \"" + text + "\", expected \"l,r\" with 0 <= l <= r < length");
+        }
+        return Window{left, right, c[left][right], ((long long) (right-left+1)) * ((long long) c[left][right])};
+    }
+
+    void printMaxArea(const vector<vector<int> >& c, const int& rows) {
+        printWindows(queryWindows(c, rows, WindowQuery()), c.size(), rows, false);
+    }
+
+    // batch mode: with an output file name, the matrix of the k-th input file
+    // is exported to <outfile>_<k>.csv and the aggregate to <outfile>_all.csv
+    // (see numberedFileName). The windows of query are printed for each file
+    // without an output file name or if printQuery is set.
+    void printBatchResults(const vector<string>& inputfiles,
+                           const vector<int>& rows,
+                           const vector<vector<vector<int> > >& cs,
+                           const string& outfile,
+                           const bool& aggregate,
+                           const WindowQuery& query,
+                           const bool& printQuery,
+                           const string& format = "csv") {
+        auto printResult = [&](const vector<vector<int> >& c, const int& numberOfRows, const string& suffix) {
+            if (outfile != "") {
+                string name = numberedFileName(outfile, suffix, format);
+                exportMatrix(c, name, format);
+                cout << "out:   " << name << endl;
+            }
+            if (outfile == "" || printQuery) {
+                printWindows(queryWindows(c, numberOfRows, query), c.size(), numberOfRows, false);
+            }
+        };
+        for (size_t k = 0; k < cs.size(); k++) {
+            cout << "file:  " << inputfiles[k] << endl;
+            printResult(cs[k], rows[k], to_string(k));
+            cout << endl;
+        }
+        if (aggregate && !cs.empty()) {
+            vector<vector<int> > sum = cs[0];
+            int sumOfRows = rows[0];
+            for (size_t k = 1; k < cs.size(); k++) {
+                for (size_t i = 0; i < sum.size(); i++) {
+                    for (size_t j = i; j < sum.size(); j++) {
+                        sum[i][j] += cs[k][i][j];
+                    }
+                }
+                sumOfRows += rows[k];
+            }
+            cout << "file:  (all files)" << endl;
+            printResult(sum, sumOfRows, "all");
+        }
+    }
+
+    // group-by mode: the best window of query per group. With an output file
+    // name, the matrix of each group is exported to <outfile>_<group>.csv
+    // (see numberedFileName), ':' in the group is replaced by '-'
+    void printGroupResults(const vector<string>& groups,
+                           const vector<int>& rows,
+                           const vector<vector<vector<int> > >& cs,
+                           const string& outfile,
+                           const WindowQuery& query,
+                           const string& format = "csv") {
+        cout << "group\treads\tarea\twidth\trows\trows%\tleft\tright" << endl;
+        for (size_t k = 0; k < cs.size(); k++) {
+            WindowSummary windows = queryWindows(cs[k], rows[k], query);
+            const Window& w = windows.best;
+            cout << groups[k] << "\t" << rows[k];
+            if (windows.found) {
+                cout << "\t" << w.area << "\t" << w.width() << "\t" << w.reads << "\t"
+                     << (w.reads*100.0)/rows[k] << "\t" << w.left << "\t" << w.right << endl;
+            } else {
+                cout << "\t-\t-\t-\t-\t-\t-" << endl;
+            }
+        }
+        if (outfile != "") {
+            for (size_t k = 0; k < cs.size(); k++) {
+                string group = groups[k];
+                replace(group.begin(), group.end(), ':', '-');
+                exportMatrix(cs[k], numberedFileName(outfile, group, format), format);
+            }
+        }
     }
 
-}
\ No newline at end of file
+    void printSeriesStep(const int& step,
+                         const int& first,
+                         const int& last,
+                         const vector<vector<int> >& c,
+                         const vector<vector<int> >& delta,
+                         const WindowQuery& query,
+                         const string& outfile,
+                         const string& format = "csv") {
+        if (step == 0) {
+            cout << "step\tfirst\tlast\tarea\twidth\trows\trows%\tleft\tright" << endl;
+        }
+        const int rows = last - first + 1;
+        WindowSummary windows = queryWindows(c, rows, query);
+        const Window& w = windows.best;
+        cout << step << "\t" << first << "\t" << last;
+        if (windows.found) {
+            cout << "\t" << w.area << "\t" << w.width() << "\t" << w.reads << "\t"
+                 << (w.reads*100.0)/rows << "\t" << w.left << "\t" << w.right << endl;
+        } else {
+            cout << "\t-\t-\t-\t-\t-\t-" << endl;
+        }
+        if (outfile != "") {
+            exportMatrix(delta, numberedFileName(outfile, to_string(step), format), format);
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,666 @@
+/*******************************************************************************
+ *
+ * Stats.h
+ *
+ * DESCRIPTION: Per stage timers and throughput counters for --stats.
+ *              Stages: open, parse, queue_wait (reader waits for a full
+ *              queue, worker waits for an empty queue), kernel, reduction
+ *              (adding the counters of the threads), prefix (cT/cC -> c),
+ *              export, emit (second pass for the selected reads) and io
+ *              (reads of the I/O threads of the reader backend "threads").
+ *
+ *              ThreadScope: registers the calling thread (reader, worker,
+ *                           main, ...) for the lifetime of the object
+ *              Stage:       adds the wall time (and the CPU time of the
+ *                           thread) between construction and destruction to
+ *                           a stage of the current thread
+ *              writeReport: writes all counters as JSON
+ *              finish:      writeReport and writeTrace at the end of a run
+ *
+ *              Without start() (no --stats) no thread is registered and
+ *              ThreadScope and Stage do nothing. Each thread only writes to
+ *              its own counters, so there is no locking except for the
+ *              registration of a thread.
+ *
+ *              Stages that are timed per read (sequential engines) only
+ *              measure the wall time (wallOnly), the CPU time of each thread
+ *              is measured as a whole.
+ *
+ *              With start(true) (--perf-counters) each registered thread
+ *              additionally opens a group of hardware counters (cycles,
+ *              instructions, L1 data cache misses, last level cache misses and
+ *              branch mispredictions, user space only) with perf_event_open.
+ *              Each Stage reads the group at its start and end (also the
+ *              stages timed per read, which costs two system calls per stage
+ *              and read), the thread reads it at its start and end. The
+ *              report adds the counters, the IPC and the misses per read of
+ *              the input to each stage and thread. If the counters cannot be
+ *              opened (no PMU in a virtual machine, perf_event_paranoid, ...)
+ *              the report says "unavailable" with the reason and the run
+ *              continues without them. Counters that are not supported by the
+ *              CPU are left out of the group.
+ *
+ *              With start(.., true) (--trace) each thread additionally keeps
+ *              the spans of its stages and samples of the queue depth in its
+ *              own buffer (no locking), writeTrace writes them as a Chrome
+ *              trace (JSON, for chrome://tracing or ui.perfetto.dev). A span
+ *              that starts less than traceMergeGap after the last span of the
+ *              thread ended is merged into it if both have the same stage, so
+ *              stages timed per read give one span per run of reads and not
+ *              one per read. The queue depth is sampled at most every
+ *              traceSampleInterval per thread. A thread keeps at most
+ *              traceLimit spans, further spans are counted as dropped.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _Stats_h
+#define _Stats_h
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cerrno>
+
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+using namespace std;
+
+namespace Stats {
+
+    enum StageId { Open, Parse, QueueWait, Kernel, Reduction, Prefix, Export, Emit, Io, numberOfStages };
+
+    const char* const stageNames[numberOfStages] =
+        {"open", "parse", "queue_wait", "kernel", "reduction", "prefix", "export", "emit", "io"};
+
+    const bool wallOnly = false;
+
+    inline double wallSeconds() {
+        timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return t.tv_sec + 1e-9 * t.tv_nsec;
+    }
+
+    inline double cpuSeconds(clockid_t clock = CLOCK_THREAD_CPUTIME_ID) {
+        timespec t;
+        clock_gettime(clock, &t);
+        return t.tv_sec + 1e-9 * t.tv_nsec;
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+    // hardware counters
+
+    enum CounterId { Cycles, Instructions, L1DMisses, LLCMisses, BranchMisses, numberOfCounters };
+
+    const char* const counterNames[numberOfCounters] =
+        {"cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"};
+
+    struct CounterValues {
+        uint64_t value[numberOfCounters];
+        CounterValues() { memset(value, 0, sizeof(value)); }
+    };
+
+    inline perf_event_attr counterAttributes(const CounterId& id) {
+        perf_event_attr a;
+        memset(&a, 0, sizeof(perf_event_attr));
+        a.size           = sizeof(perf_event_attr);
+        a.disabled       = (id == Cycles); // the leader starts the group
+        a.exclude_kernel = 1;
+        a.exclude_hv     = 1;
+        a.read_format    = PERF_FORMAT_GROUP;
+        const uint64_t readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        switch (id) {
+        case Cycles:       a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_CPU_CYCLES;         break;
+        case Instructions: a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_INSTRUCTIONS;       break;
+        case L1DMisses:    a.type = PERF_TYPE_HW_CACHE; a.config = PERF_COUNT_HW_CACHE_L1D | readMiss; break;
+        case LLCMisses:    a.type = PERF_TYPE_HW_CACHE; a.config = PERF_COUNT_HW_CACHE_LL | readMiss;  break;
+        default:           a.type = PERF_TYPE_HARDWARE; a.config = PERF_COUNT_HW_BRANCH_MISSES;      break;
+        }
+        return a;
+    }
+
+    // group of counters of the calling thread, cycles is the group leader
+    class PerfGroup {
+    public:
+        PerfGroup() : leader_(-1), members_(0) {
+            for (int k = 0; k < numberOfCounters; k++) {
+                perf_event_attr a = counterAttributes((CounterId) k);
+                int fd = syscall(SYS_perf_event_open, &a, 0, -1, leader_, 0);
+                if (fd < 0) {
+                    if (k == Cycles) {
+                        error_ = string("perf_event_open: ") + strerror(errno);
+                        return;
+                    }
+                    continue; // counter not supported, left out
+                }
+                if (k == Cycles) leader_ = fd;
+                else fds_.push_back(fd);
+                ids_[members_++] = (CounterId) k;
+            }
+            ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        }
+
+        ~PerfGroup() {
+            for (int fd: fds_) close(fd);
+            if (leader_ >= 0) close(leader_);
+        }
+
+        PerfGroup(const PerfGroup&) = delete;
+        PerfGroup& operator=(const PerfGroup&) = delete;
+
+        bool ok() const { return leader_ >= 0; }
+
+        const string& error() const { return error_; }
+
+        // bit k set = counter k is in the group
+        unsigned mask() const {
+            unsigned m = 0;
+            for (int k = 0; k < members_; k++) m |= 1u << ids_[k];
+            return m;
+        }
+
+        void read(CounterValues& v) const {
+            // layout for PERF_FORMAT_GROUP: { nr, value[nr] }
+            uint64_t buffer[1 + numberOfCounters];
+            if (::read(leader_, buffer, sizeof(buffer)) < (ssize_t) sizeof(uint64_t)) return;
+            for (uint64_t k = 0; k < buffer[0] && k < (uint64_t) members_; k++) {
+                v.value[ids_[k]] = buffer[1+k];
+            }
+        }
+
+    private:
+        int         leader_;
+        vector<int> fds_;
+        CounterId   ids_[numberOfCounters];
+        int         members_;
+        string      error_;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+
+    struct StageCounters {
+        double        wall;
+        double        cpu;
+        long long     calls;
+        long long     cpuCalls;  // calls with measured CPU time
+        long long     perfCalls; // calls with read hardware counters
+        CounterValues counters;
+        StageCounters() : wall(0), cpu(0), calls(0), cpuCalls(0), perfCalls(0) {}
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+    // trace
+
+    const double traceMergeGap       = 50e-6;   // seconds
+    const double traceSampleInterval = 1e-3;    // seconds
+    const size_t traceLimit          = 1 << 18; // spans per thread
+
+    struct TraceSpan {
+        double    start, end; // seconds since start()
+        StageId   stage;
+        long long calls;      // merged stages
+    };
+
+    struct QueueSample {
+        double    time;
+        long long reads;
+    };
+
+    /////////////////////////////////////////////////////////////////////////////
+
+    struct ThreadStats {
+        int                  id;
+        string               name;
+        double               wallStart, wallEnd;
+        double               cpuStart, cpuEnd;
+        long long            reads;
+        StageCounters        stages[numberOfStages];
+        unique_ptr<PerfGroup> perf;     // open while the thread runs
+        unsigned             perfMask; // counters of perf, 0 = none
+        CounterValues        perfStart, perfEnd;
+        bool                 tracing;
+        vector<TraceSpan>    spans;
+        vector<QueueSample>  queueSamples;
+        long long            droppedSpans;
+    };
+
+    struct Registry {
+        bool                             enabled;
+        bool                             perfRequested;
+        bool                             tracing;
+        string                           perfError;      // first failure
+        string                           reader;         // backend of QualityInput.h
+        double                           wallStart;
+        double                           cpuStart;
+        mutex                            m;
+        vector<unique_ptr<ThreadStats> > threads;
+        atomic<long long>                queueHighWater; // in reads
+        Registry() : enabled(false), perfRequested(false), tracing(false), wallStart(0), cpuStart(0), queueHighWater(0) {}
+    };
+
+    inline Registry& registry() {
+        static Registry r;
+        return r;
+    }
+
+    // counters of the calling thread, nullptr if it is not registered
+    inline ThreadStats*& currentThread() {
+        static thread_local ThreadStats* t = nullptr;
+        return t;
+    }
+
+    class ThreadScope {
+    public:
+        ThreadScope(const string& name) : t_(nullptr) {
+            Registry& r = registry();
+            if (!r.enabled) return;
+            unique_ptr<ThreadStats> t(new ThreadStats);
+            t->name      = name;
+            t->reads     = 0;
+            t->perfMask  = 0;
+            t->tracing   = r.tracing;
+            t->droppedSpans = 0;
+            t->wallStart = wallSeconds();
+            t->cpuStart  = cpuSeconds();
+            t->wallEnd   = t->wallStart;
+            t->cpuEnd    = t->cpuStart;
+            t_ = t.get();
+            if (r.perfRequested) {
+                t->perf.reset(new PerfGroup);
+                if (!t->perf->ok()) {
+                    lock_guard<mutex> lock(r.m);
+                    if (r.perfError == "") r.perfError = t->perf->error();
+                    t->perf.reset();
+                } else {
+                    t->perfMask = t->perf->mask();
+                    t->perf->read(t->perfStart);
+                    t->perfEnd = t->perfStart;
+                }
+            }
+            {
+                lock_guard<mutex> lock(r.m);
+                t->id = r.threads.size();
+                r.threads.push_back(move(t));
+            }
+            currentThread() = t_;
+        }
+
+        ~ThreadScope() {
+            if (t_ == nullptr) return;
+            t_->wallEnd = wallSeconds();
+            t_->cpuEnd  = cpuSeconds();
+            if (t_->perf) {
+                t_->perf->read(t_->perfEnd);
+                t_->perf.reset();
+            }
+            currentThread() = nullptr;
+        }
+
+        ThreadScope(const ThreadScope&) = delete;
+        ThreadScope& operator=(const ThreadScope&) = delete;
+
+    private:
+        ThreadStats* t_;
+    };
+
+    // adds the span [start,end] (absolute wall times) of stage to the trace of t
+    inline void traceSpan(ThreadStats& t, const StageId& stage, const double& start, const double& end) {
+        const double offset = registry().wallStart;
+        if (!t.spans.empty()) {
+            TraceSpan& last = t.spans.back();
+            if (last.stage == stage && start - offset - last.end < traceMergeGap) {
+                last.end = end - offset;
+                last.calls++;
+                return;
+            }
+        }
+        if (t.spans.size() >= traceLimit) {
+            t.droppedSpans++;
+            return;
+        }
+        TraceSpan span = {start - offset, end - offset, stage, 1};
+        t.spans.push_back(span);
+    }
+
+    class Stage {
+    public:
+        Stage(const StageId& id, const bool& measureCPU = true)
+        : t_(currentThread()), id_(id), measureCPU_(measureCPU) {
+            if (t_ == nullptr) return;
+            wallStart_ = wallSeconds();
+            if (measureCPU_) cpuStart_ = cpuSeconds();
+            if (t_->perf) t_->perf->read(perfStart_);
+        }
+
+        ~Stage() {
+            if (t_ == nullptr) return;
+            StageCounters& s = t_->stages[id_];
+            const double wallEnd = wallSeconds();
+            if (t_->tracing) traceSpan(*t_, id_, wallStart_, wallEnd);
+            if (t_->perf) {
+                CounterValues perfEnd;
+                t_->perf->read(perfEnd);
+                for (int k = 0; k < numberOfCounters; k++) {
+                    s.counters.value[k] += perfEnd.value[k] - perfStart_.value[k];
+                }
+                s.perfCalls++;
+            }
+            s.wall += wallEnd - wallStart_;
+            s.calls++;
+            if (measureCPU_) {
+                s.cpu += cpuSeconds() - cpuStart_;
+                s.cpuCalls++;
+            }
+        }
+
+        Stage(const Stage&) = delete;
+        Stage& operator=(const Stage&) = delete;
+
+    private:
+        ThreadStats* t_;
+        StageId      id_;
+        bool         measureCPU_;
+        double       wallStart_, cpuStart_;
+        CounterValues perfStart_;
+    };
+
+    inline bool enabled() {
+        return registry().enabled;
+    }
+
+    // reads processed by the kernels of the calling thread
+    inline void addReads(const long long& reads) {
+        ThreadStats* t = currentThread();
+        if (t != nullptr) t->reads += reads;
+    }
+
+    // reader backend that is used for the input (after a fallback)
+    inline void setReader(const string& reader) {
+        Registry& r = registry();
+        if (!r.enabled) return;
+        lock_guard<mutex> lock(r.m);
+        r.reader = reader;
+    }
+
+    // number of reads waiting in a queue after a push
+    inline void queueDepth(const long long& reads) {
+        Registry& r = registry();
+        if (!r.enabled) return;
+        long long current = r.queueHighWater.load();
+        while (reads > current && !r.queueHighWater.compare_exchange_weak(current, reads)) {}
+        ThreadStats* t = currentThread();
+        if (t != nullptr && t->tracing) {
+            double now = wallSeconds() - r.wallStart;
+            if (t->queueSamples.empty() || now - t->queueSamples.back().time >= traceSampleInterval) {
+                QueueSample sample = {now, reads};
+                t->queueSamples.push_back(sample);
+            }
+        }
+    }
+
+    // enables the statistics (and the hardware counters if perfCounters, the
+    // trace if tracing) and registers the calling thread as "main"
+    void start(const bool& perfCounters = false, const bool& tracing = false) {
+        Registry& r = registry();
+        r.enabled       = true;
+        r.perfRequested = perfCounters;
+        r.tracing       = tracing;
+        r.wallStart = wallSeconds();
+        r.cpuStart  = cpuSeconds(CLOCK_PROCESS_CPUTIME_ID);
+        static ThreadScope mainThread("main");
+    }
+
+    /////////////////////////////////////////////////////////////////////////////
+
+    // text as JSON string, with quotes
+    inline string jsonString(const string& text) {
+        string json = "\"";
+        for (const char& c: text) {
+            switch (c) {
+                case '"':  json += "\\\""; break;
+                case '\\': json += "\\\\"; break;
+                case '\n': json += "\\n"; break;
+                case '\r': json += "\\r"; break;
+                case '\t': json += "\\t"; break;
+                default:
+                    if ((unsigned char) c < 0x20) {
+                        char escaped[8];
+                        snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char) c);
+                        json += escaped;
+                    } else {
+                        json += c;
+                    }
+            }
+        }
+        return json + "\"";
+    }
+
+    // counters of mask, their IPC and misses per read
+    inline void writeCounters(ostream& out, const CounterValues& v,
+                              const unsigned& mask, const long long& reads) {
+        for (int k = 0; k < numberOfCounters; k++) {
+            if (!(mask & (1u << k))) continue;
+            out << ", " << jsonString(counterNames[k]) << ": " << v.value[k];
+            if (k >= L1DMisses && reads > 0) {
+                out << ", " << jsonString(string(counterNames[k]) + "_per_read") << ": " << (double) v.value[k] / reads;
+            }
+        }
+        const unsigned ipc = (1u << Cycles) | (1u << Instructions);
+        if ((mask & ipc) == ipc && v.value[Cycles] > 0) {
+            out << ", \"ipc\": " << (double) v.value[Instructions] / v.value[Cycles];
+        }
+    }
+
+    inline void writeStage(ostream& out, const StageCounters& s,
+                           const unsigned& mask, const long long& reads) {
+        out << "{\"wall_s\": " << s.wall << ", \"calls\": " << s.calls;
+        if (s.cpuCalls > 0) {
+            out << ", \"cpu_s\": " << s.cpu;
+        }
+        if (s.perfCalls > 0) {
+            writeCounters(out, s.counters, mask, reads);
+        }
+        out << "}";
+    }
+
+    inline void writeStages(ostream& out, const StageCounters* stages,
+                            const unsigned& mask, const long long& reads, const string& indent) {
+        out << "{";
+        bool first = true;
+        for (int k = 0; k < numberOfStages; k++) {
+            if (stages[k].calls == 0) continue;
+            out << (first ? "\n" : ",\n") << indent << "  " << jsonString(stageNames[k]) << ": ";
+            writeStage(out, stages[k], mask, reads);
+            first = false;
+        }
+        out << (first ? "}" : "\n" + indent + "}");
+    }
+
+    // writes the report of all registered threads as JSON. inputfiles are
+    // used for the number of bytes read, empty names are skipped. Misses
+    // per read are always relative to all reads of the input.
+    void writeReport(const string& statsfile,
+                     const string& tool,
+                     const vector<string>& inputfiles) {
+        Registry& r = registry();
+        if (!r.enabled) return;
+        double wall = wallSeconds() - r.wallStart;
+        double cpu  = cpuSeconds(CLOCK_PROCESS_CPUTIME_ID) - r.cpuStart;
+        ThreadStats* self = currentThread();
+        if (self != nullptr) {
+            self->wallEnd = wallSeconds();
+            self->cpuEnd  = cpuSeconds();
+            if (self->perf) self->perf->read(self->perfEnd);
+        }
+
+        vector<string> files;
+        long long bytes = 0;
+        for (const auto& f: inputfiles) {
+            struct stat st;
+            if (f == "") continue; // e.g. no paired file
+            files.push_back(f);
+            if (stat(f.c_str(), &st) == 0) bytes += st.st_size;
+        }
+
+        lock_guard<mutex> lock(r.m);
+        long long reads = 0;
+        StageCounters total[numberOfStages];
+        // counters available in all threads with hardware counters
+        unsigned mask = (1u << numberOfCounters) - 1;
+        bool perfAvailable = false;
+        for (const auto& t: r.threads) {
+            reads += t->reads;
+            if (t->perfMask != 0) {
+                mask &= t->perfMask;
+                perfAvailable = true;
+            }
+            for (int k = 0; k < numberOfStages; k++) {
+                total[k].wall      += t->stages[k].wall;
+                total[k].cpu       += t->stages[k].cpu;
+                total[k].calls     += t->stages[k].calls;
+                total[k].cpuCalls  += t->stages[k].cpuCalls;
+                total[k].perfCalls += t->stages[k].perfCalls;
+                for (int i = 0; i < numberOfCounters; i++) {
+                    total[k].counters.value[i] += t->stages[k].counters.value[i];
+                }
+            }
+        }
+        if (!perfAvailable) mask = 0;
+
+        ofstream out(statsfile, ios::out);
+        if (!out) {
+            throw runtime_error("cannot open " + statsfile);
+        }
+        out << "{\n";
+        out << "  \"tool\": " << jsonString(tool) << ",\n";
+        out << "  \"input_files\": [";
+        for (size_t k = 0; k < files.size(); k++) {
+            out << (k ? ", " : "") << jsonString(files[k]);
+        }
+        out << "],\n";
+        out << "  \"input_bytes\": " << bytes << ",\n";
+        if (r.reader != "") {
+            out << "  \"reader\": " << jsonString(r.reader) << ",\n";
+        }
+        out << "  \"reads\": " << reads << ",\n";
+        out << "  \"wall_s\": " << wall << ",\n";
+        out << "  \"cpu_s\": " << cpu << ",\n";
+        out << "  \"reads_per_s\": " << (wall > 0 ? reads / wall : 0) << ",\n";
+        out << "  \"mb_per_s\": " << (wall > 0 ? bytes / wall / 1e6 : 0) << ",\n";
+        out << "  \"queue_high_water_reads\": " << r.queueHighWater.load() << ",\n";
+        if (r.perfRequested) {
+            out << "  \"perf_counters\": ";
+            if (perfAvailable) {
+                out << "{\"status\": \"ok\", \"counters\": [";
+                bool first = true;
+                for (int k = 0; k < numberOfCounters; k++) {
+                    if (!(mask & (1u << k))) continue;
+                    out << (first ? "" : ", ") << jsonString(counterNames[k]);
+                    first = false;
+                }
+                out << "]";
+            } else {
+                out << "{\"status\": \"unavailable\"";
+            }
+            if (r.perfError != "") {
+                out << ", \"reason\": " << jsonString(r.perfError);
+            }
+            out << "},\n";
+        }
+        out << "  \"stages\": ";
+        writeStages(out, total, mask, reads, "  ");
+        out << ",\n  \"threads\": [";
+        for (size_t k = 0; k < r.threads.size(); k++) {
+            const ThreadStats& t = *r.threads[k];
+            out << (k ? ",\n" : "\n") << "    {\"id\": " << t.id << ", \"name\": " << jsonString(t.name)
+                << ", \"wall_s\": " << t.wallEnd - t.wallStart
+                << ", \"cpu_s\": " << t.cpuEnd - t.cpuStart
+                << ", \"idle_s\": " << t.stages[QueueWait].wall
+                << ", \"reads\": " << t.reads;
+            if (t.perfMask != 0) {
+                CounterValues v;
+                for (int i = 0; i < numberOfCounters; i++) {
+                    v.value[i] = t.perfEnd.value[i] - t.perfStart.value[i];
+                }
+                writeCounters(out, v, mask, reads);
+            }
+            out << ",\n     \"stages\": ";
+            writeStages(out, t.stages, mask, reads, "     ");
+            out << "}";
+        }
+        out << "\n  ]\n}\n";
+    }
+
+    // writes the spans and queue samples of all registered threads as Chrome
+    // trace: one track per thread, "X" events in microseconds since start()
+    void writeTrace(const string& tracefile, const string& tool) {
+        Registry& r = registry();
+        if (!r.enabled || !r.tracing) return;
+
+        ofstream out(tracefile, ios::out);
+        if (!out) {
+            throw runtime_error("cannot open " + tracefile);
+        }
+        lock_guard<mutex> lock(r.m);
+        out << fixed;
+        out.precision(3);
+        long long dropped = 0;
+        out << "{\"traceEvents\": [\n";
+        out << "  {\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, \"args\": {\"name\": " << jsonString(tool) << "}}";
+        for (const auto& t: r.threads) {
+            out << ",\n  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t->id
+                << ", \"args\": {\"name\": " << jsonString(t->name + " " + to_string(t->id)) << "}}";
+            out << ",\n  {\"name\": \"thread_sort_index\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << t->id
+                << ", \"args\": {\"sort_index\": " << t->id << "}}";
+            for (const auto& span: t->spans) {
+                out << ",\n  {\"name\": " << jsonString(stageNames[span.stage]) << ", \"cat\": \"stage\", \"ph\": \"X\""
+                    << ", \"pid\": 1, \"tid\": " << t->id
+                    << ", \"ts\": " << 1e6 * span.start << ", \"dur\": " << 1e6 * (span.end - span.start)
+                    << ", \"args\": {\"calls\": " << span.calls << "}}";
+            }
+            for (const auto& sample: t->queueSamples) {
+                out << ",\n  {\"name\": \"queue_depth\", \"ph\": \"C\", \"pid\": 1"
+                    << ", \"ts\": " << 1e6 * sample.time
+                    << ", \"args\": {\"reads\": " << sample.reads << "}}";
+            }
+            dropped += t->droppedSpans;
+        }
+        out << "\n],\n\"displayTimeUnit\": \"ms\",\n";
+        out << "\"otherData\": {\"tool\": " << jsonString(tool) << ", \"dropped_spans\": " << dropped << "}}\n";
+        if (!out) {
+            throw runtime_error("cannot write " + tracefile);
+        }
+    }
+
+    // end of a run: writes the report (statsfile != "") and the trace
+    // (tracefile != "")
+    void finish(const string& statsfile,
+                const string& tracefile,
+                const string& tool,
+                const vector<string>& inputfiles) {
+        if (statsfile != "") {
+            writeReport(statsfile, tool, inputfiles);
+        }
+        if (tracefile != "") {
+            writeTrace(tracefile, tool);
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,271 @@
+/*******************************************************************************
+ *
+ * ToolOptions.h
+ *
+ * DESCRIPTION: Command line options that trimZeroOne, trimZeroOneZerosAllowed,
+ *              trimZeroOnePercentZerosAllowed, trimIntegerMean and
+ *              trimAllCriteria share. Each struct adds its arguments to the
+ *              CmdLine in its constructor.
+ *              QueryArgs:     --top, --pareto, --minwidth, --minreads, --json
+ *                             (see queryWindows in Results.h)
+ *              ExportArgs:    --outfile, --format (see exportMatrix)
+ *              SelectionArgs: --emit, --selection, --names, --window (see
+ *                             TrimmedOutput.h)
+ *              ModeArgs:      --infile or --batch, --aggregate, --bitmapcache
+ *                             (optional), --pairedfile, --interleaved,
+ *                             --groupby, --every, --last, --follow, --idle
+ *              RunArgs:       --stats, --perf-counters, --trace, --reader,
+ *                             --queuedepth
+ *              checkModes:    rejects the combinations of modes, window flags
+ *                             and selected reads that are not available and
+ *                             checks a quality store against -r/-l
+ *
+ *              All checks throw an ArgException, so every front end reports
+ *              the same message for the same wrong combination.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ToolOptions_h
+#define _ToolOptions_h
+
+#include <string>
+#include <vector>
+#include <stdexcept>
+
+#include "tclap/CmdLine.h"
+#include "QualityInput.h"
+#include "ComputeMatricesGroups.h" // groupFields
+#include "TrimmedOutput.h"         // SelectionOutput
+#include "Results.h"               // WindowQuery, exportFormats
+
+using namespace std;
+using namespace TCLAP;
+
+namespace ToolOptions {
+
+    struct QueryArgs {
+        ValueArg<int>    topArg;
+        SwitchArg        paretoArg;
+        ValueArg<int>    minWidthArg;
+        ValueArg<double> minReadsArg;
+        SwitchArg        jsonArg;
+
+        QueryArgs(CmdLine& cmd)
+        : topArg(     "k", "top",      "print the k windows with the largest areas", false, 0, "integer", cmd),
+          paretoArg(  "F", "pareto",   "print the Pareto frontier of width vs. selected reads", cmd, false),
+          minWidthArg("W", "minwidth", "best window: min. width", false, 0, "integer", cmd),
+          minReadsArg("R", "minreads", "best window: min. percent of selected reads", false, 0.0, "double", cmd),
+          jsonArg(    "j", "json",     "print the windows as JSON", cmd, false) {}
+
+        Results::WindowQuery windowQuery() {
+            Results::WindowQuery query;
+            query.top             = topArg.getValue();
+            query.pareto          = paretoArg.getValue();
+            query.minWidth        = minWidthArg.getValue();
+            query.minReadsPercent = minReadsArg.getValue();
+            return query;
+        }
+
+        // the windows are printed even if an output file is given
+        bool printQuery() {
+            return topArg.isSet() || paretoArg.isSet() || minWidthArg.isSet()
+                || minReadsArg.isSet() || jsonArg.isSet();
+        }
+
+        // flags that need the list of windows of a single matrix
+        bool listSet() {
+            return topArg.isSet() || paretoArg.isSet() || jsonArg.isSet();
+        }
+    };
+
+    struct ExportArgs {
+        vector<string>           formats;
+        ValuesConstraint<string> formatConstraint;
+        ValueArg<string>         outfileArg;
+        ValueArg<string>         formatArg;
+
+        ExportArgs(CmdLine& cmd,
+                   const string& outfileHelp = "output file name",
+                   const string& formatHelp = "format of the output file")
+        : formats(Results::exportFormats),
+          formatConstraint(formats),
+          outfileArg("o", "outfile", outfileHelp, false, "",    "string",          cmd),
+          formatArg( "f", "format",  formatHelp,  false, "csv", &formatConstraint, cmd) {}
+    };
+
+    struct SelectionArgs {
+        ValueArg<string> emitArg;
+        ValueArg<string> selectionArg;
+        ValueArg<string> namesArg;
+        ValueArg<string> windowArg;
+
+        SelectionArgs(CmdLine& cmd)
+        : emitArg(     "e", "emit",      "write the selected reads of the best window as trimmed FASTQ (.gz: gzip)", false, "", "string", cmd),
+          selectionArg("S", "selection", "write one bit per read (1 = selected by the window) to this file", false, "", "string", cmd),
+          namesArg(    "N", "names",     "write the names of the selected reads to this file", false, "", "string", cmd),
+          windowArg(   "L", "window",    "\"l,r\": window for --emit, --selection and --names instead of the best window", false, "", "string", cmd) {}
+
+        bool isSet() {
+            return emitArg.isSet() || selectionArg.isSet() || namesArg.isSet();
+        }
+
+        TrimmedOutput::SelectionOutput output() {
+            TrimmedOutput::SelectionOutput selection;
+            selection.emitFile   = emitArg.getValue();
+            selection.bitsetFile = selectionArg.getValue();
+            selection.namesFile  = namesArg.getValue();
+            return selection;
+        }
+    };
+
+    struct ModeArgs {
+        const bool       hasBitmapCache;
+        ValueArg<string> infileArg;
+        ValueArg<string> batchArg;
+        SwitchArg        aggregateArg;
+        SwitchArg        bitmapArg;
+        ValueArg<string> pairedArg;
+        SwitchArg        interleavedArg;
+        ValueArg<string> groupArg;
+        ValueArg<int>    everyArg;
+        ValueArg<int>    lastArg;
+        SwitchArg        followArg;
+        ValueArg<int>    idleArg;
+
+        // bitmapCache: the tool has the option --bitmapcache
+        ModeArgs(CmdLine& cmd, const bool& bitmapCache)
+        : hasBitmapCache(bitmapCache),
+          infileArg(     "i", "infile",      "input file name", false, "", "string"),
+          batchArg(      "b", "batch",       "file with lines \"<input file> <number of reads>\" (batch mode)", false, "", "string"),
+          aggregateArg(  "A", "aggregate",   "batch mode: also report the sum over all input files", cmd, false),
+          bitmapArg(     "c", "bitmapcache", "cache the 0/1 bitmap of the threshold next to the input file", false),
+          pairedArg(     "P", "pairedfile",  "file name of the second mates (paired-end mode)", false, "", "string", cmd),
+          interleavedArg("I", "interleaved", "infile contains both mates of each pair (paired-end mode)", cmd, false),
+          groupArg(      "G", "groupby",     "separate matrices per group of reads: flowcell, lane, tile, index or a list like lane,index", false, "", "string", cmd),
+          everyArg(      "E", "every",       "time series: best window every n reads", false, 0, "integer", cmd),
+          lastArg(       "H", "last",        "time series: of the last n reads (a multiple of --every, default: all reads so far)", false, 0, "integer", cmd),
+          followArg(     "U", "follow",      "time series of a FASTQ file that is still being written (like tail -f)", cmd, false),
+          idleArg(       "D", "idle",        "--follow: stop if the file did not grow for this many seconds (default: never)", false, 0, "integer", cmd) {
+            cmd.xorAdd(infileArg, batchArg);
+            if (hasBitmapCache) {
+                cmd.add(bitmapArg);
+            }
+        }
+
+        bool pairedMode() {
+            return pairedArg.isSet() || interleavedArg.isSet();
+        }
+    };
+
+    struct RunArgs {
+        ValueArg<string>         statsArg;
+        SwitchArg                perfArg;
+        ValueArg<string>         traceArg;
+        vector<string>           readers;
+        ValuesConstraint<string> readerConstraint;
+        ValueArg<string>         readerArg;
+        ValueArg<int>            depthArg;
+
+        RunArgs(CmdLine& cmd)
+        : statsArg("T", "stats",         "write per stage timings and throughput as JSON to this file", false, "", "string", cmd),
+          perfArg( "C", "perf-counters", "--stats: also record hardware counters (cycles, instructions, cache and branch misses)", cmd, false),
+          traceArg("x", "trace",         "write a Chrome trace of the stages of all threads to this file", false, "", "string", cmd),
+          readers(QualityInput::readers),
+          readerConstraint(readers),
+          readerArg("a", "reader",       "reader backend for FASTQ files (io_uring and threads read ahead)", false, "ifstream", &readerConstraint, cmd),
+          depthArg( "q", "queuedepth",   "--reader io_uring, threads or auto: reads of 1 MB in flight", false, 8, "integer", cmd) {}
+
+        // checks the options and selects the reader backend
+        void check() {
+            if (perfArg.isSet() && !statsArg.isSet()) {
+                throw ArgException("--perf-counters needs --stats", "perf-counters");
+            }
+            if (depthArg.getValue() < 1 || depthArg.getValue() > 256) {
+                throw ArgException("must be in [1,256]", "queuedepth");
+            }
+            QualityInput::setReader(readerArg.getValue(), depthArg.getValue());
+        }
+    };
+
+    void checkModes(ModeArgs& mode,
+                    QueryArgs& query,
+                    SelectionArgs& selection,
+                    ValueArg<int>& rowsArg,
+                    const int& lengthOfSequence) {
+        const bool pairedMode     = mode.pairedMode();
+        const bool batchMode      = mode.batchArg.isSet();
+        const bool useBitmapCache = mode.bitmapArg.getValue();
+        const string bitmapCache  = mode.hasBitmapCache ? ", the bitmap cache" : "";
+        if (mode.pairedArg.isSet() && mode.interleavedArg.isSet()) {
+            throw ArgException("use either --pairedfile or --interleaved", "pairedfile");
+        }
+        if (pairedMode && useBitmapCache) {
+            throw ArgException("the bitmap cache is not available in paired-end mode", "bitmapcache");
+        }
+        if (batchMode && (pairedMode || useBitmapCache)) {
+            throw ArgException(string("the batch mode can not be combined with paired-end mode")
+                               + (mode.hasBitmapCache ? " or the bitmap cache" : ""), "batch");
+        }
+        if (selection.isSet() && (pairedMode || batchMode)) {
+            throw ArgException("the selected reads can not be written in paired-end or batch mode", "emit");
+        }
+        if (query.jsonArg.isSet() && batchMode) {
+            throw ArgException("the windows of the batch mode can not be printed as JSON", "json");
+        }
+        if (mode.groupArg.isSet() && (pairedMode || batchMode || useBitmapCache || selection.isSet())) {
+            throw ArgException("the group-by mode can not be combined with paired-end or batch mode"
+                               + bitmapCache + " or the selected reads", "groupby");
+        }
+        if (mode.groupArg.isSet() && query.listSet()) {
+            throw ArgException("the group-by mode prints one best window per group, not --top, --pareto or --json", "groupby");
+        }
+        if (mode.everyArg.isSet() && (pairedMode || batchMode || useBitmapCache || mode.groupArg.isSet() || selection.isSet())) {
+            throw ArgException("the time series mode can not be combined with paired-end, batch or group-by mode"
+                               + bitmapCache + " or the selected reads", "every");
+        }
+        if (mode.everyArg.isSet() && query.listSet()) {
+            throw ArgException("the time series mode prints one best window per step, not --top, --pareto or --json", "every");
+        }
+        if (mode.everyArg.isSet() && mode.everyArg.getValue() < 1) {
+            throw ArgException("must be at least 1", "every");
+        }
+        if (mode.lastArg.isSet() && (!mode.everyArg.isSet() || mode.lastArg.getValue() < 1
+                                     || mode.lastArg.getValue() % mode.everyArg.getValue() != 0)) {
+            throw ArgException("needs --every and must be a multiple of it", "last");
+        }
+        if (mode.followArg.isSet() && !mode.everyArg.isSet()) {
+            throw ArgException("needs --every", "follow");
+        }
+        if (mode.idleArg.isSet() && (!mode.followArg.isSet() || mode.idleArg.getValue() < 1)) {
+            throw ArgException("needs --follow and must be at least 1", "idle");
+        }
+        if (mode.groupArg.isSet()) {
+            try {
+                ComputeMatrices::groupFields(mode.groupArg.getValue());
+            } catch (runtime_error &e) {
+                throw ArgException(e.what(), "groupby");
+            }
+        }
+        if (!batchMode && !mode.followArg.getValue() && !rowsArg.isSet()) {
+            throw ArgException("the number of reads is required", "reads");
+        }
+        if (!batchMode) {
+            try {
+                // interleaved: both mates of each pair in the input file
+                QualityInput::checkQualityStore(mode.infileArg.getValue(),
+                                                (mode.interleavedArg.isSet() ? 2 : 1) * rowsArg.getValue(),
+                                                lengthOfSequence);
+                if (mode.pairedArg.getValue() != "") {
+                    QualityInput::checkQualityStore(mode.pairedArg.getValue(), rowsArg.getValue(), lengthOfSequence);
+                }
+            } catch (runtime_error &e) {
+                throw ArgException(e.what(), "infile");
+            }
+        }
+    }
+
+}
+
+#endif
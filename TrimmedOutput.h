@@ -0,0 +1,368 @@
+/*******************************************************************************
+ *
+ * TrimmedOutput.h
+ *
+ * DESCRIPTION: Output of the reads that are selected by a window [l,r], i.e.
+ *              whose quality line fulfills the problem in [l,r] (see
+ *              Problem::selects).
+ *              writeSelectedReads: streams the input a second time and writes
+ *                  emitFile:   the selected reads cut to [l,r] as FASTQ
+ *                              (header, sequence, "+" line and quality line)
+ *                  bitsetFile: one bit per read in file order, 1 = selected
+ *                  namesFile:  the names of the selected reads, one per line
+ *              All three outputs are optional and computed in one pass.
+ *
+ *              One reading thread splits the input into batches of complete
+ *              FASTQ records (only the quality lines for a quality store, which
+ *              is enough for the bitset). num_threads worker threads check and
+ *              format the reads of a batch into one buffer per output and, if
+ *              the name of the emitted file ends with ".gz", compress it into
+ *              a gzip member of its own. A concatenation of gzip members is a
+ *              valid gzip file, so the compression runs in parallel as well.
+ *              The writer (calling thread) writes the buffers in the order of
+ *              the input.
+ *
+ *              Layout of the bitset file: | SelectionHeader | bits |
+ *              bit i of the bits is bit (i mod 8) of byte (i / 8).
+ *
+ * RUNTIMES: If the input has r reads of length l: O( r * l )
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _TrimmedOutput_h
+#define _TrimmedOutput_h
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <assert.h>
+
+#include <zlib.h>
+
+#include "ConcurrentQueue.h"
+#include "QualityInput.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace TrimmedOutput {
+
+    const char     selectionMagic[8] = {'S','E','Q','T','R','S','L','1'};
+    const uint32_t selectionVersion  = 1;
+
+    struct SelectionHeader {
+        char     magic[8];
+        uint32_t version;
+        int32_t  left;
+        int32_t  right;
+        uint32_t reserved;
+        uint64_t numberOfReads;
+        uint64_t numberOfSelectedReads;
+        uint64_t dataOffset;
+    };
+
+    // file names of the outputs, "" = no output
+    struct SelectionOutput {
+        string emitFile;
+        string bitsetFile;
+        string namesFile;
+    };
+
+    // number of reads per batch, large enough that each batch gives a
+    // buffer of about 1 MB (and a gzip member with a good compression)
+    const int emitBatchSize = 4096;
+
+    // consecutive reads: complete FASTQ records (linesPerRead = 4) or only
+    // the quality lines (linesPerRead = 1)
+    struct RecordBatch {
+        int            index;
+        int            linesPerRead;
+        vector<string> lines;
+        vector<bool>   selected;
+        string         emitted;
+        string         names;
+    };
+
+    bool endsWith(const string& s, const string& suffix) {
+        return s.size() >= suffix.size()
+            && s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // compresses data into one gzip member
+    string gzipMember(const string& data) {
+        z_stream stream;
+        stream.zalloc = Z_NULL;
+        stream.zfree  = Z_NULL;
+        stream.opaque = Z_NULL;
+        // windowBits 15 + 16: write a gzip header and trailer
+        if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw runtime_error("cannot initialize gzip compression");
+        }
+        string compressed(deflateBound(&stream, data.size()), '\0');
+        stream.next_in   = (Bytef*) data.data();
+        stream.avail_in  = data.size();
+        stream.next_out  = (Bytef*) &compressed[0];
+        stream.avail_out = compressed.size();
+        int status = deflate(&stream, Z_FINISH);
+        compressed.resize(stream.total_out);
+        deflateEnd(&stream);
+        if (status != Z_STREAM_END) {
+            throw runtime_error("gzip compression failed");
+        }
+        return compressed;
+    }
+
+    // name of a read: the header line without "@" up to the first white space
+    inline void appendReadName(string& names, const string& header) {
+        size_t start = (!header.empty() && header[0] == '@') ? 1 : 0;
+        size_t end = header.find_first_of(" \t", start);
+        names.append(header, start, (end == string::npos ? header.size() : end) - start);
+        names += '\n';
+    }
+
+    void readRecordBatches(const string& inputfile,
+                           const int& numberOfSequences,
+                           const bool& qualityLinesOnly,
+                           const int& num_threads,
+                           ConcurrentQueue<RecordBatch*>& q,
+                           atomic<int>& numberOfBatches,
+                           atomic<bool>& ready){
+
+        Stats::ThreadScope statsThread("reader");
+        ifstream fastq;
+        unique_ptr<QualityLineReader> qualities;
+        if (qualityLinesOnly) {
+            qualities.reset(new QualityLineReader(inputfile));
+        } else {
+            fastq.open(inputfile, ios::in);
+        }
+        int index = 0;
+        for (int z = 0; z < numberOfSequences; z += emitBatchSize) {
+            RecordBatch* batch = new RecordBatch;
+            batch->index = index++;
+            batch->linesPerRead = qualityLinesOnly ? 1 : 4;
+            batch->lines.resize(batch->linesPerRead * min(emitBatchSize, numberOfSequences - z));
+            {
+                Stats::Stage parse(Stats::Parse);
+                for (auto& zeile: batch->lines) {
+                    if (qualityLinesOnly) {
+                        qualities->nextQualityLine(zeile);
+                    } else {
+                        getline(fastq, zeile);
+                    }
+                }
+            }
+
+            // at most two batches per worker thread are waiting
+            while (q.size() >= 2 * num_threads){
+                Stats::Stage wait(Stats::QueueWait);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            q.push(batch);
+            Stats::queueDepth(q.size() * emitBatchSize);
+        }
+        numberOfBatches = index;
+        // parsing of the file is completed
+        ready = true;
+
+    }
+
+    // returns the number of selected reads
+    long long writeSelectedReads(const string& inputfile,
+                                 const int& numberOfSequences,
+                                 const int& left,
+                                 const int& right,
+                                 function<bool(const string&, const int&, const int&)> selects,
+                                 const SelectionOutput& output,
+                                 const int& num_threads)
+    {
+        const bool emit  = output.emitFile  != "";
+        const bool names = output.namesFile != "";
+        // the bitset alone only needs the quality lines, so it is also
+        // available for a quality store
+        const bool qualityLinesOnly = !emit && !names;
+        if (!qualityLinesOnly && QualityStore::isQualityStore(inputfile)) {
+            throw runtime_error("a quality store has no sequences and read names, they need the FASTQ file");
+        }
+        const bool gzip  = endsWith(output.emitFile, ".gz");
+        const int  width = right - left + 1;
+
+        ofstream emitOut, namesOut;
+        if (emit) {
+            emitOut.open(output.emitFile, ios::out | ios::binary);
+            if (!emitOut) {
+                throw runtime_error("cannot open " + output.emitFile);
+            }
+        }
+        if (names) {
+            namesOut.open(output.namesFile, ios::out | ios::binary);
+            if (!namesOut) {
+                throw runtime_error("cannot open " + output.namesFile);
+            }
+        }
+        vector<uint8_t> bits(output.bitsetFile != "" ? (numberOfSequences + 7) / 8 : 0, 0);
+
+        ConcurrentQueue<RecordBatch*> q;
+        atomic<bool> ready(false);
+        atomic<int>  numberOfBatches(-1);
+
+        // processed batches that wait for the batches before them, a worker
+        // waits while its batch is more than maxDone batches ahead of the
+        // writer (the batch the writer needs next is never held back)
+        map<int, RecordBatch*> done;
+        mutex doneMutex;
+        condition_variable writerProgress;
+        int nextBatch = 0;
+        const int maxDone = 4 * num_threads;
+        bool failed = false;
+
+        std::thread readerThread(std::bind(&readRecordBatches, inputfile, numberOfSequences,
+                                           qualityLinesOnly, num_threads, std::ref(q),
+                                           std::ref(numberOfBatches), std::ref(ready)));
+
+        vector<thread> threads(num_threads);
+        for (int th = 0; th < num_threads; th++){
+            threads[th] = thread([&]() {
+                Stats::ThreadScope statsThread("worker");
+                while (!ready || !q.empty()){
+                    RecordBatch* batch = nullptr;
+                    if (!q.tryPop(batch)){
+                        Stats::Stage wait(Stats::QueueWait);
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        continue;
+                    }
+                    assert (batch != nullptr);
+                    Stats::Stage emitStage(Stats::Emit);
+                    const int k = batch->linesPerRead;
+                    const int reads = batch->lines.size() / k;
+                    batch->selected.resize(reads);
+                    for (int z = 0; z < reads; z++) {
+                        const string& quality = batch->lines[z*k + k-1];
+                        if ((int) quality.size() <= right || !selects(quality, left, right)) {
+                            continue;
+                        }
+                        batch->selected[z] = true;
+                        if (names) {
+                            appendReadName(batch->names, batch->lines[z*k]);
+                        }
+                        if (emit) {
+                            const string& sequence = batch->lines[z*k + 1];
+                            batch->emitted += batch->lines[z*k];
+                            batch->emitted += '\n';
+                            batch->emitted.append(sequence, min((size_t) left, sequence.size()), width);
+                            batch->emitted += '\n';
+                            batch->emitted += batch->lines[z*k + 2];
+                            batch->emitted += '\n';
+                            batch->emitted.append(quality, left, width);
+                            batch->emitted += '\n';
+                        }
+                    }
+                    vector<string>().swap(batch->lines);
+                    try {
+                        if (gzip) {
+                            batch->emitted = gzipMember(batch->emitted);
+                        }
+                    } catch (runtime_error&) {
+                        lock_guard<mutex> lock(doneMutex);
+                        failed = true;
+                    }
+                    unique_lock<mutex> lock(doneMutex);
+                    if (batch->index >= nextBatch + maxDone) {
+                        Stats::Stage wait(Stats::QueueWait);
+                        writerProgress.wait(lock, [&]() { return batch->index < nextBatch + maxDone; });
+                    }
+                    done[batch->index] = batch;
+                }
+            });
+        }
+
+        // write the buffers in the order of the input
+        long long selected = 0;
+        while (!ready || nextBatch < numberOfBatches) {
+            RecordBatch* batch = nullptr;
+            {
+                lock_guard<mutex> lock(doneMutex);
+                auto it = done.find(nextBatch);
+                if (it != done.end()) {
+                    batch = it->second;
+                    done.erase(it);
+                }
+            }
+            if (batch == nullptr) {
+                Stats::Stage wait(Stats::QueueWait);
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            Stats::Stage writeStage(Stats::Emit);
+            if (emit) {
+                emitOut.write(batch->emitted.data(), batch->emitted.size());
+            }
+            if (names) {
+                namesOut.write(batch->names.data(), batch->names.size());
+            }
+            for (size_t z = 0; z < batch->selected.size(); z++) {
+                if (batch->selected[z]) {
+                    selected++;
+                    if (!bits.empty()) {
+                        long long read = (long long) batch->index * emitBatchSize + z;
+                        bits[read >> 3] |= 1 << (read & 7);
+                    }
+                }
+            }
+            delete batch;
+            {
+                lock_guard<mutex> lock(doneMutex);
+                nextBatch++;
+            }
+            writerProgress.notify_all();
+        }
+
+        // wait for all threads
+        readerThread.join();
+        std::for_each(threads.begin(), threads.end(),
+                      std::mem_fn(&std::thread::join));
+
+        if (failed || (emit && !emitOut)) {
+            throw runtime_error("cannot write " + output.emitFile);
+        }
+        if (names && !namesOut) {
+            throw runtime_error("cannot write " + output.namesFile);
+        }
+
+        if (output.bitsetFile != "") {
+            SelectionHeader h;
+            memset(&h, 0, sizeof(SelectionHeader));
+            memcpy(h.magic, selectionMagic, sizeof(selectionMagic));
+            h.version               = selectionVersion;
+            h.left                  = left;
+            h.right                 = right;
+            h.numberOfReads         = numberOfSequences;
+            h.numberOfSelectedReads = selected;
+            h.dataOffset            = sizeof(SelectionHeader);
+            ofstream out(output.bitsetFile, ios::out | ios::binary);
+            out.write((const char*) &h, sizeof(SelectionHeader));
+            out.write((const char*) bits.data(), bits.size());
+            if (!out) {
+                throw runtime_error("cannot write " + output.bitsetFile);
+            }
+        }
+        return selected;
+    }
+
+}
+
+#endif
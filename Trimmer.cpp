@@ -0,0 +1,192 @@
+/*******************************************************************************
+ *
+ * Trimmer.cpp
+ *
+ * DESCRIPTION: Implementation of Trimmer.h with the kernels of Problems.h.
+ *              Each call of add takes an idle set of counters (kernel and
+ *              RowCounters) or creates a new one, so concurrent calls never
+ *              share counters and only lock to take and give back a set.
+ *              matrix adds all sets and calls finalize of the problem.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+
+#include "Trimmer.h"
+#include "Problems.h"
+#include "Results.h"
+
+using namespace std;
+
+namespace SequenceTrimming {
+
+    struct Trimmer::Impl {
+        struct Partial {
+            ComputeMatrices::Kernel      kernel;
+            ComputeMatrices::RowCounters counters;
+            long long                    reads;
+            Partial(const ComputeMatrices::Problem& problem)
+            : kernel(problem.makeKernel()), counters(problem.lengthOfSequence), reads(0) {}
+        };
+
+        ComputeMatrices::Problem          problem;
+        string                            signature; // problem and parameters
+        mutable mutex                     m;
+        vector<unique_ptr<Partial> >      partials;
+        vector<Partial*>                  idle;      // not used by add
+
+        Impl(const ComputeMatrices::Problem& p, const string& s) : problem(p), signature(s) {}
+
+        Partial* acquire() {
+            lock_guard<mutex> lock(m);
+            if (idle.empty()) {
+                partials.emplace_back(new Partial(problem));
+                return partials.back().get();
+            }
+            Partial* partial = idle.back();
+            idle.pop_back();
+            return partial;
+        }
+
+        void release(Partial* partial) {
+            lock_guard<mutex> lock(m);
+            idle.push_back(partial);
+        }
+    };
+
+    // checks the parameters that all problems have
+    static void checkParameters(const int& length, const int& shift) {
+        if (length < 1) {
+            throw runtime_error("the length of the reads must be at least 1");
+        }
+        if (shift < 0 || shift > 127) {
+            throw runtime_error("the shift must be in [0,127]");
+        }
+    }
+
+    Trimmer Trimmer::zeroOne(const int& length, const int& threshold, const int& shift) {
+        checkParameters(length, shift);
+        ostringstream s;
+        s << "0-zeros L=" << length << " t=" << threshold << " s=" << shift;
+        return Trimmer(new Impl(ComputeMatrices::zeroOneProblem(length, threshold, shift), s.str()));
+    }
+
+    Trimmer Trimmer::zerosAllowed(const int& length, const int& zeros,
+                                  const int& threshold, const int& shift) {
+        checkParameters(length, shift);
+        if (zeros < 0) {
+            throw runtime_error("the number of allowed zeros must be at least 0");
+        }
+        ostringstream s;
+        s << "z-zeros L=" << length << " z=" << zeros << " t=" << threshold << " s=" << shift;
+        return Trimmer(new Impl(ComputeMatrices::zerosAllowedProblem(length, zeros, threshold, shift), s.str()));
+    }
+
+    Trimmer Trimmer::percentZerosAllowed(const int& length, const double& percent,
+                                         const int& threshold, const int& shift) {
+        checkParameters(length, shift);
+        if (percent < 0 || percent > 1) {
+            throw runtime_error("the percent of allowed zeros must be in [0,1]");
+        }
+        ostringstream s;
+        s << "p-percent L=" << length << " p=" << percent << " t=" << threshold << " s=" << shift;
+        return Trimmer(new Impl(ComputeMatrices::percentZerosAllowedProblem(length, percent, threshold, shift), s.str()));
+    }
+
+    Trimmer Trimmer::integerMean(const int& length, const double& mean, const int& shift) {
+        checkParameters(length, shift);
+        ostringstream s;
+        s << "m-mean L=" << length << " m=" << mean << " s=" << shift;
+        return Trimmer(new Impl(ComputeMatrices::meanProblem(length, mean, shift), s.str()));
+    }
+
+    Trimmer::Trimmer(Impl* impl) : impl_(impl) {}
+    Trimmer::Trimmer(Trimmer&& other) = default;
+    Trimmer& Trimmer::operator=(Trimmer&& other) = default;
+    Trimmer::~Trimmer() = default;
+
+    void Trimmer::add(const string* qualityLines, const size_t& count) {
+        const size_t L = impl_->problem.lengthOfSequence;
+        for (size_t k = 0; k < count; k++) {
+            if (qualityLines[k].size() < L) {
+                throw runtime_error("quality line " + to_string(k) + " of the batch is shorter than "
+                                    + to_string(L));
+            }
+        }
+        Impl::Partial* partial = impl_->acquire();
+        for (size_t k = 0; k < count; k++) {
+            partial->kernel(qualityLines[k], partial->counters);
+        }
+        partial->reads += count;
+        impl_->release(partial);
+    }
+
+    void Trimmer::merge(const Trimmer& other) {
+        if (&other == this) {
+            throw runtime_error("a Trimmer can not be merged with itself");
+        }
+        if (other.impl_->signature != impl_->signature) {
+            throw runtime_error("cannot merge \"" + other.impl_->signature + "\" into \""
+                                + impl_->signature + "\"");
+        }
+        Impl::Partial* partial = impl_->acquire();
+        {
+            lock_guard<mutex> lock(other.impl_->m);
+            for (const auto& p: other.impl_->partials) {
+                partial->counters.add(p->counters);
+                partial->reads += p->reads;
+            }
+        }
+        impl_->release(partial);
+    }
+
+    vector<vector<int> > Trimmer::matrix() const {
+        lock_guard<mutex> lock(impl_->m);
+        if (impl_->partials.empty()) {
+            return impl_->problem.finalize(ComputeMatrices::RowCounters(impl_->problem.lengthOfSequence));
+        }
+        if (impl_->partials.size() == 1) {
+            return impl_->problem.finalize(impl_->partials[0]->counters);
+        }
+        ComputeMatrices::RowCounters total(impl_->problem.lengthOfSequence);
+        for (const auto& p: impl_->partials) {
+            total.add(p->counters);
+        }
+        return impl_->problem.finalize(total);
+    }
+
+    Optimum Trimmer::optimum(const int& minWidth, const double& minReadsPercent) const {
+        Results::WindowQuery query;
+        query.minWidth        = minWidth;
+        query.minReadsPercent = minReadsPercent;
+        Results::WindowSummary windows = Results::queryWindows(matrix(), reads(), query);
+        Optimum result = {windows.found, windows.best.left, windows.best.right,
+                          windows.best.reads, windows.best.area};
+        return result;
+    }
+
+    long long Trimmer::reads() const {
+        lock_guard<mutex> lock(impl_->m);
+        long long reads = 0;
+        for (const auto& p: impl_->partials) {
+            reads += p->reads;
+        }
+        return reads;
+    }
+
+    int Trimmer::length() const {
+        return impl_->problem.lengthOfSequence;
+    }
+
+    const string& Trimmer::problem() const {
+        return impl_->problem.name;
+    }
+
+}
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *
+ * Trimmer.h
+ *
+ * DESCRIPTION: Library interface (libtrimming.a, libtrimming.so) to compute
+ *              the trimming windows of reads that are already in memory,
+ *              e.g. inside of a demultiplexer, without a FASTQ file.
+ *              A Trimmer is created for one problem (0-zeros, z-zeros,
+ *              p-percent or m-mean) and the length L of the reads:
+ *              add:      adds a batch of quality lines (ASCII with the shift of
+ *                        the Trimmer, at least L chars, only the first L are
+ *                        used). add may be called from several threads at the
+ *                        same time, each call works on counters of its own.
+ *              merge:    adds the counters of another Trimmer of the same
+ *                        problem (e.g. of another sample or process)
+ *              matrix:   the matrix c, c[l][r] = number of reads that fulfill
+ *                        the problem in the window [l,r] (0-based)
+ *              optimum:  the window with the largest area (width * reads)
+ *              The header only needs the standard library, the algorithms
+ *              are in Trimmer.cpp (see Problems.h). Errors are thrown as
+ *              std::runtime_error.
+ *
+ *              Example:
+ *                  SequenceTrimming::Trimmer t =
+ *                      SequenceTrimming::Trimmer::integerMean(101, 30.0, 33);
+ *                  t.add(qualityLines); // from any thread
+ *                  SequenceTrimming::Optimum best = t.optimum();
+ *
+ * RUNTIMES: add: as the sequential algorithm of the problem per read
+ *           matrix, optimum: O( L^2 * (number of threads that called add) )
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _Trimmer_h
+#define _Trimmer_h
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+namespace SequenceTrimming {
+
+    struct Optimum {
+        bool      found;  // false: no window fulfills the constraints
+        int       left;   // 0-based, inclusive
+        int       right;
+        int       reads;  // c[left][right]
+        long long area;   // reads * (right - left + 1)
+    };
+
+    class Trimmer {
+    public:
+        // 0-zeros: no quality score < threshold in the window
+        static Trimmer zeroOne(const int& length, const int& threshold, const int& shift);
+        // z-zeros: at most zeros quality scores < threshold in the window
+        static Trimmer zerosAllowed(const int& length, const int& zeros,
+                                    const int& threshold, const int& shift);
+        // p-percent: at most percent * width quality scores < threshold
+        static Trimmer percentZerosAllowed(const int& length, const double& percent,
+                                           const int& threshold, const int& shift);
+        // m-mean: mean quality score in the window >= mean
+        static Trimmer integerMean(const int& length, const double& mean, const int& shift);
+
+        Trimmer(Trimmer&& other);
+        Trimmer& operator=(Trimmer&& other);
+        ~Trimmer();
+
+        // thread-safe
+        void add(const std::string* qualityLines, const std::size_t& count);
+        void add(const std::vector<std::string>& qualityLines) {
+            add(qualityLines.data(), qualityLines.size());
+        }
+
+        // other must solve the same problem with the same parameters and
+        // must not be used by add at the same time
+        void merge(const Trimmer& other);
+
+        std::vector<std::vector<int> > matrix() const;
+        Optimum optimum(const int& minWidth = 0, const double& minReadsPercent = 0.0) const;
+
+        long long          reads() const;  // quality lines added (and merged)
+        int                length() const;
+        const std::string& problem() const; // "0-zeros", "z-zeros", ...
+
+    private:
+        struct Impl;
+        explicit Trimmer(Impl* impl);
+        std::unique_ptr<Impl> impl_;
+    };
+
+}
+
+#endif
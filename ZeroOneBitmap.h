@@ -0,0 +1,268 @@
+/*******************************************************************************
+ *
+ * ZeroOneBitmap.h
+ *
+ * DESCRIPTION: The problems 0-zeros, z-zeros and p-percent only need to know
+ *              for each nucleotide whether its quality char c fulfills
+ *              I(c) >= threshold + shift ("1") or not ("0"). A read is packed
+ *              into ceil(l/64) words of 64 bits, bit i of the read is bit
+ *              (i mod 64) of word (i / 64). Unused bits of the last word are 0.
+ *
+ *              bitmapFileName: name of the cached bitmap next to the input
+ *              writeBitmap:    writes the bitmap of all reads for a threshold
+ *              Reader:         memory-maps a bitmap file
+ *              forEachOneBlock, nextOne, nextZero: scans over packed reads
+ *
+ *              Layout: | Header | read 0 | read 1 | ... | read r-1 |
+ *
+ * RUNTIMES: If the input has r reads of length l:
+ *           writeBitmap: O( r * l )
+ *           nextOne, nextZero: O( l / 64 )
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _ZeroOneBitmap_h
+#define _ZeroOneBitmap_h
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "QualityInput.h"
+#include "Stats.h"
+
+using namespace std;
+
+namespace ZeroOneBitmap {
+
+    const char     magic[8] = {'S','E','Q','T','R','B','M','1'};
+    const uint32_t version  = 1;
+
+    struct Header {
+        char     magic[8];
+        uint32_t version;
+        uint32_t lengthOfSequence;
+        uint64_t numberOfReads;
+        int32_t  thresholdPlusShift;
+        uint32_t wordsPerRead;
+        uint64_t inputSize;      // size and modification time of the input
+        int64_t  inputMTime;     // file, a changed input invalidates the cache
+        uint64_t dataOffset;
+    };
+
+    inline int wordsPerRead(const int& lengthOfSequence) {
+        return (lengthOfSequence + 63) / 64;
+    }
+
+    string bitmapFileName(const string& inputfile,
+                          const int& thresholdGoodValues,
+                          const int& shiftToConvertChars) {
+        return inputfile + ".t" + to_string(thresholdGoodValues)
+                         + "s" + to_string(shiftToConvertChars) + ".bits";
+    }
+
+    // bit i = 1 iff zeile[i] >= thresholdPlusShift
+    inline void packRead(const string& zeile,
+                         const int& lengthOfSequence,
+                         const int& thresholdPlusShift,
+                         uint64_t* words) {
+        for (int w = 0; w < wordsPerRead(lengthOfSequence); w++) {
+            words[w] = 0;
+        }
+        for (int i = 0; i < lengthOfSequence; i++) {
+            words[i >> 6] |= ((uint64_t) (zeile[i] >= thresholdPlusShift)) << (i & 63);
+        }
+    }
+
+    inline bool bit(const uint64_t* words, const int& i) {
+        return (words[i >> 6] >> (i & 63)) & 1;
+    }
+
+    // first position >= i with a 1, or lengthOfSequence if there is none
+    inline int nextOne(const uint64_t* words, const int& lengthOfSequence, const int& i) {
+        if (i >= lengthOfSequence) return lengthOfSequence;
+        int w = i >> 6;
+        uint64_t x = words[w] & (~0ULL << (i & 63));
+        while (x == 0) {
+            w++;
+            if (w * 64 >= lengthOfSequence) return lengthOfSequence;
+            x = words[w];
+        }
+        return min(lengthOfSequence, w * 64 + __builtin_ctzll(x));
+    }
+
+    // first position >= i with a 0, or lengthOfSequence if there is none
+    inline int nextZero(const uint64_t* words, const int& lengthOfSequence, const int& i) {
+        if (i >= lengthOfSequence) return lengthOfSequence;
+        int w = i >> 6;
+        uint64_t x = ~words[w] & (~0ULL << (i & 63));
+        while (x == 0) {
+            w++;
+            if (w * 64 >= lengthOfSequence) return lengthOfSequence;
+            x = ~words[w];
+        }
+        return min(lengthOfSequence, w * 64 + __builtin_ctzll(x));
+    }
+
+    // calls f(start,end) for each maximal block of 1s in the read
+    template <typename F>
+    inline void forEachOneBlock(const uint64_t* words, const int& lengthOfSequence, F f) {
+        int i = nextOne(words, lengthOfSequence, 0);
+        while (i < lengthOfSequence) {
+            int j = nextZero(words, lengthOfSequence, i);
+            f(i, j-1);
+            i = nextOne(words, lengthOfSequence, j);
+        }
+    }
+
+    // writes the bitmap for thresholdPlusShift of the first numberOfSequences
+    // reads of inputfile (FASTQ or quality store)
+    void writeBitmap(const string& inputfile,
+                     const string& bitmapfile,
+                     const int& numberOfSequences,
+                     const int& lengthOfSequence,
+                     const int& thresholdPlusShift) {
+        struct stat st;
+        if (stat(inputfile.c_str(), &st) != 0) {
+            throw runtime_error("cannot open " + inputfile);
+        }
+
+        Header h;
+        memset(&h, 0, sizeof(Header));
+        memcpy(h.magic, magic, sizeof(magic));
+        h.version            = version;
+        h.lengthOfSequence   = lengthOfSequence;
+        h.numberOfReads      = numberOfSequences;
+        h.thresholdPlusShift = thresholdPlusShift;
+        h.wordsPerRead       = wordsPerRead(lengthOfSequence);
+        h.inputSize          = st.st_size;
+        h.inputMTime         = st.st_mtime;
+        h.dataOffset         = sizeof(Header);
+
+        // write to a temporary file first, so that an interrupted run never
+        // leaves a truncated cache behind
+        string tmpfile = bitmapfile + ".tmp";
+        ofstream out(tmpfile, ios::out | ios::binary);
+        if (!out) {
+            throw runtime_error("cannot open " + tmpfile);
+        }
+        out.write((const char*) &h, sizeof(Header));
+
+        QualityLineReader in(inputfile);
+        string zeile;
+        vector<uint64_t> words(h.wordsPerRead);
+        for (int z = 0; z < numberOfSequences; z++) {
+            in.nextQualityLine(zeile);
+            packRead(zeile, lengthOfSequence, thresholdPlusShift, words.data());
+            out.write((const char*) words.data(), h.wordsPerRead * sizeof(uint64_t));
+        }
+        out.close();
+        if (rename(tmpfile.c_str(), bitmapfile.c_str()) != 0) {
+            throw runtime_error("cannot write " + bitmapfile);
+        }
+    }
+
+    // read-only memory-mapped view on a bitmap file
+    class Reader {
+    public:
+
+        Reader(const string& bitmapfile) {
+            int fd = open(bitmapfile.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw runtime_error("cannot open " + bitmapfile);
+            }
+            struct stat st;
+            fstat(fd, &st);
+            size_ = st.st_size;
+            if (size_ < sizeof(Header)) {
+                close(fd);
+                throw runtime_error(bitmapfile + " is not a bitmap file");
+            }
+            void* p = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            close(fd);
+            if (p == MAP_FAILED) {
+                throw runtime_error("cannot map " + bitmapfile);
+            }
+            madvise(p, size_, MADV_SEQUENTIAL);
+            base_ = (const uint8_t*) p;
+            memcpy(&header_, base_, sizeof(Header));
+            if (memcmp(header_.magic, magic, sizeof(magic)) != 0 || header_.version != version
+                || size_ < header_.dataOffset + header_.numberOfReads * header_.wordsPerRead * sizeof(uint64_t)) {
+                munmap(p, size_);
+                throw runtime_error(bitmapfile + " is not a bitmap file");
+            }
+        }
+
+        ~Reader() {
+            munmap((void*) base_, size_);
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        const Header& header() const { return header_; }
+
+        // packed words of read z
+        const uint64_t* read(const uint64_t& z) const {
+            return (const uint64_t*) (base_ + header_.dataOffset) + z * header_.wordsPerRead;
+        }
+
+        // true, if the bitmap was written for the given input and parameters
+        bool matches(const string& inputfile,
+                     const int& numberOfSequences,
+                     const int& lengthOfSequence,
+                     const int& thresholdPlusShift) const {
+            struct stat st;
+            if (stat(inputfile.c_str(), &st) != 0) {
+                return false;
+            }
+            return header_.numberOfReads      == (uint64_t) numberOfSequences
+                && header_.lengthOfSequence   == (uint32_t) lengthOfSequence
+                && header_.thresholdPlusShift == thresholdPlusShift
+                && header_.inputSize          == (uint64_t) st.st_size
+                && header_.inputMTime         == (int64_t)  st.st_mtime;
+        }
+
+    private:
+        Header         header_;
+        const uint8_t* base_;
+        size_t         size_;
+    };
+
+    // opens the cached bitmap of inputfile for the given threshold. If there
+    // is none (first run) or it is outdated, it is written first.
+    unique_ptr<Reader> openOrCreate(const string& inputfile,
+                                    const int& numberOfSequences,
+                                    const int& lengthOfSequence,
+                                    const int& thresholdGoodValues,
+                                    const int& shiftToConvertChars) {
+        Stats::Stage open(Stats::Open);
+        string bitmapfile = bitmapFileName(inputfile, thresholdGoodValues, shiftToConvertChars);
+        int thresholdPlusShift = thresholdGoodValues + shiftToConvertChars;
+        try {
+            unique_ptr<Reader> bitmap(new Reader(bitmapfile));
+            if (bitmap->matches(inputfile, numberOfSequences, lengthOfSequence, thresholdPlusShift)) {
+                return bitmap;
+            }
+        } catch (runtime_error&) {
+            // no usable cache, write a new one
+        }
+        writeBitmap(inputfile, bitmapfile, numberOfSequences, lengthOfSequence, thresholdPlusShift);
+        return unique_ptr<Reader>(new Reader(bitmapfile));
+    }
+
+}
+
+#endif
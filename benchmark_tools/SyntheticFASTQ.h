@@ -0,0 +1,242 @@
+/*******************************************************************************
+ *
+ * SyntheticFASTQ.h
+ *
+ * DESCRIPTION: Generator of synthetic FASTQ files for tests and benchmarks.
+ *              Profiles of the quality scores q in [2,41]:
+ *              realistic:   the mean falls from 37 to 17 towards the 3' end
+ *                           (quadratic), the noise grows along the read, 1% of
+ *                           the reads have a burst of 1 to 8 "N" with q = 2
+ *              binned:      realistic, binned like NovaSeq (2, 12, 23, 37)
+ *              adversarial-alternating:
+ *                           41 and 2 alternate, so there are no long blocks
+ *                           of good scores and the mean of every window is
+ *                           about 21.5: the worst case of p-percent and m-mean
+ *                           (quadratic runtime per read)
+ *              all-good:    q = 41 everywhere
+ *              uniform:     q uniform in [11,40] (as the old randomFASTQ)
+ *              The sequences are random bases (and the "N" of a burst), the
+ *              lengths are uniform in [minLength,maxLength].
+ *
+ *              generate: the reads are split into chunks of chunkSize reads.
+ *              Each chunk has its own random generator, seeded by the seed and
+ *              the number of the chunk, so the file does not depend on the
+ *              number of threads. num_threads threads format the chunks (and
+ *              compress each into a gzip member of its own if the file name
+ *              ends with ".gz"), the calling thread writes them in order.
+ *
+ * RUNTIMES: O( reads * maxLength )
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#ifndef _SyntheticFASTQ_h
+#define _SyntheticFASTQ_h
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <stdexcept>
+#include <cstdint>
+
+#include "TrimmedOutput.h" // gzipMember
+
+using namespace std;
+
+namespace SyntheticFASTQ {
+
+    const vector<string> profiles = {"realistic", "binned", "adversarial-alternating", "all-good", "uniform"};
+
+    // reads per chunk, about 4 MB of FASTQ for reads of length 100
+    const long long chunkSize = 16384;
+
+    // splitmix64, fast and good enough for synthetic data
+    struct Random {
+        uint64_t state;
+        Random(const uint64_t& seed) : state(seed) {}
+        uint64_t next() {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+        // uniform in [0,n)
+        int below(const int& n) {
+            return (int) ((next() >> 32) * (uint64_t) n >> 32);
+        }
+    };
+
+    struct Settings {
+        long long reads;
+        int       minLength, maxLength;
+        string    profile;
+        uint64_t  seed;
+        int       shift;
+    };
+
+    // nearest of the four NovaSeq bins
+    inline int binNovaSeq(const int& q) {
+        if (q < 7)  return 2;
+        if (q < 18) return 12;
+        if (q < 30) return 23;
+        return 37;
+    }
+
+    // realistic profile: mean and spread of the noise per position
+    struct Profile {
+        vector<int> mean, spread;
+        Profile(const int& maxLength) : mean(maxLength), spread(maxLength) {
+            const double L = max(1, maxLength - 1);
+            for (int i = 0; i < maxLength; i++) {
+                double x = i / L;
+                mean[i]   = (int) (37 - 20 * x * x);
+                spread[i] = 3 + (int) (6 * x);
+            }
+        }
+    };
+
+    // quality scores (+ shift) and bases of one read of the given length
+    void makeRead(const Settings& s, const Profile& profile, const int& length, Random& rng,
+                  string& sequence, string& quality)
+    {
+        sequence.resize(length);
+        quality.resize(length);
+        uint64_t bits = 0;
+        for (int i = 0; i < length; i++) {
+            if ((i & 31) == 0) bits = rng.next();
+            sequence[i] = "ACGT"[bits & 3];
+            bits >>= 2;
+        }
+        if (s.profile == "all-good") {
+            fill(quality.begin(), quality.end(), (char) (41 + s.shift));
+        } else if (s.profile == "adversarial-alternating") {
+            int phase = rng.below(2);
+            for (int i = 0; i < length; i++) {
+                quality[i] = (char) (((i + phase) & 1 ? 41 : 2) + s.shift);
+            }
+        } else if (s.profile == "uniform") {
+            for (int i = 0; i < length; i++) {
+                quality[i] = (char) (11 + rng.below(30) + s.shift);
+            }
+        } else { // realistic or binned
+            const bool binned = s.profile == "binned";
+            for (int i = 0; i < length; i++) {
+                // 8 random bits per position
+                if ((i & 7) == 0) bits = rng.next();
+                const int spread = profile.spread[i];
+                int q = profile.mean[i] + (int) (((bits & 255) * (2 * spread + 1)) >> 8) - spread;
+                bits >>= 8;
+                q = min(41, max(2, q));
+                quality[i] = (char) ((binned ? binNovaSeq(q) : q) + s.shift);
+            }
+            // burst of N
+            if (rng.below(100) == 0) {
+                int burst = 1 + rng.below(8);
+                int start = rng.below(max(1, length - burst + 1));
+                for (int i = start; i < min(length, start + burst); i++) {
+                    sequence[i] = 'N';
+                    quality[i] = (char) (2 + s.shift);
+                }
+            }
+        }
+    }
+
+    // FASTQ records of chunk number chunk
+    string makeChunk(const Settings& s, const long long& chunk) {
+        Random rng(s.seed * 0x100000001b3ULL + chunk);
+        long long first = chunk * chunkSize;
+        long long last = min(s.reads, first + chunkSize);
+        Profile profile(s.maxLength);
+        string buffer, sequence, quality;
+        buffer.reserve((last - first) * (2 * s.maxLength + 32));
+        for (long long z = first; z < last; z++) {
+            int length = s.minLength + rng.below(s.maxLength - s.minLength + 1);
+            makeRead(s, profile, length, rng, sequence, quality);
+            buffer += '@';
+            buffer += s.profile;
+            buffer += '.';
+            buffer += to_string(z + 1);
+            buffer += '\n';
+            buffer += sequence;
+            buffer += "\n+\n";
+            buffer += quality;
+            buffer += '\n';
+        }
+        return buffer;
+    }
+
+    void generate(const string& outputfile, const Settings& s, const int& num_threads) {
+        if (find(profiles.begin(), profiles.end(), s.profile) == profiles.end()) {
+            throw runtime_error("unknown profile " + s.profile);
+        }
+        if (s.reads < 0 || s.minLength < 1 || s.minLength > s.maxLength) {
+            throw runtime_error("invalid number of reads or lengths");
+        }
+        const bool gzip = TrimmedOutput::endsWith(outputfile, ".gz");
+        ofstream out(outputfile, ios::out | ios::binary);
+        if (!out) {
+            throw runtime_error("cannot open " + outputfile);
+        }
+        const long long chunks = (s.reads + chunkSize - 1) / chunkSize;
+
+        // formatted chunks that wait for the chunks before them
+        map<long long, string> done;
+        mutex doneMutex;
+        atomic<long long> nextChunk(0), writtenChunks(0);
+        atomic<bool> failed(false);
+        vector<thread> threads(num_threads);
+        for (int th = 0; th < num_threads; th++) {
+            threads[th] = thread([&]() {
+                for (long long chunk = nextChunk++; chunk < chunks && !failed; chunk = nextChunk++) {
+                    // at most two chunks per thread wait for the writer
+                    while (!failed && chunk >= writtenChunks + 2 * num_threads) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                    string buffer = makeChunk(s, chunk);
+                    try {
+                        if (gzip) buffer = TrimmedOutput::gzipMember(buffer);
+                    } catch (runtime_error&) {
+                        failed = true;
+                    }
+                    lock_guard<mutex> lock(doneMutex);
+                    done[chunk].swap(buffer);
+                }
+            });
+        }
+
+        // write the chunks in order
+        for (long long chunk = 0; chunk < chunks && !failed; ) {
+            string buffer;
+            bool ready = false;
+            {
+                lock_guard<mutex> lock(doneMutex);
+                auto it = done.find(chunk);
+                if (it != done.end()) {
+                    buffer.swap(it->second);
+                    done.erase(it);
+                    ready = true;
+                }
+            }
+            if (!ready) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            out.write(buffer.data(), buffer.size());
+            if (!out) failed = true;
+            writtenChunks = ++chunk;
+        }
+        for (auto& t: threads) t.join();
+        if (failed) {
+            throw runtime_error("cannot write " + outputfile);
+        }
+    }
+
+}
+
+#endif
@@ -0,0 +1,371 @@
+/*******************************************************************************
+ *
+ * microBenchmarks.cpp
+ *
+ * DESCRIPTION: Micro benchmarks of the building blocks of the tools:
+ *              kernel/<problem>/<distribution>: the per read kernels of
+ *                  0-zeros, z-zeros, p-percent and m-mean (see Problems.h)
+ *                  on synthetic quality lines
+ *              kernel/<problem>/<distribution>/runtime: the same kernels
+ *                  of 0-zeros, p-percent and m-mean with the length at
+ *                  runtime (FixedLength = 0, see Criteria.h), to compare
+ *                  with the instantiations for the common read lengths
+ *                  uniform: all scores uniform in [2,41]
+ *                  high:    95% of the scores in [30,41], 5% in [2,15]
+ *                  decay:   scores fall from about 38 to 15 along the read
+ *                           (like the 3' end of Illumina reads)
+ *              prefix/triangle, prefix/column: cT -> c and cC -> c
+ *              reduction/<threads>: adding the counters of the worker threads
+ *              queue/<producers>x<consumers>: ConcurrentQueue push/pop of
+ *                  pointers with the given number of threads
+ *
+ *              Each benchmark runs once to warm up and then --repetitions
+ *              times. The table (and --json) gives the median, minimum and
+ *              the standard deviation of the time per item (read, pass, matrix
+ *              or queue element) and the items per second of the median.
+ *              With --baseline the medians are compared with a JSON file
+ *              written by --json before: benchmarks that are more than
+ *              --tolerance percent slower are marked and the exit code is 1.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <functional>
+#include <cmath>
+
+#include "tclap/CmdLine.h" // command line arguments
+#include "Problems.h"
+#include "ConcurrentQueue.h"
+#include "Stats.h"
+
+using namespace std;
+using namespace TCLAP;     // command line arguments
+using namespace ComputeMatrices;
+
+struct BenchmarkResult {
+    string         name;
+    string         unit;
+    long long      items;   // items per run
+    vector<double> seconds; // one entry per repetition
+    double         median, minimum, mean, stddev; // ns per item
+};
+
+// keeps the compiler from removing the benchmarked work
+volatile long long sink;
+
+BenchmarkResult runBenchmark(const string& name,
+                             const string& unit,
+                             const long long& items,
+                             const int& repetitions,
+                             function<void()> body)
+{
+    BenchmarkResult r;
+    r.name  = name;
+    r.unit  = unit;
+    r.items = items;
+    body(); // warm up
+    for (int k = 0; k < repetitions; k++) {
+        double start = Stats::wallSeconds();
+        body();
+        r.seconds.push_back(Stats::wallSeconds() - start);
+    }
+    vector<double> ns;
+    for (double s: r.seconds) ns.push_back(1e9 * s / items);
+    sort(ns.begin(), ns.end());
+    size_t n = ns.size();
+    r.median  = (n % 2) ? ns[n/2] : (ns[n/2-1] + ns[n/2]) / 2;
+    r.minimum = ns[0];
+    r.mean = 0;
+    for (double x: ns) r.mean += x;
+    r.mean /= n;
+    r.stddev = 0;
+    for (double x: ns) r.stddev += (x - r.mean) * (x - r.mean);
+    r.stddev = (n > 1) ? sqrt(r.stddev / (n-1)) : 0;
+    return r;
+}
+
+// synthetic quality lines, scores + shift as chars
+vector<string> makeReads(const string& distribution,
+                         const int& numberOfReads,
+                         const int& lengthOfSequence,
+                         const int& shift)
+{
+    mt19937 rng(42);
+    uniform_int_distribution<int> uniform(2, 41), high(30, 41), low(2, 15), noise(-8, 8);
+    uniform_real_distribution<double> coin(0, 1);
+    vector<string> reads(numberOfReads, string(lengthOfSequence, ' '));
+    for (auto& zeile: reads) {
+        for (int i = 0; i < lengthOfSequence; i++) {
+            int q;
+            if (distribution == "uniform") {
+                q = uniform(rng);
+            } else if (distribution == "high") {
+                q = (coin(rng) < 0.95) ? high(rng) : low(rng);
+            } else {
+                q = 38 - (23 * i) / max(1, lengthOfSequence-1) + noise(rng);
+            }
+            zeile[i] = (char) (min(41, max(2, q)) + shift);
+        }
+    }
+    return reads;
+}
+
+// benchmark name -> median of a JSON file written by writeJSON
+map<string, double> readBaseline(const string& baselinefile) {
+    ifstream in(baselinefile, ios::in);
+    if (!in) {
+        throw runtime_error("cannot open " + baselinefile);
+    }
+    map<string, double> medians;
+    string line;
+    while (getline(in, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t median = line.find("\"median_ns\": ");
+        if (name == string::npos || median == string::npos) continue;
+        name += 9;
+        medians[line.substr(name, line.find('"', name) - name)] = atof(line.c_str() + median + 13);
+    }
+    return medians;
+}
+
+void writeJSON(const string& jsonfile,
+               const vector<BenchmarkResult>& results,
+               const int& numberOfReads,
+               const int& lengthOfSequence,
+               const int& repetitions)
+{
+    ofstream out(jsonfile, ios::out);
+    if (!out) {
+        throw runtime_error("cannot open " + jsonfile);
+    }
+    out << "{\n";
+    out << "  \"reads\": " << numberOfReads << ",\n";
+    out << "  \"length\": " << lengthOfSequence << ",\n";
+    out << "  \"repetitions\": " << repetitions << ",\n";
+    out << "  \"benchmarks\": [";
+    for (size_t k = 0; k < results.size(); k++) {
+        const BenchmarkResult& r = results[k];
+        // one benchmark per line, see readBaseline
+        out << (k ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit << "\""
+            << ", \"items\": " << r.items
+            << ", \"median_ns\": " << r.median
+            << ", \"min_ns\": " << r.minimum
+            << ", \"mean_ns\": " << r.mean
+            << ", \"stddev_ns\": " << r.stddev
+            << ", \"per_s\": " << 1e9 / r.median << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char * argv[]) {
+
+    //START: processing command line options
+    int numberOfReads, lengthOfSequence, repetitions;
+    double tolerance;
+    string filter, jsonFile, baselineFile;
+    try{
+        CmdLine cmd("micro benchmarks of the kernels, prefix passes, reductions and the queue", ' ', "1.0", true);
+        ValueArg<int>    readsArg(     "r", "reads",       "number of synthetic reads per kernel run", false, 20000, "integer", cmd);
+        ValueArg<int>    lengthArg(    "l", "length",      "length of each read",                      false, 101,   "integer", cmd);
+        ValueArg<int>    repeatArg(    "n", "repetitions", "measured runs per benchmark",              false, 10,    "integer", cmd);
+        ValueArg<string> filterArg(    "f", "filter",      "only run benchmarks whose name contains this string", false, "", "string", cmd);
+        ValueArg<string> jsonArg(      "j", "json",        "write the results as JSON to this file",   false, "",    "string",  cmd);
+        ValueArg<string> baselineArg(  "b", "baseline",    "compare the medians with this JSON file",  false, "",    "string",  cmd);
+        ValueArg<double> toleranceArg( "t", "tolerance",   "percent a median may be slower than the baseline", false, 10.0, "double", cmd);
+        cmd.parse( argc, argv );
+        numberOfReads    = readsArg.getValue();
+        lengthOfSequence = lengthArg.getValue();
+        repetitions      = repeatArg.getValue();
+        filter           = filterArg.getValue();
+        jsonFile         = jsonArg.getValue();
+        baselineFile     = baselineArg.getValue();
+        tolerance        = toleranceArg.getValue();
+        if (numberOfReads < 1 || lengthOfSequence < 1 || repetitions < 1) {
+            throw ArgException("reads, length and repetitions must be positive", "reads");
+        }
+
+    } catch (ArgException &e) {
+        cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
+        return EXIT_FAILURE;
+    }
+    //END: processing command line options
+
+    const int shift = 33, threshold = 20, zeros = 3;
+    const double percent = 0.1, mean = 25;
+    const int L = lengthOfSequence;
+    vector<BenchmarkResult> results;
+    auto selected = [&](const string& name) {
+        return name.find(filter) != string::npos;
+    };
+    auto add = [&](const BenchmarkResult& r) {
+        results.push_back(r);
+        cout << left << setw(32) << r.name << right << fixed << setprecision(1)
+             << setw(12) << r.median << " ns/" << left << setw(7) << r.unit << right
+             << " min " << setw(10) << r.minimum
+             << " +-" << setw(5) << (r.median > 0 ? 100 * r.stddev / r.median : 0) << "%"
+             << setw(14) << setprecision(0) << 1e9 / r.median << " " << r.unit << "/s" << endl;
+    };
+
+    //START: per read kernels
+    vector<Problem> problems = {
+        zeroOneProblem(L, threshold, shift),
+        zerosAllowedProblem(L, zeros, threshold, shift),
+        percentZerosAllowedProblem(L, percent, threshold, shift),
+        meanProblem(L, mean, shift)
+    };
+    for (const string distribution: {"uniform", "high", "decay"}) {
+        vector<string> reads;
+        for (const auto& problem: problems) {
+            string name = "kernel/" + problem.name + "/" + distribution;
+            if (!selected(name)) continue;
+            if (reads.empty()) reads = makeReads(distribution, numberOfReads, L, shift);
+            Kernel kernel = problem.makeKernel();
+            RowCounters counters(L);
+            add(runBenchmark(name, "read", numberOfReads, repetitions, [&]() {
+                for (const auto& zeile: reads) {
+                    kernel(zeile, counters);
+                }
+                sink = counters.c[0][L-1] + counters.aux[0][L-1];
+            }));
+        }
+        vector<pair<string, Kernel> > runtimeKernels = {
+            {"0-zeros",   CriterionKernel()(ZeroOneCriterion<0>(L, threshold + shift))},
+            {"p-percent", CriterionKernel()(PercentCriterion<0>(L, percent, threshold + shift))},
+            {"m-mean",    CriterionKernel()(MeanCriterion<0>(L, shift + mean))}
+        };
+        for (auto& k: runtimeKernels) {
+            string name = "kernel/" + k.first + "/" + distribution + "/runtime";
+            if (!selected(name)) continue;
+            if (reads.empty()) reads = makeReads(distribution, numberOfReads, L, shift);
+            RowCounters counters(L);
+            add(runBenchmark(name, "read", numberOfReads, repetitions, [&]() {
+                for (const auto& zeile: reads) {
+                    k.second(zeile, counters);
+                }
+                sink = counters.c[0][L-1] + counters.aux[0][L-1];
+            }));
+        }
+    }
+    //END: per read kernels
+
+    //START: prefix passes
+    {
+        vector<vector<int> > aux (L, vector<int>(L,0));
+        mt19937 rng(42);
+        for (int i = 0; i < L; i++) {
+            for (int j = i; j < L; j++) {
+                aux[i][j] = rng() % 1000;
+            }
+        }
+        vector<vector<int> > c (L, vector<int>(L,0));
+        if (selected("prefix/triangle")) {
+            add(runBenchmark("prefix/triangle", "pass", 1, repetitions, [&]() {
+                addTriangleCounts(aux, c, L);
+                sink = c[0][L-1];
+            }));
+        }
+        if (selected("prefix/column")) {
+            add(runBenchmark("prefix/column", "pass", 1, repetitions, [&]() {
+                addColumnCounts(aux, c, L);
+                sink = c[0][L-1];
+            }));
+        }
+    }
+    //END: prefix passes
+
+    //START: reduction of the counters of the worker threads
+    for (int threads: {2, 4, 8}) {
+        string name = "reduction/" + to_string(threads);
+        if (!selected(name)) continue;
+        vector<RowCounters> perThread(threads, RowCounters(L));
+        RowCounters total(L);
+        add(runBenchmark(name, "matrix", threads, repetitions, [&]() {
+            total.clear();
+            for (const auto& counters: perThread) {
+                total.add(counters);
+            }
+            sink = total.c[0][L-1];
+        }));
+    }
+    //END: reduction of the counters of the worker threads
+
+    //START: queue under contention
+    for (int threads: {1, 2, 4}) {
+        string name = "queue/" + to_string(threads) + "x" + to_string(threads);
+        if (!selected(name)) continue;
+        const long long elements = 200000;
+        add(runBenchmark(name, "element", elements, repetitions, [&]() {
+            ConcurrentQueue<string*> q;
+            atomic<long long> popped(0);
+            string element;
+            vector<thread> workers;
+            for (int p = 0; p < threads; p++) {
+                workers.push_back(thread([&, p]() {
+                    for (long long k = p; k < elements; k += threads) {
+                        q.push(&element);
+                    }
+                }));
+            }
+            for (int k = 0; k < threads; k++) {
+                workers.push_back(thread([&]() {
+                    string* e = nullptr;
+                    while (popped.load() < elements) {
+                        if (q.tryPop(e)) {
+                            popped++;
+                        } else {
+                            std::this_thread::yield();
+                        }
+                    }
+                }));
+            }
+            for (auto& w: workers) w.join();
+            sink = popped.load();
+        }));
+    }
+    //END: queue under contention
+
+    //START: output and comparison with the baseline
+    try {
+        if (jsonFile != "") {
+            writeJSON(jsonFile, results, numberOfReads, lengthOfSequence, repetitions);
+        }
+        if (baselineFile != "") {
+            map<string, double> baseline = readBaseline(baselineFile);
+            int slower = 0;
+            cout << endl << "compared with " << baselineFile << " (tolerance " << tolerance << "%):" << endl;
+            for (const auto& r: results) {
+                auto it = baseline.find(r.name);
+                if (it == baseline.end() || it->second <= 0) continue;
+                double change = 100 * (r.median / it->second - 1);
+                bool regression = change > tolerance;
+                slower += regression;
+                cout << left << setw(32) << r.name << right << fixed << setprecision(1)
+                     << setw(8) << showpos << change << noshowpos << "%"
+                     << (regression ? "  SLOWER" : "") << endl;
+            }
+            if (slower > 0) {
+                cout << slower << " benchmark(s) slower than the baseline" << endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } catch (runtime_error &e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    //END: output and comparison with the baseline
+
+    return EXIT_SUCCESS;
+
+}
@@ -1,30 +1,70 @@
-#include <iostream>
-#include <fstream>
-#include <cstdlib>
+/*******************************************************************************
+ *
+ * randomFASTQ.cpp
+ *
+ * DESCRIPTION: Writes a synthetic FASTQ file, see SyntheticFASTQ.h for the
+ *              profiles. The file only depends on the seed, the profile, the
+ *              number of reads and the lengths (not on the number of threads).
+ *              If the name ends with ".gz" the file is gzip compressed.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
 
-// Ivo Hedtke
-// 24. April 2015
+#include <iostream>
+#include <string>
+#include <thread>
+#include <algorithm>
 
-// arg1: number or reads (lines)
-// arg2: length of reads (#cols)
+#include "tclap/CmdLine.h" // command line arguments
+#include "SyntheticFASTQ.h"
 
 using namespace std;
+using namespace TCLAP;     // command line arguments
 
-int main(int argc, const char * argv[]) {
-    int reads = atoi(argv[1]);
-    int length = atoi(argv[2]);
-    
-    ofstream myfile;
-    myfile.open ("random.fastq", ios::out);
-    
-    for (int row=0; row<reads; row++) {
-        myfile << "idline\n";
-        myfile << "CGAT\n";
-        myfile << "idline\n";
-        for (int col=0; col<length; col++) {
-            int ascii_index = 44 + (rand() % 30);
-            myfile << (char) ascii_index;
+int main(int argc, char * argv[]) {
+
+    //START: processing command line options
+    SyntheticFASTQ::Settings settings;
+    string outputFile;
+    int numThreads;
+    try{
+        CmdLine cmd("writes a synthetic FASTQ file", ' ', "2.0", true);
+        ValuesConstraint<string> profileConstraint(const_cast<vector<string>&>(SyntheticFASTQ::profiles));
+        ValueArg<int>       readsArg(    "r", "reads",       "number of reads",                        true,  0,   "integer", cmd);
+        ValueArg<int>       lengthArg(   "l", "length",      "(max.) length of each read",             true,  0,   "integer", cmd);
+        ValueArg<int>       minLengthArg("m", "minlength",   "min. length of each read (default: --length)", false, 0, "integer", cmd);
+        ValueArg<string>    profileArg(  "p", "profile",     "quality profile",                        false, "realistic", &profileConstraint, cmd);
+        ValueArg<int>       seedArg(     "S", "seed",        "seed of the random generator",           false, 42,  "integer", cmd);
+        ValueArg<int>       shiftArg(    "s", "shift",       "ASCII index of the quality 0",           false, 33,  "integer", cmd);
+        ValueArg<string>    outfileArg(  "o", "outfile",     "output file name (.gz: gzip)",           false, "random.fastq", "string", cmd);
+        ValueArg<int>       numThreadsArg("w", "workthreads","number of threads (default: all cores)", false, 0,   "integer", cmd);
+        cmd.parse( argc, argv );
+        settings.reads     = readsArg.getValue();
+        settings.maxLength = lengthArg.getValue();
+        settings.minLength = minLengthArg.isSet() ? minLengthArg.getValue() : settings.maxLength;
+        settings.profile   = profileArg.getValue();
+        settings.seed      = seedArg.getValue();
+        settings.shift     = shiftArg.getValue();
+        outputFile         = outfileArg.getValue();
+        numThreads         = numThreadsArg.getValue();
+        if (numThreads <= 0) {
+            numThreads = max(1u, std::thread::hardware_concurrency());
         }
-        myfile << "\n";
+
+    } catch (ArgException &e) {
+        cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
+        return EXIT_FAILURE;
     }
+    //END: processing command line options
+
+    try {
+        SyntheticFASTQ::generate(outputFile, settings, numThreads);
+    } catch (runtime_error &e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+
 }
@@ -0,0 +1,93 @@
+/*******************************************************************************
+ *
+ * convertToQualityStore.cpp
+ *
+ * DESCRIPTION: Given a FASTQ file with n reads of length l. Write a quality
+ *              store (see QualityStore.h) that holds only the quality lines,
+ *              optionally binned and bit-packed. All trimming tools accept
+ *              the quality store instead of the FASTQ file as --infile, so
+ *              repeated runs on the same data skip the parsing of header and
+ *              sequence lines. --check compares the store with the input at
+ *              every bin border (the thresholds with exact results).
+ *
+ * RUNTIME: O( n*l )
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#include <sstream>
+#include <stdexcept>
+
+#include "tclap/CmdLine.h" // command line arguments
+#include "QualityStore.h"  // binary quality file format
+
+using namespace std;
+using namespace TCLAP;        // command line arguments
+using namespace QualityStore; // binary quality file format
+
+int main(int argc, char * argv[]) {
+
+    //START: processing command line options
+    int numberOfSequences, lengthOfSequence, shift;
+    string inputFile, outputFile;
+    vector<int> bins;
+    bool check;
+
+    try{
+
+        // read command line parameters
+        CmdLine cmd("convert a FASTQ file into a bit-packed quality store", ' ', "1.2", true);
+        ValueArg<int>    rowsArg(   "r", "reads",   "number of reads",                                     true,  0,  "integer", cmd);
+        ValueArg<int>    lengthArg( "l", "length",  "length of each read",                                 true,  0,  "integer", cmd);
+        ValueArg<string> infileArg( "i", "infile",  "input file name (FASTQ format)",                      true,  "", "string",  cmd);
+        ValueArg<string> outfileArg("o", "outfile", "output file name (quality store)",                    true,  "", "string",  cmd);
+        ValueArg<int>    shiftArg(  "s", "shift",   "shift for char -> quality conversion",                true,  -1, "integer", cmd);
+        ValueArg<string> binsArg(   "b", "bins",    "ascending bin borders, e.g. 2,10,20,25,30,35,40",     false, "", "string",  cmd);
+        SwitchArg        checkArg(  "c", "check",   "compare the store with the input at every bin border", cmd, false);
+
+        cmd.parse( argc, argv );
+        numberOfSequences = rowsArg.getValue();
+        lengthOfSequence  = lengthArg.getValue();
+        inputFile         = infileArg.getValue();
+        outputFile        = outfileArg.getValue();
+        shift             = shiftArg.getValue();
+        check             = checkArg.getValue();
+
+        stringstream binList(binsArg.getValue());
+        string bin;
+        while (getline(binList, bin, ',')) {
+            size_t end = 0;
+            try {
+                bins.push_back(stoi(bin, &end));
+            } catch (logic_error&) {// invalid_argument, out_of_range
+                end = 0;
+            }
+            if (end == 0 || end != bin.size()) {
+                throw ArgException("\"" + bin + "\" is not an integer bin border", "bins");
+            }
+            if (bins.size() > 1 && bins[bins.size()-2] >= bins.back()) {
+                throw ArgException("bin borders must be ascending", "bins");
+            }
+        }
+
+    } catch (ArgException &e) {
+        cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
+        return EXIT_FAILURE;
+    }
+    //END: processing command line options
+
+    try{
+        convertFASTQ(inputFile, outputFile, numberOfSequences, lengthOfSequence, shift, bins);
+        if (check) {
+            checkBins(inputFile, outputFile, bins);
+            cout << "check: " << outputFile << " and " << inputFile << " agree at every bin border" << endl;
+        }
+    } catch (runtime_error &e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+
+}
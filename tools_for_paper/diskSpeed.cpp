@@ -1,54 +1,340 @@
+/*******************************************************************************
+ *
+ * diskSpeed.cpp
+ *
+ * DESCRIPTION: I/O probe: reads the same FASTQ file with several backends and
+ *              reports GB/s and records/s of each, as the baseline of what a
+ *              reader of the tools can achieve on this storage.
+ *              ifstream: in.ignore for the first three lines of a record and
+ *                        getline for the quality line (the original diskSpeed)
+ *              read:     read() into a buffer of --buffer MB
+ *                        (POSIX_FADV_SEQUENTIAL)
+ *              mmap:     the whole file mapped with MADV_SEQUENTIAL
+ *              direct:   O_DIRECT with a buffer aligned to 4096 bytes (bypasses
+ *                        the page cache, not supported by every file system)
+ *              io_uring: --depth reads of --buffer MB in flight (IoUring.h),
+ *                        only if the kernel supports io_uring
+ *
+ *              Every backend does the same easy work with the data: it counts
+ *              the records (4 lines) and sums (sum of the chars of the quality
+ *              line) % 10 over all reads. The checksum must be the same for
+ *              all backends. With --cold the pages of the file are evicted
+ *              (posix_fadvise(POSIX_FADV_DONTNEED)) before each run. Each
+ *              backend is run --repeats times, the median is reported.
+ *              Backends that are not available are reported as unavailable
+ *              with the reason.
+ *
+ *              --reads and --length are optional and only kept for old
+ *              scripts: with --reads only the first reads of the file are
+ *              read by the ifstream backend.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
 #include <vector>
 #include <string>
 #include <fstream>
 #include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 #include "tclap/CmdLine.h" // command line arguments
+#include "Stats.h"         // wallSeconds
+#include "IoUring.h"
 
 using namespace std;
 using namespace TCLAP;     // command line arguments
 
+// result of one read of the file
+struct Pass {
+    unsigned long long bytes   = 0;
+    unsigned long long records = 0;
+    unsigned long long sum     = 0;
+};
+
+// the easy work on the blocks of a file: records and checksum
+class Scanner {
+public:
+    // the next bytes of the file
+    void scan(const char* p, const size_t& n) {
+        const char* end = p + n;
+        pass.bytes += n;
+        while (p < end) {
+            const char* nl = (const char*) memchr(p, '\n', end - p);
+            const char* stop = nl ? nl : end;
+            if (line == 3) {
+                for (; p < stop; p++) rowSum += (unsigned char) *p;
+            }
+            if (!nl) return;
+            if (line == 3) endRecord();
+            else line++;
+            p = nl + 1;
+        }
+    }
+    // end of the file, the last line may have no '\n'
+    Pass finish() {
+        if (line == 3 && rowSum > 0) endRecord();
+        return pass;
+    }
+private:
+    void endRecord() {
+        pass.sum += rowSum % 10;
+        pass.records++;
+        rowSum = 0;
+        line = 0;
+    }
+    Pass pass;
+    int  line   = 0;
+    int  rowSum = 0;
+};
+
+// file descriptor that is closed at the end of the scope
+struct File {
+    int fd;
+    File(const string& filename, const int& flags) : fd(open(filename.c_str(), flags)) {
+        if (fd < 0) throw runtime_error(filename + ": " + strerror(errno));
+    }
+    ~File() { close(fd); }
+    unsigned long long size() const {
+        struct stat st;
+        if (fstat(fd, &st) != 0) throw runtime_error(strerror(errno));
+        return st.st_size;
+    }
+};
+
+//START: backends
+Pass readIfstream(const string& inputFile, const int& numberOfSequences) {
+    ifstream in(inputFile, ios::in);
+    if (!in) throw runtime_error("cannot open " + inputFile);
+    string zeile;
+    Pass pass;
+    int row_sum;
+    for (int z = 0; numberOfSequences == 0 || z < numberOfSequences; z++) {
+        in.ignore(numeric_limits<streamsize>::max(), '\n');
+        in.ignore(numeric_limits<streamsize>::max(), '\n');
+        in.ignore(numeric_limits<streamsize>::max(), '\n');
+        if (!getline(in,zeile)) break;
+        // do something very easy with the row
+        row_sum = 0;
+        for (char c: zeile) {
+            row_sum += (unsigned char) c;
+        }
+        pass.sum += (row_sum % 10);
+        pass.records++;
+    }
+    in.clear();
+    pass.bytes = in.tellg();
+    return pass;
+}
+
+Pass readRead(const string& inputFile, const size_t& bufferSize) {
+    File file(inputFile, O_RDONLY);
+    posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    vector<char> buffer(bufferSize);
+    Scanner scanner;
+    ssize_t n;
+    while ((n = read(file.fd, buffer.data(), bufferSize)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw runtime_error(string("read: ") + strerror(errno));
+        }
+        scanner.scan(buffer.data(), n);
+    }
+    return scanner.finish();
+}
+
+Pass readMmap(const string& inputFile) {
+    File file(inputFile, O_RDONLY);
+    const unsigned long long size = file.size();
+    Scanner scanner;
+    if (size == 0) return scanner.finish();
+    void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+    if (data == MAP_FAILED) throw runtime_error(string("mmap: ") + strerror(errno));
+    madvise(data, size, MADV_SEQUENTIAL);
+    scanner.scan((const char*) data, size);
+    munmap(data, size);
+    return scanner.finish();
+}
+
+Pass readDirect(const string& inputFile, const size_t& bufferSize) {
+    File file(inputFile, O_RDONLY | O_DIRECT);
+    char* buffer;
+    if (posix_memalign((void**) &buffer, 4096, bufferSize) != 0) {
+        throw runtime_error("cannot allocate the aligned buffer");
+    }
+    Scanner scanner;
+    ssize_t n;
+    while ((n = read(file.fd, buffer, bufferSize)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buffer);
+            throw runtime_error(string("O_DIRECT read: ") + strerror(errno));
+        }
+        scanner.scan(buffer, n);
+    }
+    free(buffer);
+    return scanner.finish();
+}
+
+Pass readIoUring(const string& inputFile, const size_t& bufferSize, const int& depth) {
+    if (!IoUring::available()) throw runtime_error("io_uring is not supported by the kernel");
+    File file(inputFile, O_RDONLY);
+    IoUring::SequentialReader reader(file.fd, file.size(), bufferSize, depth);
+    Scanner scanner;
+    const char* data;
+    size_t n;
+    while ((n = reader.next(data)) != 0) {
+        scanner.scan(data, n);
+    }
+    return scanner.finish();
+}
+//END: backends
+
+vector<string> split(const string& list) {
+    vector<string> items;
+    stringstream ss(list);
+    string item;
+    while (getline(ss, item, ',')) {
+        if (item != "") items.push_back(item);
+    }
+    return items;
+}
+
+struct Result {
+    string backend;
+    string reason;      // "" if the backend is available
+    double seconds = 0; // median
+    Pass   pass;
+};
+
 int main(int argc, char * argv[]) {
-    
+
     //processing command line options
-    int numberOfSequences, lengthOfSequence;
-    string inputFile;
+    int numberOfSequences, repeats, depth;
+    size_t bufferSize;
+    bool cold;
+    string inputFile, jsonFile;
+    vector<string> backends;
     try{
-        CmdLine cmd("trim with z allowed low quality nucleotides per row", ' ', "1.0", true);
-        ValueArg<int>    rowsArg(   "r", "reads",  "number of reads",     true,  0,  "integer", cmd);
-        ValueArg<int>    lengthArg( "l", "length", "length of each read", true,  0,  "integer", cmd);
-        ValueArg<string> infileArg ("i", "infile", "input file name",     true,  "", "string",  cmd);
+        CmdLine cmd("read a FASTQ file with several I/O backends", ' ', "1.0", true);
+        ValueArg<int>    rowsArg(    "r", "reads",    "only for the ifstream backend: number of reads to read", false, 0,  "integer", cmd);
+        ValueArg<int>    lengthArg(  "l", "length",   "ignored (old scripts)",  false, 0,  "integer", cmd);
+        ValueArg<string> infileArg(  "i", "infile",   "input file name",        true,  "", "string",  cmd);
+        ValueArg<string> backendsArg("b", "backends", "comma separated: ifstream,read,mmap,direct,io_uring", false, "ifstream,read,mmap,direct,io_uring", "list", cmd);
+        ValueArg<int>    bufferArg(  "B", "buffer",   "buffer size of read, direct and io_uring in MB", false, 4, "integer", cmd);
+        ValueArg<int>    depthArg(   "q", "depth",    "reads in flight for io_uring", false, 8, "integer", cmd);
+        SwitchArg        coldArg(    "c", "cold",     "evict the pages of the file before each run", cmd, false);
+        ValueArg<int>    repeatsArg( "n", "repeats",  "runs per backend",       false, 1,  "integer", cmd);
+        ValueArg<string> jsonArg(    "j", "json",     "write the results as JSON to this file", false, "", "string", cmd);
         cmd.parse( argc, argv );
         numberOfSequences = rowsArg.getValue();
-        lengthOfSequence  = lengthArg.getValue();
         inputFile         = infileArg.getValue();
-        
+        backends          = split(backendsArg.getValue());
+        bufferSize        = (size_t) bufferArg.getValue() << 20;
+        depth             = depthArg.getValue();
+        cold              = coldArg.getValue();
+        repeats           = repeatsArg.getValue();
+        jsonFile          = jsonArg.getValue();
+        for (const auto& b: backends) {
+            if (b != "ifstream" && b != "read" && b != "mmap" && b != "direct" && b != "io_uring") {
+                throw ArgException("unknown backend " + b, "backends");
+            }
+        }
+        if (bufferArg.getValue() < 1 || bufferArg.getValue() > 1024) {
+            throw ArgException("must be in [1,1024]", "buffer");
+        }
+        if (depth < 1 || depth > 256) {
+            throw ArgException("must be in [1,256]", "depth");
+        }
+        if (repeats < 1) {
+            throw ArgException("must be at least 1", "repeats");
+        }
     } catch (ArgException &e) {
         cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
         return EXIT_FAILURE;
     }
-    
-    // open file
-    ifstream in(inputFile, ios::in);
-    string zeile;
-    
-    // do something very easy with the file
-    unsigned long long int sum = 0;
-    int row_sum;
-    for (int z = 0; z < numberOfSequences; z++) {
-        in.ignore(numeric_limits<streamsize>::max(), '\n');
-        in.ignore(numeric_limits<streamsize>::max(), '\n');
-        in.ignore(numeric_limits<streamsize>::max(), '\n');
-        getline(in,zeile);
-        // do something very easy with the row
-        row_sum = 0;
-        for (int i=0; i<lengthOfSequence; i++) {
-            row_sum += zeile[i];
+
+    //START: measure the backends
+    vector<Result> results;
+    for (const auto& backend: backends) {
+        Result result;
+        result.backend = backend;
+        vector<double> seconds;
+        try {
+            for (int k = 0; k < repeats; k++) {
+                if (cold) {
+                    File file(inputFile, O_RDONLY);
+                    posix_fadvise(file.fd, 0, 0, POSIX_FADV_DONTNEED);
+                }
+                double start = Stats::wallSeconds();
+                if (backend == "ifstream")      result.pass = readIfstream(inputFile, numberOfSequences);
+                else if (backend == "read")     result.pass = readRead(inputFile, bufferSize);
+                else if (backend == "mmap")     result.pass = readMmap(inputFile);
+                else if (backend == "direct")   result.pass = readDirect(inputFile, bufferSize);
+                else                            result.pass = readIoUring(inputFile, bufferSize, depth);
+                seconds.push_back(Stats::wallSeconds() - start);
+            }
+            sort(seconds.begin(), seconds.end());
+            result.seconds = seconds[seconds.size() / 2];
+        } catch (runtime_error& e) {
+            result.reason = e.what();
         }
-        sum += (row_sum % 10);
+        results.push_back(result);
     }
-    
-    cout << sum << endl;
-    
+    //END: measure the backends
+
+    //START: output
+    cout << left << setw(10) << "backend" << right << setw(10) << "seconds" << setw(10) << "GB/s"
+         << setw(14) << "records/s" << setw(14) << "records" << setw(12) << "checksum" << endl;
+    cout << fixed;
+    for (const auto& r: results) {
+        cout << left << setw(10) << r.backend << right;
+        if (r.reason != "") {
+            cout << "  unavailable: " << r.reason << endl;
+            continue;
+        }
+        cout << setw(10) << setprecision(3) << r.seconds
+             << setw(10) << setprecision(2) << r.pass.bytes / r.seconds / 1e9
+             << setw(14) << setprecision(0) << r.pass.records / r.seconds
+             << setw(14) << r.pass.records << setw(12) << r.pass.sum << endl;
+    }
+    if (jsonFile != "") {
+        ofstream json(jsonFile);
+        if (!json) {
+            cerr << "ERROR: cannot write " << jsonFile << endl;
+            return EXIT_FAILURE;
+        }
+        json << "{\"file\": \"" << inputFile << "\", \"cold\": " << (cold ? "true" : "false")
+             << ", \"buffer_mb\": " << (bufferSize >> 20) << ", \"depth\": " << depth
+             << ", \"repeats\": " << repeats << ", \"backends\": [";
+        for (size_t k = 0; k < results.size(); k++) {
+            const Result& r = results[k];
+            json << (k ? ",\n" : "\n") << "  {\"backend\": \"" << r.backend << "\", ";
+            if (r.reason != "") {
+                json << "\"status\": \"unavailable\", \"reason\": \"" << r.reason << "\"}";
+                continue;
+            }
+            json << "\"status\": \"ok\", \"seconds\": " << setprecision(6) << r.seconds
+                 << ", \"bytes\": " << r.pass.bytes << ", \"records\": " << r.pass.records
+                 << ", \"gb_per_s\": " << r.pass.bytes / r.seconds / 1e9
+                 << ", \"records_per_s\": " << (long long) (r.pass.records / r.seconds)
+                 << ", \"checksum\": " << r.pass.sum << "}";
+        }
+        json << "\n]}" << endl;
+    }
+    //END: output
+
     return EXIT_SUCCESS;
-    
+
 }
@@ -0,0 +1,528 @@
+/*******************************************************************************
+ *
+ * runtimes.cpp
+ *
+ * DESCRIPTION: End-to-end benchmark of the four tools (replaces runtimes.rb).
+ *              For every data set, problem, parameter, engine, number of
+ *              threads and cache mode the tool is run --repeats times and
+ *              the wall, user and system time of the child process are
+ *              measured (no `time`, no shell). diskSpeed (backend ifstream)
+ *              is run on every data set in the same cache mode as the
+ *              baseline of a plain read of the file.
+ *
+ *              data sets: --datasets file with lines
+ *                             "<FASTQ file> <reads> <length> <shift>"
+ *                         and/or --generate "<reads>x<length>" (repeatable)
+ *                         to write synthetic FASTQ files of --profile (see
+ *                         benchmark_tools/SyntheticFASTQ.h, shift 33) to
+ *                         --workdir
+ *              engines:   sequential (no -w), parallel (-w <threads>) for
+ *                         z-zeros, p-percent and m-mean, bitmap (-c -w
+ *                         <threads>) for 0-zeros, z-zeros and p-percent. The
+ *                         bitmap cache is removed and created again by an
+ *                         untimed run first.
+ *              cache:     warm: one untimed run before the timed runs
+ *                         cold: before each run the page cache is dropped
+ *                               (sync; /proc/sys/vm/drop_caches, needs root)
+ *                               or, if that is not permitted, the pages of
+ *                               the input file are evicted with
+ *                               posix_fadvise(POSIX_FADV_DONTNEED)
+ *
+ *              The CSV (--csv) has one line per configuration with the
+ *              median of the repeats, the throughput relative to diskSpeed
+ *              (tool MB/s / diskSpeed MB/s) and for parallel engines the
+ *              speedup over the sequential engine and the scaling efficiency
+ *              (speedup over the smallest thread count / thread ratio).
+ *              --json writes the same data and every single run.
+ *
+ *              The result printed by every configuration must be the same
+ *              for all engines, threads and cache modes, for the run that
+ *              creates the bitmap cache and the runs that read it (and for
+ *              z-zeros with z=0 the same as for 0-zeros), otherwise runtimes
+ *              stops with an error.
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "tclap/CmdLine.h" // command line arguments
+#include "Stats.h"
+#include "ZeroOneBitmap.h"
+#include "benchmark_tools/SyntheticFASTQ.h"
+
+using namespace std;
+using namespace TCLAP;     // command line arguments
+
+extern char **environ;
+
+struct Dataset {
+    string file;
+    long long reads;
+    int length;
+    int shift;
+};
+
+struct Run {
+    double wall, user, sys;
+};
+
+// one line of the CSV: a tool run with fixed arguments
+struct Configuration {
+    string      dataset;
+    string      problem;   // 0-zeros, z-zeros, p-percent, m-mean or disk
+    string      parameter; // e.g. "t=25 z=5"
+    string      engine;    // sequential, parallel, bitmap or diskSpeed
+    int         threads;   // worker threads, 0 = sequential
+    string      cache;     // warm, cold, cold-fadvise
+    vector<Run> runs;
+    double      median;    // wall time
+    long long   reads;
+    long long   bytes;
+};
+
+vector<string> splitList(const string& list) {
+    vector<string> items;
+    stringstream in(list);
+    string item;
+    while (getline(in, item, ',')) {
+        if (item != "") items.push_back(item);
+    }
+    return items;
+}
+
+vector<Dataset> readDatasets(const string& listfile) {
+    ifstream in(listfile, ios::in);
+    if (!in) {
+        throw runtime_error("cannot open " + listfile);
+    }
+    vector<Dataset> datasets;
+    string line;
+    while (getline(in, line)) {
+        stringstream fields(line);
+        Dataset d;
+        if (!(fields >> d.file) || d.file[0] == '#') {
+            continue; // empty line or comment
+        }
+        if (!(fields >> d.reads >> d.length >> d.shift)) {
+            throw runtime_error("expected \"<file> <reads> <length> <shift>\" in " + listfile + ": " + line);
+        }
+        datasets.push_back(d);
+    }
+    return datasets;
+}
+
+// synthetic FASTQ of the profile, generated only once per size and profile
+Dataset generateDataset(const string& spec, const string& profile, const string& workdir) {
+    Dataset d;
+    size_t x = spec.find('x');
+    if (x == string::npos) {
+        throw runtime_error("expected \"<reads>x<length>\" for --generate: " + spec);
+    }
+    d.reads  = atoll(spec.substr(0, x).c_str());
+    d.length = atoi(spec.substr(x+1).c_str());
+    d.shift  = 33;
+    d.file   = workdir + "/synthetic_" + profile + "_" + spec + ".fastq";
+    if (d.reads <= 0 || d.length <= 0) {
+        throw runtime_error("invalid size for --generate: " + spec);
+    }
+    struct stat st;
+    if (stat(d.file.c_str(), &st) == 0) {
+        return d; // generated before
+    }
+    cerr << "generating " << d.file << endl;
+    SyntheticFASTQ::Settings settings;
+    settings.reads     = d.reads;
+    settings.minLength = d.length;
+    settings.maxLength = d.length;
+    settings.profile   = profile;
+    settings.seed      = 42;
+    settings.shift     = d.shift;
+    SyntheticFASTQ::generate(d.file, settings, max(1u, std::thread::hardware_concurrency()));
+    return d;
+}
+
+// returns the cache mode that was used: cold or cold-fadvise
+string dropCache(const string& inputfile) {
+    sync();
+    ofstream dropCaches("/proc/sys/vm/drop_caches", ios::out);
+    if (dropCaches && (dropCaches << "3" << endl)) {
+        return "cold";
+    }
+    int fd = open(inputfile.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        close(fd);
+    }
+    return "cold-fadvise";
+}
+
+// runs a program without shell, output to /dev/null or outputfile
+Run runProgram(const vector<string>& args, const string& outputfile = "/dev/null") {
+    vector<char*> argv;
+    for (const auto& a: args) argv.push_back(const_cast<char*>(a.c_str()));
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, 1, outputfile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+    Run r;
+    pid_t pid;
+    double start = Stats::wallSeconds();
+    if (posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ) != 0) {
+        posix_spawn_file_actions_destroy(&actions);
+        throw runtime_error("cannot run " + args[0]);
+    }
+    posix_spawn_file_actions_destroy(&actions);
+    int status;
+    struct rusage usage;
+    if (wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        string command;
+        for (const auto& a: args) command += a + " ";
+        throw runtime_error("failed: " + command);
+    }
+    r.wall = Stats::wallSeconds() - start;
+    r.user = usage.ru_utime.tv_sec + 1e-6 * usage.ru_utime.tv_usec;
+    r.sys  = usage.ru_stime.tv_sec + 1e-6 * usage.ru_stime.tv_usec;
+    return r;
+}
+
+string readFile(const string& file) {
+    ifstream in(file, ios::in | ios::binary);
+    stringstream content;
+    content << in.rdbuf();
+    return content.str();
+}
+
+double medianWall(const vector<Run>& runs) {
+    vector<double> w;
+    for (const auto& r: runs) w.push_back(r.wall);
+    sort(w.begin(), w.end());
+    size_t n = w.size();
+    return (n % 2) ? w[n/2] : (w[n/2-1] + w[n/2]) / 2;
+}
+
+int main(int argc, char * argv[]) {
+
+    //START: processing command line options
+    string datasetsFile, profile, workdir, bindir, csvFile, jsonFile;
+    vector<string> generate, problems, engines, threadList, cacheModes, thresholds, zerosList, percents, means;
+    int repeats;
+    bool dryRun;
+    try{
+        CmdLine cmd("end-to-end runtimes of the tools for all engines, threads and parameters", ' ', "1.0", true);
+        ValueArg<string>      datasetsArg(  "d", "datasets",   "file with lines \"<FASTQ file> <reads> <length> <shift>\"", false, "", "string", cmd);
+        MultiArg<string>      generateArg(  "g", "generate",   "generate a synthetic data set \"<reads>x<length>\"", false, "string", cmd);
+        ValueArg<string>      profileArg(   "q", "profile",    "quality profile of generated data sets", false, "realistic", "string", cmd);
+        ValueArg<string>      workdirArg(   "D", "workdir",    "directory for generated data sets",   false, ".",  "string", cmd);
+        ValueArg<string>      bindirArg(    "B", "bindir",     "directory of the tools (default: ../ of this program)", false, "", "string", cmd);
+        ValueArg<string>      problemsArg(  "P", "problems",   "comma separated: 0-zeros,z-zeros,p-percent,m-mean", false, "0-zeros,z-zeros,p-percent,m-mean", "list", cmd);
+        ValueArg<string>      enginesArg(   "e", "engines",    "comma separated: sequential,parallel,bitmap", false, "sequential,parallel,bitmap", "list", cmd);
+        ValueArg<string>      threadsArg(   "w", "workthreads","comma separated numbers of worker threads", false, "1,2,4,8", "list", cmd);
+        ValueArg<string>      cacheArg(     "c", "cache",      "comma separated: warm,cold",          false, "warm,cold", "list", cmd);
+        ValueArg<string>      thresholdArg( "t", "thresholds", "thresholds for 0-zeros, z-zeros, p-percent", false, "25,30", "list", cmd);
+        ValueArg<string>      zerosArg(     "z", "zeros",      "allowed zeros for z-zeros",           false, "0,5,10", "list", cmd);
+        ValueArg<string>      percentArg(   "p", "percents",   "allowed percent of zeros for p-percent", false, "0.1", "list", cmd);
+        ValueArg<string>      meanArg(      "m", "means",      "min. means for m-mean",               false, "25,30,35", "list", cmd);
+        ValueArg<int>         repeatsArg(   "n", "repeats",    "timed runs per configuration",        false, 3,   "integer", cmd);
+        ValueArg<string>      csvArg(       "o", "csv",        "write the medians as CSV to this file (default: stdout)", false, "", "string", cmd);
+        ValueArg<string>      jsonArg(      "j", "json",       "write all runs as JSON to this file", false, "",  "string", cmd);
+        SwitchArg             dryRunArg(    "x", "dryrun",     "only print the commands",            cmd, false);
+        cmd.parse( argc, argv );
+        datasetsFile = datasetsArg.getValue();
+        generate     = generateArg.getValue();
+        profile      = profileArg.getValue();
+        workdir      = workdirArg.getValue();
+        bindir       = bindirArg.getValue();
+        problems     = splitList(problemsArg.getValue());
+        engines      = splitList(enginesArg.getValue());
+        threadList   = splitList(threadsArg.getValue());
+        cacheModes   = splitList(cacheArg.getValue());
+        thresholds   = splitList(thresholdArg.getValue());
+        zerosList    = splitList(zerosArg.getValue());
+        percents     = splitList(percentArg.getValue());
+        means        = splitList(meanArg.getValue());
+        repeats      = repeatsArg.getValue();
+        csvFile      = csvArg.getValue();
+        jsonFile     = jsonArg.getValue();
+        dryRun       = dryRunArg.getValue();
+        if (!datasetsArg.isSet() && generate.empty()) {
+            throw ArgException("use --datasets and/or --generate", "datasets");
+        }
+        if (repeats < 1) {
+            throw ArgException("at least one repeat is needed", "repeats");
+        }
+        if (bindir == "") {
+            string self = argv[0];
+            size_t slash = self.rfind('/');
+            bindir = (slash == string::npos ? "." : self.substr(0, slash)) + "/..";
+        }
+
+    } catch (ArgException &e) {
+        cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
+        return EXIT_FAILURE;
+    }
+    //END: processing command line options
+
+    vector<Configuration> results;
+    try {
+        vector<Dataset> datasets;
+        if (datasetsFile != "") {
+            datasets = readDatasets(datasetsFile);
+        }
+        for (const auto& spec: generate) {
+            datasets.push_back(generateDataset(spec, profile, workdir));
+        }
+
+        const map<string, string> tools = {
+            {"0-zeros",   "trimZeroOne"},
+            {"z-zeros",   "trimZeroOneZerosAllowed"},
+            {"p-percent", "trimZeroOnePercentZerosAllowed"},
+            {"m-mean",    "trimIntegerMean"}
+        };
+
+        // output of the first run of each data set, problem and parameter;
+        // all engines, threads and cache modes must print the same result
+        map<string, string> expected;
+        const string output = workdir + "/runtimes_output.txt";
+        auto checkOutput = [&](const Dataset& d, const string& problem, const string& parameter,
+                               const string& engine, const int& threads) {
+            // z-zeros with z=0 is the same problem as 0-zeros
+            string p = problem, q = parameter;
+            if (p == "z-zeros" && q.size() > 4 && q.compare(q.size()-4, 4, " z=0") == 0) {
+                p = "0-zeros";
+                q = q.substr(0, q.size()-4);
+            }
+            string result = readFile(output);
+            auto it = expected.emplace(d.file + "|" + p + "|" + q, result).first;
+            if (it->second != result) {
+                throw runtime_error("different result for " + problem + " " + parameter + " " + engine
+                                    + " w=" + to_string(threads) + " on " + d.file);
+            }
+        };
+
+        //START: one configuration: repeated runs in one cache mode
+        auto measure = [&](const Dataset& d, const string& problem, const string& parameter,
+                           const string& engine, const int& threads, const string& cacheMode,
+                           const vector<string>& args) {
+            Configuration c;
+            c.dataset   = d.file;
+            c.problem   = problem;
+            c.parameter = parameter;
+            c.engine    = engine;
+            c.threads   = threads;
+            c.cache     = cacheMode;
+            c.reads     = d.reads;
+            struct stat st;
+            c.bytes     = (stat(d.file.c_str(), &st) == 0) ? st.st_size : 0;
+            if (dryRun) {
+                for (const auto& a: args) cout << a << " ";
+                cout << " # " << cacheMode << endl;
+                return;
+            }
+            if (cacheMode == "warm") {
+                runProgram(args, output); // fills the page cache
+            }
+            for (int k = 0; k < repeats; k++) {
+                if (cacheMode != "warm") {
+                    c.cache = dropCache(d.file);
+                }
+                c.runs.push_back(runProgram(args, (k == 0 && cacheMode != "warm") ? output : "/dev/null"));
+            }
+            if (problem != "disk") {
+                checkOutput(d, problem, parameter, engine, threads);
+            }
+            c.median = medianWall(c.runs);
+            cerr << problem << " " << parameter << " " << engine << " w=" << threads << " "
+                 << c.cache << " " << d.file << ": " << c.median << " s" << endl;
+            results.push_back(c);
+        };
+        //END: one configuration: repeated runs in one cache mode
+
+        for (const auto& d: datasets) {
+            vector<string> common = {"-i", d.file, "-r", to_string(d.reads),
+                                     "-l", to_string(d.length), "-s", to_string(d.shift)};
+            for (const auto& cacheMode: cacheModes) {
+                // baseline: plain read of the file
+                measure(d, "disk", "", "diskSpeed", 0, cacheMode,
+                        {bindir + "/tools_for_paper/diskSpeed", "-i", d.file, "-b", "ifstream"});
+
+                for (const auto& problem: problems) {
+                    if (tools.find(problem) == tools.end()) {
+                        throw runtime_error("unknown problem " + problem);
+                    }
+                    // all parameter combinations of the problem
+                    vector<pair<string, vector<string> > > parameters;
+                    if (problem == "m-mean") {
+                        for (const auto& m: means) parameters.push_back({"m=" + m, {"-m", m}});
+                    } else {
+                        for (const auto& t: thresholds) {
+                            if (problem == "0-zeros") {
+                                parameters.push_back({"t=" + t, {"-t", t}});
+                            }
+                            if (problem == "z-zeros") {
+                                for (const auto& z: zerosList) {
+                                    parameters.push_back({"t=" + t + " z=" + z, {"-t", t, "-z", z}});
+                                }
+                            }
+                            if (problem == "p-percent") {
+                                for (const auto& p: percents) {
+                                    parameters.push_back({"t=" + t + " p=" + p, {"-t", t, "-p", p}});
+                                }
+                            }
+                        }
+                    }
+
+                    for (const auto& parameter: parameters) {
+                        vector<string> args = {bindir + "/" + tools.at(problem)};
+                        args.insert(args.end(), common.begin(), common.end());
+                        args.insert(args.end(), parameter.second.begin(), parameter.second.end());
+                        for (const auto& engine: engines) {
+                            if (engine == "sequential") {
+                                measure(d, problem, parameter.first, engine, 0, cacheMode, args);
+                                continue;
+                            }
+                            if ((engine == "parallel" && problem == "0-zeros")
+                                || (engine == "bitmap" && problem == "m-mean")) {
+                                continue; // not available for this problem
+                            }
+                            if (engine != "parallel" && engine != "bitmap") {
+                                throw runtime_error("unknown engine " + engine);
+                            }
+                            vector<string> engineArgs = args;
+                            if (engine == "bitmap") {
+                                engineArgs.push_back("-c");
+                                if (!dryRun) {
+                                    // creates the bitmap cache, the timed runs read it
+                                    unlink(ZeroOneBitmap::bitmapFileName(d.file, atoi(parameter.second[1].c_str()),
+                                                                         d.shift).c_str());
+                                    runProgram(engineArgs, output);
+                                    checkOutput(d, problem, parameter.first, "bitmap (new cache)", 0);
+                                }
+                            }
+                            for (const auto& threads: threadList) {
+                                vector<string> threadArgs = engineArgs;
+                                threadArgs.push_back("-w");
+                                threadArgs.push_back(threads);
+                                measure(d, problem, parameter.first, engine, atoi(threads.c_str()),
+                                        cacheMode, threadArgs);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    } catch (runtime_error &e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    if (dryRun) {
+        return EXIT_SUCCESS;
+    }
+
+    //START: throughput relative to diskSpeed and scaling
+    // key of the runs that are compared with each other
+    auto key = [](const Configuration& c, const string& engine) {
+        return c.dataset + "|" + c.cache + "|" + c.problem + "|" + c.parameter + "|" + engine;
+    };
+    map<string, double> disk, sequential, smallestThreads;
+    map<string, int> smallestThreadCount;
+    for (const auto& c: results) {
+        if (c.engine == "diskSpeed") disk[c.dataset + "|" + c.cache] = c.median;
+        if (c.engine == "sequential") sequential[key(c, "sequential")] = c.median;
+        if (c.engine == "parallel" || c.engine == "bitmap") {
+            string k = key(c, c.engine);
+            if (!smallestThreadCount.count(k) || c.threads < smallestThreadCount[k]) {
+                smallestThreadCount[k] = c.threads;
+                smallestThreads[k] = c.median;
+            }
+        }
+    }
+
+    ofstream csvOut;
+    if (csvFile != "") {
+        csvOut.open(csvFile, ios::out);
+        if (!csvOut) {
+            cerr << "ERROR: cannot open " << csvFile << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    ostream& csv = (csvFile != "") ? csvOut : cout;
+    csv << "dataset,problem,parameter,engine,threads,cache,runs,wall_s,user_s,sys_s,"
+        << "reads_per_s,mb_per_s,relative_to_disk,speedup_vs_sequential,scaling_efficiency" << endl;
+    ofstream json;
+    if (jsonFile != "") {
+        json.open(jsonFile, ios::out);
+        if (!json) {
+            cerr << "ERROR: cannot open " << jsonFile << endl;
+            return EXIT_FAILURE;
+        }
+        json << "{\"results\": [";
+    }
+    for (size_t k = 0; k < results.size(); k++) {
+        const Configuration& c = results[k];
+        double user = 0, sys = 0;
+        for (const auto& r: c.runs) {
+            user += r.user / c.runs.size();
+            sys  += r.sys  / c.runs.size();
+        }
+        double mbPerSecond = c.bytes / c.median / 1e6;
+        auto diskIt = disk.find(c.dataset + "|" + c.cache);
+        string relativeToDisk = (diskIt == disk.end()) ? "" : to_string(diskIt->second / c.median);
+        string speedup = "", efficiency = "";
+        if (c.engine == "parallel" || c.engine == "bitmap") {
+            auto seqIt = sequential.find(key(c, "sequential"));
+            if (seqIt != sequential.end()) speedup = to_string(seqIt->second / c.median);
+            string s = key(c, c.engine);
+            if (c.threads > 0 && smallestThreadCount[s] > 0) {
+                efficiency = to_string(smallestThreads[s] / c.median
+                                       * smallestThreadCount[s] / c.threads);
+            }
+        }
+        csv << c.dataset << "," << c.problem << "," << c.parameter << "," << c.engine << ","
+            << c.threads << "," << c.cache << "," << c.runs.size() << ","
+            << c.median << "," << user << "," << sys << ","
+            << c.reads / c.median << "," << mbPerSecond << "," << relativeToDisk << ","
+            << speedup << "," << efficiency << endl;
+        if (json.is_open()) {
+            json << (k ? ",\n" : "\n") << "  {\"dataset\": \"" << c.dataset << "\", \"problem\": \"" << c.problem
+                 << "\", \"parameter\": \"" << c.parameter << "\", \"engine\": \"" << c.engine
+                 << "\", \"threads\": " << c.threads << ", \"cache\": \"" << c.cache
+                 << "\", \"wall_s\": " << c.median << ", \"reads_per_s\": " << c.reads / c.median
+                 << ", \"mb_per_s\": " << mbPerSecond
+                 << ", \"relative_to_disk\": " << (relativeToDisk == "" ? "null" : relativeToDisk)
+                 << ", \"speedup_vs_sequential\": " << (speedup == "" ? "null" : speedup)
+                 << ", \"scaling_efficiency\": " << (efficiency == "" ? "null" : efficiency)
+                 << ", \"runs\": [";
+            for (size_t r = 0; r < c.runs.size(); r++) {
+                json << (r ? ", " : "") << "{\"wall_s\": " << c.runs[r].wall << ", \"user_s\": "
+                     << c.runs[r].user << ", \"sys_s\": " << c.runs[r].sys << "}";
+            }
+            json << "]}";
+        }
+    }
+    if (json.is_open()) {
+        json << "\n]}\n";
+    }
+    //END: throughput relative to diskSpeed and scaling
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,147 @@
+/*******************************************************************************
+ *
+ * trimAllCriteria.cpp
+ *
+ * DESCRIPTION: Given a FASTQ file. n reads of length l. Given several
+ *              criteria, each one of the problems 0-zeros, z-zeros, p-percent
+ *              or m-mean with its own parameters (--criterion, repeatable).
+ *              Computes the matrix c of every criterion in a single pass over
+ *              the input (see ComputeMatricesMulti.h), instead of one run of
+ *              trimZeroOne, trimZeroOneZerosAllowed,
+ *              trimZeroOnePercentZerosAllowed or trimIntegerMean per
+ *              criterion. With an output file name, the matrix of the k-th
+ *              criterion is exported to <outfile>_<k>.csv (.bin, .npy),
+ *              otherwise the best window of each criterion is printed.
+ *
+ * RUNTIME: the sum of the runtimes of the criteria, the input is read once
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#include "tclap/CmdLine.h"           // command line arguments
+#include "ComputeMatricesMulti.h"    // all criteria in one pass
+#include "Results.h"                 // output on screen or in CSV
+#include "ToolOptions.h"             // shared command line options
+
+using namespace std;
+using namespace TCLAP;           // command line arguments
+using namespace ComputeMatrices; // trimming algorithms
+using namespace Results;         // output on screen or in CSV
+using namespace ToolOptions;     // shared command line options
+
+int main(int argc, char * argv[]) {
+
+    //START: processing command line options
+    int numberOfSequences, lengthOfSequence, shift, numThreads;
+    WindowQuery windowQuery;
+    string inputFile, outputFile, outputFormat, statsFile, traceFile;
+    vector<string> criterionTexts;
+    bool json, perfCounters;
+
+    try{
+
+        // read command line parameters
+        CmdLine cmd("trim: 0-zeros, z-zeros, p-percent and m-mean in one pass", ' ', "1.2", true);
+        ValueArg<int>    rowsArg(      "r", "reads",       "number of reads",                      true,  0,   "integer", cmd);
+        ValueArg<int>    lengthArg(    "l", "length",      "length of each read",                  true,  0,   "integer", cmd);
+        string criterionHelp = "criterion (repeatable):";
+        for (const auto& c: criteria) {
+            criterionHelp += " " + c;
+        }
+        MultiArg<string> criterionArg( "c", "criterion",   criterionHelp,                          true,       "string",  cmd);
+        ValueArg<string> infileArg(    "i", "infile",      "input file name",                      true,  "",  "string",  cmd);
+        ExportArgs       output(cmd, "output file name (<outfile>_<k> for the k-th criterion)", "format of the output files");
+        ValueArg<int>    shiftArg(     "s", "shift",       "shift for char -> quality conversion", true,  -1,  "integer", cmd);
+        ValueArg<int>    numThreadsArg("w", "workthreads", "number of parallel worker threads",    false,  0,  "integer", cmd);
+        QueryArgs        query(cmd);
+        RunArgs          run(cmd);
+
+        cmd.parse( argc, argv );
+        numberOfSequences = rowsArg.getValue();
+        lengthOfSequence  = lengthArg.getValue();
+        criterionTexts    = criterionArg.getValue();
+        inputFile         = infileArg.getValue();
+        outputFile        = output.outfileArg.getValue();
+        outputFormat      = output.formatArg.getValue();
+        shift             = shiftArg.getValue();
+        numThreads        = numThreadsArg.getValue();
+        windowQuery       = query.windowQuery();
+        json              = query.jsonArg.getValue();
+        statsFile         = run.statsArg.getValue();
+        traceFile         = run.traceArg.getValue();
+        perfCounters      = run.perfArg.getValue();
+        try {
+            QualityInput::checkQualityStore(inputFile, numberOfSequences, lengthOfSequence);
+        } catch (runtime_error &e) {
+            throw ArgException(e.what(), "infile");
+        }
+        run.check();
+
+    } catch (ArgException &e) {
+        cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
+        return EXIT_FAILURE;
+    }
+    //END: processing command line options
+
+    vector<Problem> problems;
+    for (const auto& text: criterionTexts) {
+        try {
+            problems.push_back(parseCriterion(text, lengthOfSequence, shift));
+        } catch (runtime_error &e) {
+            cerr << "ARGUMENT ERROR: " << e.what() << " for arg criterion" << endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (statsFile != "" || traceFile != "") {
+        Stats::start(perfCounters, traceFile != "");
+    }
+
+    //START: now compute optimal trimming parameters
+    vector<vector<vector<int>>> cs = trimProblems(inputFile, numberOfSequences, problems, numThreads);
+    //END: now compute optimal trimming parameters
+
+    //START: output in CSV or on terminal, one result per criterion
+    if (json && outputFile == "") {
+        cout << "[" << endl;
+    }
+    for (size_t k = 0; k < cs.size(); k++) {
+        if (outputFile != "") {
+            string name = numberedFileName(outputFile, to_string(k), outputFormat);
+            exportMatrix(cs[k], name, outputFormat);
+            cout << "criterion: " << criterionTexts[k] << endl;
+            cout << "out:   " << name << endl;
+        } else {
+            if (!json) {
+                cout << "criterion: " << criterionTexts[k] << endl;
+            }
+            printWindows(queryWindows(cs[k], numberOfSequences, windowQuery),
+                         lengthOfSequence, numberOfSequences, json);
+            if (json && k+1 < cs.size()) {
+                cout << "," << endl;
+            }
+        }
+        if (!json) {
+            cout << endl;
+        }
+    }
+    if (json && outputFile == "") {
+        cout << "]" << endl;
+    }
+    //END: output in CSV or on terminal, one result per criterion
+
+    //START: timings and throughput
+    if (statsFile != "" || traceFile != "") {
+        try {
+            Stats::finish(statsFile, traceFile, "trimAllCriteria", {inputFile});
+        } catch (runtime_error &e) {
+            cerr << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    //END: timings and throughput
+
+    return EXIT_SUCCESS;
+
+}
@@ -0,0 +1,130 @@
+/*******************************************************************************
+ *
+ * trimClient.cpp
+ *
+ * DESCRIPTION: Sends one query to trimServer (see QueryServer.h) and prints
+ *              the answer: the best window (and the top k windows, the Pareto
+ *              frontier) of a criterion, or its matrix c (--matrix, written
+ *              to --outfile or on screen). The criterion is given as in
+ *              trimAllCriteria, e.g. "m-mean:m=25".
+ *
+ * RUNTIME: the runtime of the query on the server
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#include <fstream>
+#include <sstream>
+
+#include "tclap/CmdLine.h"        // command line arguments
+#include "ComputeMatricesMulti.h" // criteria
+#include "QueryServer.h"          // Unix domain socket
+#include "Results.h"              // exportFormats
+
+using namespace std;
+using namespace TCLAP;           // command line arguments
+using namespace ComputeMatrices; // criteria
+using namespace Results;         // exportFormats
+
+int main(int argc, char * argv[]) {
+
+    //START: processing command line options
+    string socketPath, outputFile, request;
+
+    try{
+
+        // read command line parameters
+        CmdLine cmd("client: sends a query to trimServer", ' ', "1.2", true);
+        ValueArg<string> socketArg(    "S", "socket",      "path of the Unix domain socket of trimServer", true, "", "string", cmd);
+        string criterionHelp = "criterion:";
+        for (const auto& c: criteria) {
+            criterionHelp += " " + c;
+        }
+        ValueArg<string> criterionArg( "c", "criterion",   criterionHelp,                          true,  "",  "string");
+        SwitchArg        infoArg(      "n", "info",        "print the number of reads, length and memory of the server", false);
+        SwitchArg        shutdownArg(  "Q", "shutdown",    "stop the server", false);
+        vector<Arg*> requests = {&criterionArg, &infoArg, &shutdownArg};
+        cmd.xorAdd(requests);
+        SwitchArg        matrixArg(    "m", "matrix",      "the matrix c instead of the best window", cmd, false);
+        ValueArg<string> outfileArg(   "o", "outfile",     "--matrix: output file name (default: on screen)", false, "", "string", cmd);
+        vector<string> formats = exportFormats;
+        ValuesConstraint<string> formatConstraint(formats);
+        ValueArg<string> formatArg(    "f", "format",      "--matrix: format of the matrix",       false, "csv", &formatConstraint, cmd);
+        ValueArg<int>    topArg(       "k", "top",         "print the k windows with the largest areas", false, 0, "integer", cmd);
+        SwitchArg        paretoArg(    "F", "pareto",      "print the Pareto frontier of width vs. selected reads", cmd, false);
+        ValueArg<int>    minWidthArg(  "W", "minwidth",    "best window: min. width", false, 0, "integer", cmd);
+        ValueArg<double> minReadsArg(  "R", "minreads",    "best window: min. percent of selected reads", false, 0.0, "double", cmd);
+        SwitchArg        jsonArg(      "j", "json",        "print the windows as JSON", cmd, false);
+
+        cmd.parse( argc, argv );
+        socketPath        = socketArg.getValue();
+        outputFile        = outfileArg.getValue();
+        if (criterionArg.getValue().find_first_of(" \t\n") != string::npos) {
+            throw ArgException("must not contain white space", "criterion");
+        }
+        if ((outfileArg.isSet() || formatArg.isSet()) && !matrixArg.isSet()) {
+            throw ArgException("needs --matrix", outfileArg.isSet() ? "outfile" : "format");
+        }
+        if (matrixArg.isSet() && (topArg.isSet() || paretoArg.isSet() || minWidthArg.isSet() || minReadsArg.isSet() || jsonArg.isSet())) {
+            throw ArgException("the options of the best window can not be combined with --matrix", "matrix");
+        }
+        if (infoArg.isSet()) {
+            request = "info";
+        } else if (shutdownArg.isSet()) {
+            request = "shutdown";
+        } else if (matrixArg.isSet()) {
+            request = "matrix " + criterionArg.getValue() + " " + formatArg.getValue();
+        } else {
+            stringstream line;
+            line << "best " << criterionArg.getValue();
+            if (jsonArg.getValue())     line << " json";
+            if (paretoArg.getValue())   line << " pareto";
+            if (topArg.isSet())         line << " top=" << topArg.getValue();
+            if (minWidthArg.isSet())    line << " minwidth=" << minWidthArg.getValue();
+            if (minReadsArg.isSet())    line << " minreads=" << minReadsArg.getValue();
+            request = line.str();
+        }
+
+    } catch (ArgException &e) {
+        cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
+        return EXIT_FAILURE;
+    }
+    //END: processing command line options
+
+    //START: send the request, the answer starts with a status line
+    string response;
+    try {
+        int fd = QueryServer::connectTo(socketPath);
+        QueryServer::sendAll(fd, request + "\n");
+        response = QueryServer::receiveAll(fd);
+        close(fd);
+    } catch (runtime_error &e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+    size_t end = response.find('\n');
+    string status = response.substr(0, end);
+    if (status != "OK") {
+        cerr << "ERROR: " << (status.compare(0, 6, "ERROR ") == 0 ? status.substr(6) : "invalid answer of the server") << endl;
+        return EXIT_FAILURE;
+    }
+    //END: send the request, the answer starts with a status line
+
+    //START: output on screen or in a file
+    if (outputFile != "") {
+        ofstream out(outputFile, ios::out | ios::binary);
+        out.write(response.data() + end + 1, response.size() - end - 1);
+        if (!out) {
+            cerr << "ERROR: can not write " << outputFile << endl;
+            return EXIT_FAILURE;
+        }
+        cout << "out:   " << outputFile << endl;
+    } else {
+        cout.write(response.data() + end + 1, response.size() - end - 1);
+    }
+    //END: output on screen or in a file
+
+    return EXIT_SUCCESS;
+
+}
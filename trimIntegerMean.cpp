@@ -27,40 +27,75 @@
 #include "tclap/CmdLine.h"           // command line arguments
 #include "ComputeMatrices.h"         // trimming algorithms
 #include "ComputeMatricesParallel.h" // parallel trimming algorithms
+#include "ComputeMatricesPaired.h"   // trimming algorithms for paired-end reads
+#include "ComputeMatricesBatch.h"    // batch mode for many input files
+#include "ComputeMatricesGroups.h"   // group-by mode (tiles, lanes, barcodes)
+#include "ComputeMatricesSeries.h"   // time series and follow mode
+#include "TrimmedOutput.h"           // output of the selected reads
 #include "Results.h"                 // output on screen or in CSV
+#include "ToolOptions.h"             // shared command line options
 
 using namespace std;
 using namespace TCLAP;           // command line arguments
 using namespace ComputeMatrices; // trimming algorithms
+using namespace TrimmedOutput;   // output of the selected reads
 using namespace Results;         // output on screen or in CSV
+using namespace ToolOptions;     // shared command line options
 
 int main(int argc, char * argv[]) {
     
     //START: processing command line options
-    int numberOfSequences, lengthOfSequence, shift, numThreads;
-    string inputFile, outputFile;
+    int numberOfSequences, lengthOfSequence, shift, numThreads, seriesEvery, seriesLast, idleSeconds;
+    WindowQuery windowQuery;
+    string inputFile, outputFile, outputFormat, pairedFile, batchFile, groupBy, windowText, statsFile, traceFile;
+    SelectionOutput selection;
+    bool pairedMode, batchMode, aggregate, json, printQuery, perfCounters, follow;
     double givenMinMean;
     
     try{
         
         // read command line parameters
         CmdLine cmd("trim: selected rows must have a mean of at least m", ' ', "1.2", true);
-        ValueArg<int>    rowsArg(      "r", "reads",       "number of reads",                      true,  0,   "integer", cmd);
+        ValueArg<int>    rowsArg(      "r", "reads",       "number of reads",                      false, 0,   "integer", cmd);
         ValueArg<int>    lengthArg(    "l", "length",      "length of each read",                  true,  0,   "integer", cmd);
         ValueArg<double> meanArg(      "m", "mean",        "min mean per selected read",           true,  0.0, "double",  cmd);
-        ValueArg<string> infileArg(    "i", "infile",      "input file name",                      true,  "",  "string",  cmd);
-        ValueArg<string> outfileArg(   "o", "outfile",     "output file name (CSV format)",        false, "",  "string",  cmd);
         ValueArg<int>    shiftArg(     "s", "shift",       "shift for char -> quality conversion", true,  -1,  "integer", cmd);
         ValueArg<int>    numThreadsArg("w", "workthreads", "number of parallel worker threads",    false,  0,  "integer", cmd);
+        ModeArgs         mode(cmd, false);
+        ExportArgs       output(cmd);
+        QueryArgs        query(cmd);
+        SelectionArgs    emit(cmd);
+        RunArgs          run(cmd);
         
         cmd.parse( argc, argv );
         numberOfSequences = rowsArg.getValue();
         lengthOfSequence  = lengthArg.getValue();
         givenMinMean      = meanArg.getValue();
-        inputFile         = infileArg.getValue();
-        outputFile        = outfileArg.getValue();
+        inputFile         = mode.infileArg.getValue();
+        outputFile        = output.outfileArg.getValue();
+        outputFormat      = output.formatArg.getValue();
         shift             = shiftArg.getValue();
         numThreads        = numThreadsArg.getValue();
+        pairedFile        = mode.pairedArg.getValue();
+        pairedMode        = mode.pairedMode();
+        batchFile         = mode.batchArg.getValue();
+        batchMode         = mode.batchArg.isSet();
+        groupBy           = mode.groupArg.getValue();
+        seriesEvery       = mode.everyArg.getValue();
+        seriesLast        = mode.lastArg.getValue();
+        follow            = mode.followArg.getValue();
+        idleSeconds       = mode.idleArg.getValue();
+        aggregate         = mode.aggregateArg.getValue();
+        windowQuery       = query.windowQuery();
+        json              = query.jsonArg.getValue();
+        printQuery        = query.printQuery();
+        selection         = emit.output();
+        windowText        = emit.windowArg.getValue();
+        statsFile         = run.statsArg.getValue();
+        traceFile         = run.traceArg.getValue();
+        perfCounters      = run.perfArg.getValue();
+        checkModes(mode, query, emit, rowsArg, lengthOfSequence);
+        run.check();
         
     } catch (ArgException &e) {
         cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
@@ -68,10 +103,77 @@ int main(int argc, char * argv[]) {
     }
     //END: processing command line options
     
+    if (statsFile != "" || traceFile != "") {
+        Stats::start(perfCounters, traceFile != "");
+    }
+    
+    if (batchMode) {// batch mode: all files through one pool of worker threads
+        try {
+            vector<BatchFile> files = readBatchList(batchFile);
+            vector<string> inputFiles;
+            vector<int> rows;
+            for (const auto& f: files) {
+                inputFiles.push_back(f.inputfile);
+                rows.push_back(f.numberOfSequences);
+            }
+            vector<vector<vector<int>>> cs = trimBatch(files,
+                                                       meanProblem(lengthOfSequence,givenMinMean,shift),
+                                                       max(1,numThreads));
+            printBatchResults(inputFiles, rows, cs, outputFile, aggregate, windowQuery, printQuery, outputFormat);
+            Stats::finish(statsFile, traceFile, "trimIntegerMean", inputFiles);
+        } catch (runtime_error &e) {
+            cerr << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    
+    if (groupBy != "") {// group-by mode: one matrix per group of reads in one pass
+        try {
+            vector<GroupResult> groups = trimGroups(inputFile, numberOfSequences,
+                                                    {meanProblem(lengthOfSequence,givenMinMean,shift)},
+                                                    groupFields(groupBy), numThreads);
+            vector<string> keys;
+            vector<int> rows;
+            vector<vector<vector<int>>> cs;
+            splitGroupResults(groups, 0, keys, rows, cs);
+            printGroupResults(keys, rows, cs, outputFile, windowQuery, outputFormat);
+            Stats::finish(statsFile, traceFile, "trimIntegerMean", {inputFile});
+        } catch (runtime_error &e) {
+            cerr << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    
+    if (seriesEvery > 0) {// time series and follow mode: best window every n reads
+        try {
+            auto printStep = [&](const SeriesStep& step) {
+                printSeriesStep(step.step, step.first, step.last, step.cs[0], step.deltas[0],
+                                windowQuery, outputFile, outputFormat);
+            };
+            if (follow) {
+                trimFollow(inputFile, numberOfSequences, idleSeconds, {meanProblem(lengthOfSequence,givenMinMean,shift)},
+                           seriesEvery, seriesLast, numThreads, printStep);
+            } else {
+                trimSeries(inputFile, numberOfSequences, {meanProblem(lengthOfSequence,givenMinMean,shift)},
+                           seriesEvery, seriesLast, numThreads, printStep);
+            }
+            Stats::finish(statsFile, traceFile, "trimIntegerMean", {inputFile});
+        } catch (runtime_error &e) {
+            cerr << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    
     //START: now compute optimal trimming parameters
     vector<vector<int>> c; // compute matrix c_m for m-mean
     
-    if (numThreads == 0){// sequential mode
+    if (pairedMode) {// paired-end mode, always parallel
+        c = trimIntegerMeanPaired(inputFile,pairedFile,numberOfSequences,lengthOfSequence,
+                                  givenMinMean,shift,max(1,numThreads));
+    } else if (numThreads == 0){// sequential mode
         c = trimIntegerMean(inputFile,numberOfSequences,lengthOfSequence,
                             givenMinMean,shift);
     } else {// parallel mode
@@ -82,12 +184,44 @@ int main(int argc, char * argv[]) {
     
     //START: output in CSV or on terminal
     if (outputFile != "") {
-        exportMatrix(c,outputFile);
-    } else {
-        printMaxArea(c, numberOfSequences);
+        exportMatrix(c,outputFile,outputFormat);
+    }
+    WindowSummary windows = queryWindows(c, numberOfSequences, windowQuery);
+    if (outputFile == "" || printQuery) {
+        printWindows(windows, lengthOfSequence, numberOfSequences, json);
     }
     //END: output in CSV or on terminal
     
+    //START: selected reads of the best (or the given) window
+    if (selection.emitFile != "" || selection.bitsetFile != "" || selection.namesFile != "") {
+        try {
+            Window window = windows.best;
+            if (windowText != "") {
+                window = parseWindow(windowText, c);
+            } else if (!windows.found) {
+                throw runtime_error("no window for the selected reads");
+            }
+            writeSelectedReads(inputFile, numberOfSequences, window.left, window.right,
+                               meanProblem(lengthOfSequence,givenMinMean,shift).selects,
+                               selection, max(1,numThreads));
+        } catch (runtime_error &e) {
+            cerr << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    //END: selected reads of the best (or the given) window
+    
+    //START: timings and throughput
+    if (statsFile != "" || traceFile != "") {
+        try {
+            Stats::finish(statsFile, traceFile, "trimIntegerMean", {inputFile, pairedFile});
+        } catch (runtime_error &e) {
+            cerr << "ERROR: " << e.what() << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    //END: timings and throughput
+    
     return EXIT_SUCCESS;
     
 }
@@ -0,0 +1,194 @@
+/*******************************************************************************
+ *
+ * trimServer.cpp
+ *
+ * DESCRIPTION: Given a FASTQ file with n reads of length l or a quality store.
+ *              Loads the quality lines once into memory as a bit-packed
+ *              quality store (see QualityStore.h) and answers queries for any
+ *              of the problems 0-zeros, z-zeros, p-percent and m-mean with any
+ *              parameters on a Unix domain socket (see QueryServer.h), so
+ *              the parameters can be explored without a pass over the file
+ *              per try. Each query uses all worker threads. Queries are sent
+ *              with trimClient.
+ *
+ * RUNTIME: loading: O( n*l ), per query: the runtime of the problem divided
+ *          by the number of worker threads
+ *
+ * AUTHORS: Ivo Hedtke (ivo.hedtke@uni-osnabrueck.de)
+ *
+ */
+
+#include <sstream>
+#include <chrono>
+#include <thread>
+
+#include "tclap/CmdLine.h"         // command line arguments
+#include "QualityStore.h"          // reads in memory
+#include "ComputeMatricesMulti.h"  // parseCriterion
+#include "ComputeMatricesMemory.h" // trimming algorithms on reads in memory
+#include "QueryServer.h"           // Unix domain socket
+#include "Results.h"               // output of the queries
+
+using namespace std;
+using namespace TCLAP;           // command line arguments
+using namespace ComputeMatrices; // trimming algorithms
+using namespace Results;         // output of the queries
+
+// the answer to one request line (see QueryServer.h) without the status line
+string answer(const string& request,
+              const QualityStore::InMemory& reads,
+              const int& numThreads,
+              bool& shutdown)
+{
+    const QualityStore::Header& h = reads.header();
+    stringstream words(request);
+    string command, criterion, word;
+    words >> command;
+    ostringstream out;
+
+    if (command == "info") {
+        out << "reads:   " << h.numberOfReads << endl;
+        out << "length:  " << h.lengthOfSequence << endl;
+        out << "shift:   " << h.shiftToConvertChars << endl;
+        out << "bits:    " << h.bitsPerQuality << " per quality score" << endl;
+        out << "memory:  " << reads.size() / (1024*1024) << " MB" << endl;
+        out << "threads: " << numThreads << endl;
+        return out.str();
+    }
+    if (command == "shutdown") {
+        shutdown = true;
+        return "";
+    }
+    if (command != "best" && command != "matrix") {
+        throw runtime_error("unknown request \"" + command + "\"");
+    }
+    if (!(words >> criterion)) {
+        throw runtime_error("missing criterion");
+    }
+    Problem problem = parseCriterion(criterion, h.lengthOfSequence, h.shiftToConvertChars);
+
+    WindowQuery query;
+    bool json = false;
+    string format = exportFormats[0];
+    while (words >> word) {
+        size_t eq = word.find('=');
+        string name = word.substr(0, eq);
+        stringstream value(eq == string::npos ? "" : word.substr(eq + 1));
+        bool valid = true;
+        if (command == "matrix" && find(exportFormats.begin(), exportFormats.end(), word) != exportFormats.end()) {
+            format = word;
+        } else if (command == "best" && word == "json") {
+            json = true;
+        } else if (command == "best" && word == "pareto") {
+            query.pareto = true;
+        } else if (command == "best" && name == "top") {
+            valid = (value >> query.top) && value.eof() && query.top >= 0;
+        } else if (command == "best" && name == "minwidth") {
+            valid = (value >> query.minWidth) && value.eof();
+        } else if (command == "best" && name == "minreads") {
+            valid = (value >> query.minReadsPercent) && value.eof();
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            throw runtime_error("invalid option \"" + word + "\" for " + command);
+        }
+    }
+
+    vector<vector<int>> c = trimInMemory(reads, problem, numThreads);
+    if (command == "best") {
+        printWindows(queryWindows(c, h.numberOfReads, query), h.lengthOfSequence, h.numberOfReads, json, out);
+    } else {
+        writeMatrix(c, out, format);
+    }
+    return out.str();
+}
+
+int main(int argc, char * argv[]) {
+
+    //START: processing command line options
+    int numberOfSequences, lengthOfSequence, shift, numThreads;
+    string inputFile, socketPath;
+
+    try{
+
+        // read command line parameters
+        CmdLine cmd("server: holds the reads in memory and answers queries of trimClient", ' ', "1.2", true);
+        ValueArg<string> infileArg(    "i", "infile",      "input file name (FASTQ or quality store)", true, "", "string", cmd);
+        ValueArg<int>    rowsArg(      "r", "reads",       "number of reads (FASTQ)",              false, 0,   "integer", cmd);
+        ValueArg<int>    lengthArg(    "l", "length",      "length of each read (FASTQ)",          false, 0,   "integer", cmd);
+        ValueArg<int>    shiftArg(     "s", "shift",       "shift for char -> quality conversion (FASTQ)", false, -1, "integer", cmd);
+        ValueArg<string> socketArg(    "S", "socket",      "path of the Unix domain socket",       true,  "",  "string",  cmd);
+        ValueArg<int>    numThreadsArg("w", "workthreads", "number of worker threads per query (default: all cores)", false, 0, "integer", cmd);
+
+        cmd.parse( argc, argv );
+        inputFile         = infileArg.getValue();
+        numberOfSequences = rowsArg.getValue();
+        lengthOfSequence  = lengthArg.getValue();
+        shift             = shiftArg.getValue();
+        socketPath        = socketArg.getValue();
+        numThreads        = numThreadsArg.getValue();
+        if (!QualityStore::isQualityStore(inputFile) && !(rowsArg.isSet() && lengthArg.isSet() && shiftArg.isSet())) {
+            throw ArgException("--reads, --length and --shift are required for a FASTQ file", "infile");
+        }
+        if (!numThreadsArg.isSet()) {
+            numThreads = max(1u, std::thread::hardware_concurrency());
+        }
+        if (numThreads < 1) {
+            throw ArgException("must be at least 1", "workthreads");
+        }
+
+    } catch (ArgException &e) {
+        cerr << "ARGUMENT ERROR: " << e.error() << " for arg " << e.argId() << endl;
+        return EXIT_FAILURE;
+    }
+    //END: processing command line options
+
+    try {
+        //START: load the reads
+        auto start = chrono::steady_clock::now();
+        QualityStore::InMemory reads(inputFile, numberOfSequences, lengthOfSequence, shift);
+        int listening = QueryServer::listenOn(socketPath);
+        cerr << "loaded " << reads.header().numberOfReads << " reads ("
+             << reads.size() / (1024*1024) << " MB) in "
+             << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s, "
+             << "listening on " << socketPath << endl;
+        //END: load the reads
+
+        //START: answer the queries, one after the other
+        bool shutdown = false;
+        while (!shutdown) {
+            int fd = accept(listening, nullptr, nullptr);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                throw runtime_error(string("accept: ") + strerror(errno));
+            }
+            string request;
+            try {
+                start = chrono::steady_clock::now();
+                request = QueryServer::readLine(fd);
+                if (request != "") {// empty: listenOn of another server checks the socket
+                    string result = answer(request, reads, numThreads, shutdown);
+                    QueryServer::sendAll(fd, "OK\n" + result);
+                    cerr << request << ": "
+                         << chrono::duration<double>(chrono::steady_clock::now() - start).count() << " s" << endl;
+                }
+            } catch (exception &e) {
+                cerr << request << ": ERROR: " << e.what() << endl;
+                try {
+                    QueryServer::sendAll(fd, string("ERROR ") + e.what() + "\n");
+                } catch (runtime_error&) {} // the client is gone
+            }
+            close(fd);
+        }
+        close(listening);
+        unlink(socketPath.c_str());
+        //END: answer the queries, one after the other
+    } catch (runtime_error &e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+
+}
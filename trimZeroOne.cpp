@@ -24,14 +24,23 @@
  *
  */
 
-#include "tclap/CmdLine.h"   // command line arguments
-#include "ComputeMatrices.h" // trimming algorithms
-#include "Results.h"         // output on screen or in CSV
+#include "tclap/CmdLine.h"         // command line arguments
+#include "ComputeMatrices.h"       // trimming algorithms
+#include "ComputeMatricesBitmap.h" // trimming algorithms on 0/1 bitmaps
+#include "ComputeMatricesPaired.h" // trimming algorithms for paired-end reads
+#include "ComputeMatricesBatch.h"  // batch mode for many input files
+#include "ComputeMatricesGroups.h" // group-by mode (tiles, lanes, barcodes)
+#include "ComputeMatricesSeries.h" // time series and follow mode
+#include "TrimmedOutput.h"         // output of the selected reads
+#include "Results.h"               // output on screen or in CSV
+#include "ToolOptions.h"           // shared command line options
 
 using namespace std;
 using namespace TCLAP;           // command line arguments
 using namespace ComputeMatrices; // trimming algorithms
+using namespace TrimmedOutput;   // output of the selected reads
 using namespace Results;         // output on screen or in CSV
+using namespace ToolOptions;     // shared command line options
 
 int main(int argc, const char * argv[]) {
     
@@ -39,36 +48,151 @@ int main(int argc, const char * argv[]) {
 
         // read command line parameters
         CmdLine cmd("trim with 0 loq quality nucleotides per row", ' ', "1.0", true);
-        ValueArg<int>    rowsArg(     "r", "reads",     "number of reads",                             true,  0,  "integer", cmd);
+        ValueArg<int>    rowsArg(     "r", "reads",     "number of reads",                             false, 0,  "integer", cmd);
         ValueArg<int>    lengthArg(   "l", "length",    "length of each read",                         true,  0,  "integer", cmd);
-        ValueArg<string> infileArg(   "i", "infile",    "input file name",                             true,  "", "string",  cmd);
-        ValueArg<string> outfileArg(  "o", "outfile",   "output file name (CSV format)",               false, "", "string",  cmd);
         ValueArg<int>    thresholdArg("t", "threshold", "quality is ok if quality score >= threshold", true,  -1, "integer", cmd);
         ValueArg<int>    shiftArg(    "s", "shift",     "shift for char -> quality conversion",        true,  -1, "integer", cmd);
+        ValueArg<int>    numThreadsArg("w", "workthreads", "number of parallel worker threads (bitmap cache or paired-end mode)", false, 0, "integer", cmd);
+        ModeArgs         mode(cmd, true);
+        ExportArgs       output(cmd);
+        QueryArgs        query(cmd);
+        SelectionArgs    emit(cmd);
+        RunArgs          run(cmd);
         cmd.parse( argc, argv );
         int    numberOfSequences = rowsArg.getValue();
         int    lengthOfSequence  = lengthArg.getValue();
-        string inputFile         = infileArg.getValue();
-        string outputFile        = outfileArg.getValue();
+        string inputFile         = mode.infileArg.getValue();
+        string outputFile        = output.outfileArg.getValue();
+        string outputFormat      = output.formatArg.getValue();
         int    threshold         = thresholdArg.getValue();
         int    shift             = shiftArg.getValue();
+        bool   useBitmapCache    = mode.bitmapArg.getValue();
+        int    numThreads        = numThreadsArg.getValue();
+        string pairedFile        = mode.pairedArg.getValue();
+        bool   pairedMode        = mode.pairedMode();
+        string batchFile         = mode.batchArg.getValue();
+        bool   batchMode         = mode.batchArg.isSet();
+        string groupBy           = mode.groupArg.getValue();
+        int    seriesEvery       = mode.everyArg.getValue();
+        int    seriesLast        = mode.lastArg.getValue();
+        bool   follow            = mode.followArg.getValue();
+        int    idleSeconds       = mode.idleArg.getValue();
+        bool   aggregate         = mode.aggregateArg.getValue();
+        WindowQuery windowQuery = query.windowQuery();
+        bool   json              = query.jsonArg.getValue();
+        SelectionOutput selection = emit.output();
+        string windowText        = emit.windowArg.getValue();
+        string statsFile         = run.statsArg.getValue();
+        string traceFile         = run.traceArg.getValue();
+        bool   printQuery        = query.printQuery();
+        checkModes(mode, query, emit, rowsArg, lengthOfSequence);
+        run.check();
+
+        if (statsFile != "" || traceFile != "") {
+            Stats::start(run.perfArg.getValue(), traceFile != "");
+        }
+
+        if (batchMode) {// batch mode: all files through one pool of worker threads
+            vector<BatchFile> files = readBatchList(batchFile);
+            vector<string> inputFiles;
+            vector<int> rows;
+            for (const auto& f: files) {
+                inputFiles.push_back(f.inputfile);
+                rows.push_back(f.numberOfSequences);
+            }
+            vector<vector<vector<int> > > cs = trimBatch(files,
+                                                         zeroOneProblem(lengthOfSequence, threshold, shift),
+                                                         max(1, numThreads));
+            printBatchResults(inputFiles, rows, cs, outputFile, aggregate, windowQuery, printQuery, outputFormat);
+            Stats::finish(statsFile, traceFile, "trimZeroOne", inputFiles);
+            return EXIT_SUCCESS;
+        }
+
+        if (groupBy != "") {// group-by mode: one matrix per group of reads in one pass
+            vector<GroupResult> groups = trimGroups(inputFile, numberOfSequences,
+                                                    {zeroOneProblem(lengthOfSequence, threshold, shift)},
+                                                    groupFields(groupBy), numThreads);
+            vector<string> keys;
+            vector<int> rows;
+            vector<vector<vector<int> > > cs;
+            splitGroupResults(groups, 0, keys, rows, cs);
+            printGroupResults(keys, rows, cs, outputFile, windowQuery, outputFormat);
+            Stats::finish(statsFile, traceFile, "trimZeroOne", {inputFile});
+            return EXIT_SUCCESS;
+        }
+
+        if (seriesEvery > 0) {// time series and follow mode: best window every n reads
+            auto printStep = [&](const SeriesStep& step) {
+                printSeriesStep(step.step, step.first, step.last, step.cs[0], step.deltas[0],
+                                windowQuery, outputFile, outputFormat);
+            };
+            if (follow) {
+                trimFollow(inputFile, numberOfSequences, idleSeconds, {zeroOneProblem(lengthOfSequence, threshold, shift)},
+                           seriesEvery, seriesLast, numThreads, printStep);
+            } else {
+                trimSeries(inputFile, numberOfSequences, {zeroOneProblem(lengthOfSequence, threshold, shift)},
+                           seriesEvery, seriesLast, numThreads, printStep);
+            }
+            Stats::finish(statsFile, traceFile, "trimZeroOne", {inputFile});
+            return EXIT_SUCCESS;
+        }
 
         // compute matrix c for 0-zeros
-        vector<vector<int> > c = trimZeroOne(inputFile,
-                                             numberOfSequences,
-                                             lengthOfSequence,
-                                             threshold,
-                                             shift);
+        unique_ptr<ZeroOneBitmap::Reader> bitmap;
+        if (useBitmapCache) {
+            try {
+                bitmap = ZeroOneBitmap::openOrCreate(inputFile, numberOfSequences,
+                                                     lengthOfSequence, threshold, shift);
+            } catch (runtime_error &e) {
+                cerr << "WARNING: no bitmap cache (" << e.what() << "), reading " << inputFile << endl;
+            }
+        }
+        vector<vector<int> > c;
+        if (pairedMode) {
+            // numberOfSequences = number of pairs
+            c = trimZeroOnePaired(inputFile, pairedFile, numberOfSequences,
+                                  lengthOfSequence, threshold, shift, max(1, numThreads));
+        } else if (bitmap) {
+            c = trimZeroOneBitmap(*bitmap, numberOfSequences, lengthOfSequence, numThreads);
+        } else {
+            c = trimZeroOne(inputFile,
+                            numberOfSequences,
+                            lengthOfSequence,
+                            threshold,
+                            shift);
+        }
 
         // output in CSV or on terminal
-        if (outfileArg.isSet()) {
-            exportMatrix(c,outputFile);
-        } else {
-            printMaxArea(c, numberOfSequences);
+        if (output.outfileArg.isSet()) {
+            exportMatrix(c,outputFile,outputFormat);
         }
+        WindowSummary windows = queryWindows(c, numberOfSequences, windowQuery);
+        if (!output.outfileArg.isSet() || printQuery) {
+            printWindows(windows, lengthOfSequence, numberOfSequences, json);
+        }
+
+        // selected reads of the best (or the given) window
+        if (emit.isSet()) {
+            Window window = windows.best;
+            if (emit.windowArg.isSet()) {
+                window = parseWindow(windowText, c);
+            } else if (!windows.found) {
+                throw runtime_error("no window for the selected reads");
+            }
+            writeSelectedReads(inputFile, numberOfSequences, window.left, window.right,
+                               zeroOneProblem(lengthOfSequence, threshold, shift).selects,
+                               selection, max(1, numThreads));
+        }
+
+        // timings and throughput
+        Stats::finish(statsFile, traceFile, "trimZeroOne", {inputFile, pairedFile});
 
     } catch (ArgException &e) {
         cerr << "ERROR: " << e.error() << " for arg " << e.argId() << endl;
+        return EXIT_FAILURE;
+    } catch (runtime_error &e) {
+        cerr << "ERROR: " << e.what() << endl;
+        return EXIT_FAILURE;
     }
 
     return EXIT_SUCCESS;